@@ -27,10 +27,14 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.
 #endif
 #include "WPAudioReader.h"
 #include "VorbisAudioReader.h"
+#include "MMapAudioReader.h"
 #include "ResampleAudioReader.h"
 #include "Utils.h"
 
 #include <QString>
+#include <QDir>
+#include <QFileInfo>
+#include <QHash>
 
 // Always put me below _all_ includes, this is needed
 // in case we run with memory leak detection enabled!
@@ -50,6 +54,38 @@ AbstractAudioReader::~AbstractAudioReader()
 = default;
 
 
+QString AbstractAudioReader::s_indexDir;
+
+void AbstractAudioReader::set_index_dir(const QString& dir)
+{
+	s_indexDir = dir;
+}
+
+// Returns the name of the index file with the given extension for our source,
+// or an empty string if there is no place to store it
+QString AbstractAudioReader::index_file_name(const QString& extension) const
+{
+	QFileInfo info(m_fileName);
+	QString dir = s_indexDir;
+
+	if (dir.isEmpty()) {
+		// Without a project, only store it if the source lives in a project dir
+		dir = info.absolutePath();
+		if (!dir.contains("audiosources")) {
+			return QString();
+		}
+		dir.replace("audiosources", "peakfiles");
+	}
+
+	if (!QDir(dir).exists()) {
+		return QString();
+	}
+
+	// Sources with the same name in different dirs get their own index file
+	return dir + "/" + info.fileName() + "-" + QString::number(qHash(info.absoluteFilePath()), 16) + "." + extension;
+}
+
+
 // Read cnt frames starting at start from the AudioReader, into dst
 // uses seek() and read() from AudioReader subclass
 nframes_t AbstractAudioReader::read_from(DecodeBuffer* buffer, nframes_t start, nframes_t count)
@@ -120,14 +156,50 @@ nframes_t AbstractAudioReader::read(DecodeBuffer* buffer, nframes_t count)
 }
 
 
+// Read count frames starting at start straight into dest
+// Only valid for readers which return true for can_read_direct()
+nframes_t AbstractAudioReader::read_direct_from(audio_sample_t** dest, nframes_t start, nframes_t count)
+{
+    if (!seek(start)) {
+        return 0;
+    }
+
+    return read_direct(dest, count);
+}
+
+
+nframes_t AbstractAudioReader::read_direct(audio_sample_t** dest, nframes_t count)
+{
+    Q_ASSERT(can_read_direct());
+
+    if (count && m_readPos < m_nframes) {
+
+        nframes_t framesRead = read_direct_private(dest, count);
+
+        m_readPos += framesRead;
+
+        return framesRead;
+    }
+
+    return 0;
+}
+
+
 // Static method used by other classes to get an AudioReader for the correct file type
 AbstractAudioReader* AbstractAudioReader::create_audio_reader(const QString& filename, const QString& decoder)
 {
     AbstractAudioReader* newReader = nullptr;
 
     if ( ! (decoder.isEmpty() || decoder.isNull()) ) {
-        if (decoder == "sndfile") {
-            newReader = new SFAudioReader(filename);
+        if (decoder == "sndfile" || decoder == "mmap") {
+            // Uncompressed wav/aiff files are read through a memory map when possible
+            if (MMapAudioReader::can_decode(filename)) {
+                newReader = new MMapAudioReader(filename);
+            }
+            if (!newReader || !newReader->is_valid()) {
+                delete newReader;
+                newReader = new SFAudioReader(filename);
+            }
         } else if (decoder == "wavpack") {
             newReader = new WPAudioReader(filename);
         } else if (decoder == "flac") {
@@ -158,6 +230,9 @@ AbstractAudioReader* AbstractAudioReader::create_audio_reader(const QString& fil
         }
         else if (WPAudioReader::can_decode(filename)) {
             newReader = new WPAudioReader(filename);
+        }
+        else if (MMapAudioReader::can_decode(filename)) {
+            newReader = new MMapAudioReader(filename);
         }
                 else if (SFAudioReader::can_decode(filename)) {
                         newReader = new SFAudioReader(filename);
@@ -72,15 +72,32 @@ public:
 	bool seek(nframes_t start);
 	nframes_t read(DecodeBuffer* buffer, nframes_t frameCount);
 	
+	// Direct reads decode straight into the callers (per channel) buffers,
+	// e.g. a ringbuffer write vector, without using a DecodeBuffer.
+	nframes_t read_direct_from(audio_sample_t** dest, nframes_t start, nframes_t count);
+	nframes_t read_direct(audio_sample_t** dest, nframes_t frameCount);
+	virtual bool can_read_direct() const {return false;}
+	
 	bool is_valid() {return (m_channels > 0 && m_nframes > 0);}
 	virtual QString decoder_type() const = 0;
 	virtual void clear_buffers() {}
 	
 	static AbstractAudioReader* create_audio_reader(const QString& filename, const QString& decoder = 0);
 	
+	// Directory where readers keep index files (e.g. seek tables) of their
+	// sources, normally the peakfiles dir of the current project
+	static void set_index_dir(const QString& dir);
+	
 protected:
 	virtual bool seek_private(nframes_t start) = 0;
 	virtual nframes_t read_private(DecodeBuffer* buffer, nframes_t frameCount) = 0;
+	virtual nframes_t read_direct_private(audio_sample_t** dest, nframes_t frameCount) {
+		Q_UNUSED(dest);
+		Q_UNUSED(frameCount);
+		return 0;
+	}
+	
+	QString index_file_name(const QString& extension) const;
 	
 	QString		m_fileName;
 
@@ -89,6 +106,9 @@ protected:
 	TimeRef		m_length;
 	nframes_t	m_nframes;
     uint		m_rate;
+
+private:
+	static QString	s_indexDir;
 };
 
 #endif
@@ -0,0 +1,461 @@
+/*
+Copyright (C) 2026 The Traverso developers
+
+This file is part of Traverso
+
+Traverso is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.
+
+*/
+
+#include "MMapAudioReader.h"
+#include <QString>
+#include <cmath>
+#include <cstring>
+
+#if defined (Q_OS_UNIX)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "Utils.h"
+// Always put me below _all_ includes, this is needed
+// in case we run with memory leak detection enabled!
+#include "Debugger.h"
+
+
+// The amount of audio the kernel is asked to read ahead of the read position
+#define READ_AHEAD_SECONDS 2
+
+#define WAVE_FORMAT_PCM		0x0001
+#define WAVE_FORMAT_IEEE_FLOAT	0x0003
+#define WAVE_FORMAT_EXTENSIBLE	0xFFFE
+
+
+static inline quint32 read_le(const uchar* p, int bytes)
+{
+	quint32 value = 0;
+	for (int i=0; i<bytes; ++i) {
+		value |= quint32(p[i]) << (i * 8);
+	}
+	return value;
+}
+
+static inline quint32 read_be(const uchar* p, int bytes)
+{
+	quint32 value = 0;
+	for (int i=0; i<bytes; ++i) {
+		value = (value << 8) | p[i];
+	}
+	return value;
+}
+
+// Converts the 80 bit IEEE 754 extended precision number used
+// for the sample rate in AIFF files.
+static double read_be_extended(const uchar* p)
+{
+	int exponent = ((p[0] & 0x7F) << 8) | p[1];
+	quint32 hiMantissa = read_be(p + 2, 4);
+	quint32 loMantissa = read_be(p + 6, 4);
+
+	if (exponent == 0 && hiMantissa == 0 && loMantissa == 0) {
+		return 0.0;
+	}
+
+	exponent -= 16383;
+	double value = ldexp(double(hiMantissa), exponent - 31);
+	value += ldexp(double(loMantissa), exponent - 63);
+
+	return (p[0] & 0x80) ? -value : value;
+}
+
+
+// Decodes one sample, integer samples are left aligned into a 32 bit
+// int, so the scaling is the same for any bitdepth (and equals libsndfile's)
+template<int bytes, bool bigEndian, bool isFloat>
+static inline audio_sample_t decode_sample(const uchar* p)
+{
+	quint32 value = bigEndian ? read_be(p, bytes) : read_le(p, bytes);
+
+	if (isFloat) {
+		float f;
+		memcpy(&f, &value, sizeof(float));
+		return f;
+	}
+
+	qint32 sample = qint32(value << (32 - bytes * 8));
+	return audio_sample_t(sample) * (1.0f / 2147483648.0f);
+}
+
+template<int bytes, bool bigEndian, bool isFloat>
+static void deinterleave(const uchar* src, audio_sample_t** dest, uint channels, nframes_t frameCount)
+{
+	const uint frameSize = bytes * channels;
+
+	if (channels == 2) {
+		audio_sample_t* left = dest[0];
+		audio_sample_t* right = dest[1];
+		for (nframes_t f = 0; f < frameCount; ++f) {
+			left[f] = decode_sample<bytes, bigEndian, isFloat>(src);
+			right[f] = decode_sample<bytes, bigEndian, isFloat>(src + bytes);
+			src += frameSize;
+		}
+		return;
+	}
+
+	for (nframes_t f = 0; f < frameCount; ++f) {
+		for (uint c = 0; c < channels; ++c) {
+			dest[c][f] = decode_sample<bytes, bigEndian, isFloat>(src + c * bytes);
+		}
+		src += frameSize;
+	}
+}
+
+
+MMapAudioReader::MMapAudioReader(const QString& filename)
+	: AbstractAudioReader(filename)
+{
+	m_map = nullptr;
+	m_data = nullptr;
+	m_frameSize = 0;
+	m_readAheadFrames = m_advisedUntil = 0;
+
+	m_file.setFileName(m_fileName);
+
+	if (!m_file.open(QIODevice::ReadOnly)) {
+		qWarning("MMapAudioReader::Could not open soundfile (%s)", QS_C(m_fileName));
+		return;
+	}
+
+	if (!parse_header(m_file, m_format)) {
+		return;
+	}
+
+	m_map = m_file.map(0, m_format.dataOffset + m_format.dataSize);
+
+	if (!m_map) {
+		PMESG("MMapAudioReader::Could not map soundfile (%s)", QS_C(m_fileName));
+		return;
+	}
+
+	m_data = m_map + m_format.dataOffset;
+	m_frameSize = m_format.bytesPerSample * m_format.channels;
+	m_channels = m_format.channels;
+	m_rate = m_format.rate;
+	m_nframes = nframes_t(m_format.dataSize / m_frameSize);
+	m_length = TimeRef(m_nframes, m_rate);
+	m_readAheadFrames = m_rate * READ_AHEAD_SECONDS;
+
+#if defined (Q_OS_UNIX)
+	madvise(m_map, size_t(m_format.dataOffset + m_format.dataSize), MADV_SEQUENTIAL);
+#endif
+	advise_read_ahead(0);
+}
+
+
+MMapAudioReader::~MMapAudioReader()
+{
+	if (m_map) {
+		m_file.unmap(m_map);
+	}
+}
+
+
+bool MMapAudioReader::can_decode(const QString& filename)
+{
+	QFile file(filename);
+
+	if (!file.open(QIODevice::ReadOnly)) {
+		return false;
+	}
+
+	PCMFormat format;
+
+	return parse_header(file, format);
+}
+
+
+bool MMapAudioReader::parse_header(QFile& file, PCMFormat& format)
+{
+	QByteArray id = file.peek(12);
+
+	if (id.size() < 12) {
+		return false;
+	}
+
+	bool valid = false;
+
+	if (id.startsWith("RIFF") && id.mid(8, 4) == "WAVE") {
+		valid = parse_wav_header(file, format);
+	} else if (id.startsWith("FORM") && (id.mid(8, 4) == "AIFF" || id.mid(8, 4) == "AIFC")) {
+		valid = parse_aiff_header(file, format);
+	}
+
+	if (!valid || format.channels == 0 || format.rate == 0) {
+		return false;
+	}
+
+	// Only 16, 24 and 32 bit integer and 32 bit float samples are handled here
+	if (format.isFloat) {
+		if (format.bytesPerSample != 4) {
+			return false;
+		}
+	} else if (format.bytesPerSample < 2 || format.bytesPerSample > 4) {
+		return false;
+	}
+
+	// Truncated files (e.g. from a crashed recording) report a too large data chunk
+	qint64 available = file.size() - format.dataOffset;
+	if (format.dataSize > available) {
+		format.dataSize = available;
+	}
+	format.dataSize -= format.dataSize % (format.bytesPerSample * format.channels);
+
+	return format.dataSize > 0;
+}
+
+
+bool MMapAudioReader::parse_wav_header(QFile& file, PCMFormat& format)
+{
+	bool haveFormat = false;
+	qint64 pos = 12;
+
+	format.isBigEndian = false;
+
+	while (pos + 8 <= file.size()) {
+		file.seek(pos);
+		QByteArray chunk = file.read(8);
+		if (chunk.size() < 8) {
+			return false;
+		}
+
+		const uchar* header = reinterpret_cast<const uchar*>(chunk.constData());
+		qint64 chunkSize = read_le(header + 4, 4);
+
+		if (chunk.startsWith("fmt ")) {
+			QByteArray fmt = file.read(qMin(chunkSize, qint64(40)));
+			if (fmt.size() < 16) {
+				return false;
+			}
+
+			const uchar* p = reinterpret_cast<const uchar*>(fmt.constData());
+			uint formatTag = read_le(p, 2);
+			format.channels = read_le(p + 2, 2);
+			format.rate = read_le(p + 4, 4);
+			uint blockAlign = read_le(p + 12, 2);
+			uint bitsPerSample = read_le(p + 14, 2);
+
+			if (formatTag == WAVE_FORMAT_EXTENSIBLE) {
+				if (fmt.size() < 26) {
+					return false;
+				}
+				// The first 2 bytes of the sub format GUID hold the format tag
+				formatTag = read_le(p + 24, 2);
+			}
+
+			if (formatTag != WAVE_FORMAT_PCM && formatTag != WAVE_FORMAT_IEEE_FLOAT) {
+				return false;
+			}
+
+			format.isFloat = (formatTag == WAVE_FORMAT_IEEE_FLOAT);
+			format.bytesPerSample = format.channels ? blockAlign / format.channels : 0;
+
+			// Samples have to be stored in containers of exactly their own size
+			if (format.bytesPerSample * 8 != bitsPerSample) {
+				return false;
+			}
+
+			haveFormat = true;
+		} else if (chunk.startsWith("data")) {
+			format.dataOffset = pos + 8;
+			format.dataSize = chunkSize;
+			return haveFormat;
+		}
+
+		// chunks are word aligned
+		pos += 8 + chunkSize + (chunkSize & 1);
+	}
+
+	return false;
+}
+
+
+bool MMapAudioReader::parse_aiff_header(QFile& file, PCMFormat& format)
+{
+	bool haveFormat = false;
+	bool isAifc = (file.peek(12).mid(8, 4) == "AIFC");
+	qint64 pos = 12;
+
+	format.isBigEndian = true;
+	format.isFloat = false;
+
+	while (pos + 8 <= file.size()) {
+		file.seek(pos);
+		QByteArray chunk = file.read(8);
+		if (chunk.size() < 8) {
+			return false;
+		}
+
+		const uchar* header = reinterpret_cast<const uchar*>(chunk.constData());
+		qint64 chunkSize = read_be(header + 4, 4);
+
+		if (chunk.startsWith("COMM")) {
+			QByteArray comm = file.read(qMin(chunkSize, qint64(22)));
+			if (comm.size() < 18) {
+				return false;
+			}
+
+			const uchar* p = reinterpret_cast<const uchar*>(comm.constData());
+			format.channels = read_be(p, 2);
+			uint bitsPerSample = read_be(p + 6, 2);
+			format.rate = uint(read_be_extended(p + 8));
+			format.bytesPerSample = (bitsPerSample + 7) / 8;
+
+			if (format.bytesPerSample * 8 != bitsPerSample) {
+				return false;
+			}
+
+			if (isAifc) {
+				if (comm.size() < 22) {
+					return false;
+				}
+				QByteArray compression = comm.mid(18, 4);
+				if (compression == "sowt") {
+					format.isBigEndian = false;
+				} else if (compression == "fl32" || compression == "FL32") {
+					format.isFloat = true;
+				} else if (compression != "NONE") {
+					return false;
+				}
+			}
+
+			haveFormat = true;
+		} else if (chunk.startsWith("SSND")) {
+			QByteArray ssnd = file.read(8);
+			if (ssnd.size() < 8) {
+				return false;
+			}
+			qint64 offset = read_be(reinterpret_cast<const uchar*>(ssnd.constData()), 4);
+			format.dataOffset = pos + 16 + offset;
+			format.dataSize = chunkSize - 8 - offset;
+			return haveFormat;
+		}
+
+		pos += 8 + chunkSize + (chunkSize & 1);
+	}
+
+	return false;
+}
+
+
+// Ask the kernel to read in the pages for the next READ_AHEAD_SECONDS
+// of audio, starting at start. Called on seek, and when the read position
+// passed half of the previously advised range.
+void MMapAudioReader::advise_read_ahead(nframes_t start)
+{
+	nframes_t end = qMin(m_nframes, start + m_readAheadFrames);
+	m_advisedUntil = end;
+
+#if defined (Q_OS_UNIX)
+	if (end <= start) {
+		return;
+	}
+
+	static const quintptr pageSize = quintptr(sysconf(_SC_PAGESIZE));
+
+	quintptr first = quintptr(m_data + qint64(start) * m_frameSize) & ~(pageSize - 1);
+	quintptr last = quintptr(m_data + qint64(end) * m_frameSize);
+
+	madvise(reinterpret_cast<void*>(first), size_t(last - first), MADV_WILLNEED);
+#endif
+}
+
+
+bool MMapAudioReader::seek_private(nframes_t start)
+{
+	Q_ASSERT(m_data);
+
+	if (start >= m_nframes) {
+		return false;
+	}
+
+	advise_read_ahead(start);
+
+	return true;
+}
+
+
+void MMapAudioReader::convert(const uchar* src, audio_sample_t** dest, nframes_t frameCount)
+{
+	const uint channels = m_format.channels;
+
+	if (m_format.isFloat) {
+		if (m_format.isBigEndian) {
+			deinterleave<4, true, true>(src, dest, channels, frameCount);
+		} else {
+			deinterleave<4, false, true>(src, dest, channels, frameCount);
+		}
+		return;
+	}
+
+	switch (m_format.bytesPerSample) {
+		case 2:
+			if (m_format.isBigEndian) {
+				deinterleave<2, true, false>(src, dest, channels, frameCount);
+			} else {
+				deinterleave<2, false, false>(src, dest, channels, frameCount);
+			}
+			break;
+		case 3:
+			if (m_format.isBigEndian) {
+				deinterleave<3, true, false>(src, dest, channels, frameCount);
+			} else {
+				deinterleave<3, false, false>(src, dest, channels, frameCount);
+			}
+			break;
+		case 4:
+			if (m_format.isBigEndian) {
+				deinterleave<4, true, false>(src, dest, channels, frameCount);
+			} else {
+				deinterleave<4, false, false>(src, dest, channels, frameCount);
+			}
+			break;
+	}
+}
+
+
+nframes_t MMapAudioReader::read_direct_private(audio_sample_t** dest, nframes_t frameCount)
+{
+	Q_ASSERT(m_data);
+
+	if (frameCount > m_nframes - m_readPos) {
+		frameCount = m_nframes - m_readPos;
+	}
+
+	if (m_readPos + frameCount > m_advisedUntil - m_readAheadFrames / 2) {
+		advise_read_ahead(m_readPos + frameCount);
+	}
+
+	convert(m_data + qint64(m_readPos) * m_frameSize, dest, frameCount);
+
+	return frameCount;
+}
+
+
+nframes_t MMapAudioReader::read_private(DecodeBuffer* buffer, nframes_t frameCount)
+{
+	// The DecodeBuffer destination buffers are filled directly,
+	// there is no need to go through the interleaved readBuffer
+	return read_direct_private(buffer->destination, frameCount);
+}
@@ -0,0 +1,74 @@
+/*
+Copyright (C) 2026 The Traverso developers
+
+This file is part of Traverso
+
+Traverso is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.
+
+*/
+
+#ifndef MMAPAUDIOREADER_H
+#define MMAPAUDIOREADER_H
+
+#include <AbstractAudioReader.h>
+
+#include <QFile>
+
+/// Reader for uncompressed WAV and AIFF files (16/24/32 bit integer and
+/// 32 bit float PCM), converting straight from the memory mapped file.
+class MMapAudioReader : public AbstractAudioReader
+{
+public:
+	MMapAudioReader(const QString &filename);
+	~MMapAudioReader();
+
+	QString decoder_type() const {return "mmap";}
+	bool can_read_direct() const {return m_data != nullptr;}
+
+	static bool can_decode(const QString& filename);
+
+protected:
+	bool seek_private(nframes_t start);
+	nframes_t read_private(DecodeBuffer* buffer, nframes_t frameCount);
+	nframes_t read_direct_private(audio_sample_t** dest, nframes_t frameCount);
+
+private:
+	struct PCMFormat {
+		qint64	dataOffset;
+		qint64	dataSize;
+		uint	channels;
+		uint	rate;
+		uint	bytesPerSample;
+		bool	isFloat;
+		bool	isBigEndian;
+	};
+
+	QFile		m_file;
+	uchar*		m_map;
+	const uchar*	m_data;
+	PCMFormat	m_format{};
+	uint		m_frameSize;
+	nframes_t	m_readAheadFrames;
+	nframes_t	m_advisedUntil;
+
+	void advise_read_ahead(nframes_t start);
+	void convert(const uchar* src, audio_sample_t** dest, nframes_t frameCount);
+
+	static bool parse_header(QFile& file, PCMFormat& format);
+	static bool parse_wav_header(QFile& file, PCMFormat& format);
+	static bool parse_aiff_header(QFile& file, PCMFormat& format);
+};
+
+#endif
@@ -23,6 +23,9 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.
 
 #include "MadAudioReader.h"
 #include <QFile>
+#include <QFileInfo>
+#include <QDataStream>
+#include <QDateTime>
 #include <QString>
 #include <QVector>
 
@@ -37,6 +40,14 @@ RELAYTOOL_MAD;
 
 static const int INPUT_BUFFER_SIZE = 5*8192;
 
+// Seek table files, stored next to the peak files
+static const quint32 SEEK_TABLE_MAGIC = 0x544d5354;	// "TMST"
+static const quint32 SEEK_TABLE_VERSION = 1;
+
+// Decoder delay of the mp3 synthesis filter bank, on top of the encoder delay
+// which is stored in the LAME tag
+static const nframes_t DECODER_DELAY = 529;
+
 
 K3bMad::K3bMad()
   : m_madStructuresInitialized(false),
@@ -408,13 +419,19 @@ public:
         outputSize = 0;
         overflowSize = 0;
         overflowStart = 0;
+        samplesPerFrame = 1152;
+        startSkip = 0;
 
         mad_header_init( &firstHeader );
     }
 
     K3bMad* handle{};
 
-    QVector<unsigned long long> seekPositions;
+    // file position of each mp3 frame holding audio
+    QVector<quint64> seekPositions;
+    nframes_t	samplesPerFrame;
+    // encoder and decoder delay, skipped when reading from the start
+    nframes_t	startSkip;
 
     bool bOutputFinished{};
 
@@ -440,7 +457,13 @@ MadAudioReader::MadAudioReader(const QString& filename)
 
     initDecoderInternal();
 
-    m_nframes = countFrames();
+    // Scanning all frames of a long mp3 takes a while, so the result is stored
+    if (!loadSeekTable()) {
+        m_nframes = countFrames();
+        if (m_nframes > 0) {
+            saveSeekTable();
+        }
+    }
 
     switch( d->firstHeader.mode ) {
         case MAD_MODE_SINGLE_CHANNEL:
@@ -599,16 +622,16 @@ bool MadAudioReader::seek_private(nframes_t start)
     }
 
     //
-    // search a position
-    // This is all hacking, I don't really know what I am doing here... ;)
+    // Each mp3 frame holds samplesPerFrame frames, so the seek table gives
+    // us the exact mp3 frame, and the offset of start within it.
     //
-    double mp3FrameSecs = static_cast<double>(d->firstHeader.duration.seconds) + static_cast<double>(d->firstHeader.duration.fraction) / static_cast<double>(MAD_TIMER_RESOLUTION);
-
-    double posSecs = static_cast<double>(start) / m_rate;
+    quint64 position = quint64(start) + d->startSkip;
+    unsigned int frame = static_cast<unsigned int>(position / d->samplesPerFrame);
+    nframes_t frameOffset = static_cast<nframes_t>(position % d->samplesPerFrame);
 
-    // seekPosition to seek after frame i
-    unsigned int frame = static_cast<unsigned int>(posSecs / mp3FrameSecs);
-    nframes_t frameOffset = (nframes_t)(start - (frame * mp3FrameSecs * m_rate + 0.5));
+    if (frame >= static_cast<unsigned int>(d->seekPositions.size())) {
+        return false;
+    }
 
     // K3b source: Rob said: 29 frames is the theoretically max frame reservoir limit
     // (whatever that means...) it seems that mad needs at most 29 frames to get ready
@@ -618,10 +641,8 @@ bool MadAudioReader::seek_private(nframes_t start)
     // that 3 frames (1 + 2 extra) is enough... much faster, and seems to work fine...
     unsigned int frameReservoirProtect = (frame > 3 ? 3 : frame);
 
-    frame -= frameReservoirProtect;
-
     // seek in the input file behind the already decoded data
-    d->handle->inputSeek( d->seekPositions[frame] );
+    d->handle->inputSeek( d->seekPositions[frame - frameReservoirProtect] );
 
     // decode some frames ignoring MAD_ERROR_BADDATAPTR errors
     unsigned int i = 1;
@@ -657,15 +678,25 @@ bool MadAudioReader::seek_private(nframes_t start)
     d->overflowStart = 0;
     d->overflowSize = 0;
 
-    // Seek to exact traverso frame, within this mp3 frame
+    // Seek to exact traverso frame, within this mp3 frame. The frames above
+    // only prepared the decoder, the one holding start still has to be decoded.
     if (frameOffset > 0) {
         //printf("seekOffset: %lu (start: %lu)\n", frameOffset, start);
+        if (!d->handle->decodeNextFrame()) {
+            return false;
+        }
+        mad_synth_frame( d->handle->madSynth, d->handle->madFrame );
+
         d->outputBuffers = nullptr; // Zeros so that we write to overflow
         d->outputSize = 0;
         d->outputPos = 0;
         createPcmSamples(d->handle->madSynth);
+        if (d->overflowSize <= frameOffset) {
+            d->overflowSize = 0;
+            return true;
+        }
         d->overflowStart = frameOffset;
-        d->overflowSize -= frameOffset;
+        d->overflowSize = qMin(d->overflowSize - frameOffset, m_nframes - start);
     }
 
     return true;
@@ -696,40 +727,161 @@ bool MadAudioReader::initDecoderInternal()
 
 unsigned long MadAudioReader::countFrames()
 {
-    unsigned long frames = 0;
-    bool error = false;
-    d->vbr = false;
     bool bFirstHeaderSaved = false;
+    nframes_t endPadding = 0;
+    d->vbr = false;
+    d->startSkip = 0;
 
     d->seekPositions.clear();
 
-    while (!error && d->handle->findNextHeader()) {
+    while (d->handle->findNextHeader()) {
+        //
+        // position in stream: position in file minus the not yet used buffer
+        //
+        quint64 seekPos = d->handle->inputPos() -
+        (d->handle->madStream->bufend - d->handle->madStream->this_frame + 1);
+
         if (!bFirstHeaderSaved) {
             bFirstHeaderSaved = true;
             d->firstHeader = d->handle->madFrame->header;
+            d->samplesPerFrame = 32 * MAD_NSBSAMPLES(&d->firstHeader);
+
+            // The Xing/Info frame holds no audio, leave it out
+            if (parseXingFrame(&endPadding)) {
+                continue;
+            }
         }
         else if (d->handle->madFrame->header.bitrate != d->firstHeader.bitrate) {
             d->vbr = true;
         }
-        //
-        // position in stream: position in file minus the not yet used buffer
-        //
-        unsigned long long seekPos = d->handle->inputPos() -
-        (d->handle->madStream->bufend - d->handle->madStream->this_frame + 1);
 
         // save the number of bytes to be read to decode i-1 frames at position i
         // in other words: when seeking to seekPos the next decoded frame will be i
         d->seekPositions.append(seekPos);
     }
 
-    if (!d->handle->inputError() && !error) {
-        frames =  d->firstHeader.samplerate * (d->handle->madTimer->seconds + (unsigned long)(
-            (float)d->handle->madTimer->fraction/(float)MAD_TIMER_RESOLUTION));
-    }
+    bool error = d->handle->inputError();
 
     d->handle->cleanup();
 
-    return frames;
+    quint64 frames = quint64(d->seekPositions.size()) * d->samplesPerFrame;
+
+    if (error || frames <= d->startSkip + endPadding) {
+        return 0;
+    }
+
+    return frames - d->startSkip - endPadding;
+}
+
+
+// Checks if the current frame is a Xing/Info frame, as written by most encoders
+// at the start of the stream. If it contains a LAME tag, the encoder delay and
+// padding are used to trim the decoded audio to the original length.
+bool MadAudioReader::parseXingFrame(nframes_t* endPadding)
+{
+    const unsigned char* frame = d->handle->madStream->this_frame;
+    const unsigned char* end = d->handle->madStream->next_frame;
+
+    if (!end || end > d->handle->madStream->bufend) {
+        end = d->handle->madStream->bufend;
+    }
+
+    // The tag follows the side info, which is at most 32 bytes
+    const unsigned char* tag = nullptr;
+    for (const unsigned char* p = frame + 4; p + 8 <= end && p < frame + 48; ++p) {
+        if (!memcmp(p, "Xing", 4) || !memcmp(p, "Info", 4)) {
+            tag = p;
+            break;
+        }
+    }
+
+    if (!tag) {
+        return false;
+    }
+
+    quint32 flags = (tag[4] << 24) | (tag[5] << 16) | (tag[6] << 8) | tag[7];
+    const unsigned char* lame = tag + 8;
+    if (flags & 0x1) lame += 4;	// frame count
+    if (flags & 0x2) lame += 4;	// byte count
+    if (flags & 0x4) lame += 100;	// toc
+    if (flags & 0x8) lame += 4;	// quality
+
+    // 9 bytes encoder version, 12 bytes we don't need, then 12 bits each for delay and padding
+    if (lame + 24 <= end && (!memcmp(lame, "LAME", 4) || !memcmp(lame, "Lavc", 4) || !memcmp(lame, "Lavf", 4))) {
+        nframes_t delay = (lame[21] << 4) | (lame[22] >> 4);
+        nframes_t padding = ((lame[22] & 0x0f) << 8) | lame[23];
+
+        d->startSkip = delay + DECODER_DELAY;
+        *endPadding = padding > DECODER_DELAY ? padding - DECODER_DELAY : 0;
+    }
+
+    return true;
+}
+
+
+bool MadAudioReader::loadSeekTable()
+{
+    QString fileName = index_file_name("seektable");
+    if (fileName.isEmpty()) {
+        return false;
+    }
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QFileInfo source(m_fileName);
+    QDataStream stream(&file);
+    quint32 magic, version, samplerate, mode, samplesPerFrame, startSkip, nframes;
+    qint64 size, modified;
+
+    stream >> magic >> version >> size >> modified;
+
+    // Rebuild it if the source changed
+    if (stream.status() != QDataStream::Ok || magic != SEEK_TABLE_MAGIC || version != SEEK_TABLE_VERSION ||
+        size != source.size() || modified != source.lastModified().toMSecsSinceEpoch()) {
+        return false;
+    }
+
+    stream >> samplerate >> mode >> samplesPerFrame >> startSkip >> nframes >> d->seekPositions;
+
+    if (stream.status() != QDataStream::Ok || samplesPerFrame == 0 || d->seekPositions.isEmpty()) {
+        d->seekPositions.clear();
+        return false;
+    }
+
+    d->firstHeader.samplerate = samplerate;
+    d->firstHeader.mode = static_cast<enum mad_mode>(mode);
+    d->samplesPerFrame = samplesPerFrame;
+    d->startSkip = startSkip;
+    m_nframes = nframes;
+
+    return true;
+}
+
+
+void MadAudioReader::saveSeekTable()
+{
+    QString fileName = index_file_name("seektable");
+    if (fileName.isEmpty()) {
+        return;
+    }
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        PWARN(QString("Couldn't open seek table file %1 for writing").arg(fileName).toLatin1().data());
+        return;
+    }
+
+    QFileInfo source(m_fileName);
+    QDataStream stream(&file);
+
+    stream << SEEK_TABLE_MAGIC << SEEK_TABLE_VERSION
+           << qint64(source.size()) << qint64(source.lastModified().toMSecsSinceEpoch())
+           << quint32(d->firstHeader.samplerate) << quint32(d->firstHeader.mode)
+           << quint32(d->samplesPerFrame) << quint32(d->startSkip) << quint32(m_nframes)
+           << d->seekPositions;
 }
 
 
@@ -118,6 +118,9 @@ protected:
 	void create_buffers();
 	bool initDecoderInternal();
 	unsigned long countFrames();
+	bool parseXingFrame(nframes_t* endPadding);
+	bool loadSeekTable();
+	void saveSeekTable();
 	bool createPcmSamples(mad_synth* synth);
 	
 	static int	MaxAllowedRecoverableErrors;
@@ -35,6 +35,7 @@ ResampleAudioReader::ResampleAudioReader(const QString& filename, const QString&
 	: AbstractAudioReader(filename)
 {
 	m_reader = AbstractAudioReader::create_audio_reader(filename, decoder);
+	m_cacheReader = nullptr;
 	if (!m_reader) {
 		PERROR("ResampleAudioReader: couldn't create AudioReader");
 		m_channels = m_nframes = 0;
@@ -62,6 +63,10 @@ ResampleAudioReader::~ResampleAudioReader()
 		delete m_reader;
 	}
 	
+	if (m_cacheReader) {
+		delete m_cacheReader;
+	}
+	
 	while (m_srcStates.size()) {
 		src_delete(m_srcStates.back());
 		m_srcStates.pop_back();
@@ -170,16 +175,46 @@ void ResampleAudioReader::set_output_rate(uint rate)
 	m_nframes = file_to_resampled_frame(m_reader->get_nframes());
 	m_length = TimeRef(m_nframes, m_outputRate);
 	
+	// The cached copy is no good at another rate
+	if (m_cacheReader && m_cacheReader->get_file_rate() != m_outputRate) {
+		delete m_cacheReader;
+		m_cacheReader = nullptr;
+	}
+	
 	reset();
 }
 
 
+// Takes ownership of reader if it can be used instead of the child
+// AudioReader, i.e. it has the same audio at our output rate
+bool ResampleAudioReader::set_cache_reader(AbstractAudioReader* reader)
+{
+	if (reader->get_file_rate() != m_outputRate || reader->get_num_channels() != m_channels ||
+	    reader->get_nframes() < m_nframes) {
+		return false;
+	}
+	
+	if (!reader->seek(m_readPos)) {
+		return false;
+	}
+	
+	delete m_cacheReader;
+	m_cacheReader = reader;
+	
+	return true;
+}
+
+
 // if no conversion is necessary, pass the seek straight to the child AudioReader,
 // otherwise convert and seek
 bool ResampleAudioReader::seek_private(nframes_t start)
 {
 	Q_ASSERT(m_reader);
 	
+	if (m_cacheReader) {
+		return m_cacheReader->seek(start);
+	}
+	
 	if (m_outputRate == m_rate || !m_isResampleAvailable) {
 		return m_reader->seek(start);
 	}
@@ -196,6 +231,10 @@ nframes_t ResampleAudioReader::read_private(DecodeBuffer* buffer, nframes_t fram
 {
 	Q_ASSERT(m_reader);
 	
+	if (m_cacheReader) {
+		return m_cacheReader->read(buffer, qMin(frameCount, m_nframes - m_readPos));
+	}
+	
 	// pass through if not changing sampleRate.
 	if (m_outputRate == m_rate || !m_isResampleAvailable) {
 		return m_reader->read(buffer, frameCount);
@@ -308,6 +347,30 @@ nframes_t ResampleAudioReader::read_private(DecodeBuffer* buffer, nframes_t fram
 }
 
 
+// Direct reads are only possible when no conversion is necessary,
+// and the child AudioReader supports them
+bool ResampleAudioReader::can_read_direct() const
+{
+	if (m_cacheReader) {
+		return m_cacheReader->can_read_direct();
+	}
+	
+	return m_reader && m_reader->can_read_direct() && (m_outputRate == m_rate || !m_isResampleAvailable);
+}
+
+
+nframes_t ResampleAudioReader::read_direct_private(audio_sample_t** dest, nframes_t frameCount)
+{
+	Q_ASSERT(m_reader);
+	
+	if (m_cacheReader) {
+		return m_cacheReader->read_direct(dest, qMin(frameCount, m_nframes - m_readPos));
+	}
+	
+	return m_reader->read_direct(dest, frameCount);
+}
+
+
 nframes_t ResampleAudioReader::resampled_to_file_frame(nframes_t frame)
 {
 	TimeRef location(frame, m_outputRate);
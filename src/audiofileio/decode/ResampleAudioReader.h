@@ -43,6 +43,7 @@ public:
 	}
 	QString decoder_type() const {return (m_reader) ? m_reader->decoder_type() : "";}
 	void clear_buffers();
+	bool can_read_direct() const;
 	
 	uint get_output_rate();
 	uint get_file_rate();
@@ -50,17 +51,21 @@ public:
 	void set_output_rate(uint rate);
 	void set_converter_type(int converter_type);
 	void set_resample_decode_buffer(DecodeBuffer* buffer);
+	bool set_cache_reader(AbstractAudioReader* reader);
 	
 protected:
 	void reset();
 	
 	bool seek_private(nframes_t start);
 	nframes_t read_private(DecodeBuffer* buffer, nframes_t frameCount);
+	nframes_t read_direct_private(audio_sample_t** dest, nframes_t frameCount);
 	
 	nframes_t resampled_to_file_frame(nframes_t frame);
 	nframes_t file_to_resampled_frame(nframes_t frame);
 	
 	AbstractAudioReader*	m_reader;
+	// Reader of a copy of our file at the output rate, used instead of m_reader
+	AbstractAudioReader*	m_cacheReader;
 	QVector<SRC_STATE*>	m_srcStates;
 	SRC_DATA		m_srcData{};
 	audio_sample_t**	m_overflowBuffers;
@@ -23,6 +23,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.
 #include <QString>
 
 #include "Utils.h"
+#include "Mixer.h"
 // Always put me below _all_ includes, this is needed
 // in case we run with memory leak detection enabled!
 #include "Debugger.h"
@@ -128,11 +129,7 @@ nframes_t SFAudioReader::read_private(DecodeBuffer* buffer, nframes_t frameCount
 			memcpy(buffer->destination[0], buffer->readBuffer, framesRead * sizeof(audio_sample_t));
 			break;	
 		case 2:
-			for (int f = 0; f < framesRead; f++) {
-				int pos = f*2;
-				buffer->destination[0][f] = buffer->readBuffer[pos];
-				buffer->destination[1][f] = buffer->readBuffer[pos + 1];
-			}
+			Mixer::deinterleave_stereo(buffer->destination[0], buffer->destination[1], buffer->readBuffer, framesRead);
 			break;	
 		default:
 			for (int f = 0; f < framesRead; f++) {
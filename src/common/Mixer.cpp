@@ -28,6 +28,14 @@ Mixer::compute_peak_t			Mixer::compute_peak 		= nullptr;
 Mixer::apply_gain_to_buffer_t		Mixer::apply_gain_to_buffer 	= nullptr;
 Mixer::mix_buffers_with_gain_t		Mixer::mix_buffers_with_gain 	= nullptr;
 Mixer::mix_buffers_no_gain_t		Mixer::mix_buffers_no_gain 	= nullptr;
+Mixer::find_peaks_t			Mixer::find_peaks 		= nullptr;
+Mixer::mix_buffers_with_gain_ramp_t	Mixer::mix_buffers_with_gain_ramp = nullptr;
+Mixer::apply_gain_ramp_t		Mixer::apply_gain_ramp 		= nullptr;
+Mixer::apply_stereo_gain_t		Mixer::apply_stereo_gain 	= nullptr;
+Mixer::interleave_stereo_t		Mixer::interleave_stereo 	= nullptr;
+Mixer::deinterleave_stereo_t		Mixer::deinterleave_stereo 	= nullptr;
+Mixer::convert_to_int16_t		Mixer::convert_to_int16 	= nullptr;
+Mixer::convert_to_int32_t		Mixer::convert_to_int32 	= nullptr;
 
 
 
@@ -60,9 +68,112 @@ void default_mix_buffers_no_gain (audio_sample_t* dst, const audio_sample_t* src
         }
 }
 
+void default_find_peaks (const audio_sample_t* buf, nframes_t nframes, float* min, float* max)
+{
+        float a = *min;
+        float b = *max;
+
+        for (nframes_t i = 0; i < nframes; i++) {
+                if (buf[i] < a) {
+                        a = buf[i];
+                }
+                if (buf[i] > b) {
+                        b = buf[i];
+                }
+        }
+
+        *min = a;
+        *max = b;
+}
+
+void default_mix_buffers_with_gain_ramp (audio_sample_t* dst, const audio_sample_t* src, nframes_t nframes, float startGain, float endGain)
+{
+        if (nframes == 0) {
+                return;
+        }
+
+        float delta = (endGain - startGain) / nframes;
+
+        for (nframes_t i = 0; i < nframes; i++) {
+                dst[i] += src[i] * (startGain + i * delta);
+        }
+}
+
+void default_apply_gain_ramp (audio_sample_t* buf, nframes_t nframes, float startGain, float endGain)
+{
+        if (nframes == 0) {
+                return;
+        }
+
+        float delta = (endGain - startGain) / nframes;
+
+        for (nframes_t i = 0; i < nframes; i++) {
+                buf[i] *= startGain + i * delta;
+        }
+}
+
+void default_apply_stereo_gain (audio_sample_t* left, audio_sample_t* right, nframes_t nframes, float leftGain, float rightGain)
+{
+        for (nframes_t i = 0; i < nframes; i++) {
+                left[i] *= leftGain;
+                right[i] *= rightGain;
+        }
+}
+
+void default_interleave_stereo (audio_sample_t* dst, const audio_sample_t* left, const audio_sample_t* right, nframes_t nframes)
+{
+        for (nframes_t i = 0; i < nframes; i++) {
+                dst[2 * i] = left[i];
+                dst[2 * i + 1] = right[i];
+        }
+}
+
+void default_deinterleave_stereo (audio_sample_t* left, audio_sample_t* right, const audio_sample_t* src, nframes_t nframes)
+{
+        for (nframes_t i = 0; i < nframes; i++) {
+                left[i] = src[2 * i];
+                right[i] = src[2 * i + 1];
+        }
+}
+
+void default_convert_to_int16 (short* dst, const audio_sample_t* src, nframes_t nsamples)
+{
+        for (nframes_t i = 0; i < nsamples; i++) {
+                float y = src[i] * 32768.0f;
+
+                if (y > 32767.0f) {
+                        y = 32767.0f;
+                } else if (y < -32768.0f) {
+                        y = -32768.0f;
+                }
+
+                dst[i] = short(lrintf(y));
+        }
+}
+
+void default_convert_to_int32 (int* dst, const audio_sample_t* src, nframes_t nsamples, int bits)
+{
+        const float scale = int_sample_scale(bits);
+        const float max = int_sample_max(bits);
+        const int shift = 32 - bits;
+
+        for (nframes_t i = 0; i < nsamples; i++) {
+                float y = src[i] * scale;
+
+                if (y > max) {
+                        y = max;
+                } else if (y < -scale) {
+                        y = -scale;
+                }
+
+                dst[i] = int(uint(lrintf(y)) << shift);
+        }
+}
+
 
 #if defined (__APPLE__) && defined (BUILD_VECLIB_OPTIMIZATIONS)
 #include <Accelerate/Accelerate.h>
+#include <algorithm>
 
 float veclib_compute_peak (const audio_sample_t* buf, nframes_t nsamples, float current)
 {
@@ -73,8 +184,11 @@ float veclib_compute_peak (const audio_sample_t* buf, nframes_t nsamples, float
 
 void veclib_find_peaks (const audio_sample_t* buf, nframes_t nframes, float *min, float *max)
 {
-	vDSP_maxv (const_cast<audio_sample_t*>(buf), 1, max, nframes);
-	vDSP_minv (const_cast<audio_sample_t*>(buf), 1, min, nframes);
+	float tmpmax, tmpmin;
+	vDSP_maxv (const_cast<audio_sample_t*>(buf), 1, &tmpmax, nframes);
+	vDSP_minv (const_cast<audio_sample_t*>(buf), 1, &tmpmin, nframes);
+	*max = std::max(*max, tmpmax);
+	*min = std::min(*min, tmpmin);
 }
 
 void veclib_apply_gain_to_buffer (audio_sample_t * buf, nframes_t nframes, float gain)
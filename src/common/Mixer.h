@@ -59,11 +59,41 @@ static inline float coefficient_to_dB (float coeff)
         return 20.0f * log10 (coeff);
 }
 
+// Full scale and highest (exactly representable) float value of a bits wide
+// integer sample, e.g. 32768 and 32767 for 16 bit
+static inline float int_sample_scale (int bits)
+{
+        return float(1u << (bits - 1));
+}
+
+static inline float int_sample_max (int bits)
+{
+        float scale = int_sample_scale(bits);
+        float below = nextafterf(scale, 0.0f);
+        return (scale - 1.0f) < below ? (scale - 1.0f) : below;
+}
+
 
 float default_compute_peak			(const audio_sample_t*  buf, nframes_t nsamples, float current);
 void  default_apply_gain_to_buffer		(audio_sample_t*  buf, nframes_t nframes, float gain);
 void  default_mix_buffers_with_gain		(audio_sample_t*  dst, const audio_sample_t*  src, nframes_t nframes, float gain);
 void  default_mix_buffers_no_gain		(audio_sample_t*  dst, const audio_sample_t*  src, nframes_t nframes);
+// Mixes with a gain linearly going from startGain towards endGain, reaching it on the next frame after the buffer
+void  default_mix_buffers_with_gain_ramp	(audio_sample_t*  dst, const audio_sample_t*  src, nframes_t nframes, float startGain, float endGain);
+// Widens min and max to the lowest and highest sample value in buf
+void  default_find_peaks			(const audio_sample_t*  buf, nframes_t nframes, float* min, float* max);
+// Applies a gain linearly going from startGain towards endGain, reaching it on the next frame after the buffer
+void  default_apply_gain_ramp			(audio_sample_t*  buf, nframes_t nframes, float startGain, float endGain);
+// Applies a gain to both channels of a stereo pair in one pass, e.g. pan and fader gain combined
+void  default_apply_stereo_gain		(audio_sample_t*  left, audio_sample_t*  right, nframes_t nframes, float leftGain, float rightGain);
+// Interleaves a stereo pair into dst, which holds 2 * nframes samples
+void  default_interleave_stereo		(audio_sample_t*  dst, const audio_sample_t*  left, const audio_sample_t*  right, nframes_t nframes);
+// Splits 2 * nframes interleaved samples into a stereo pair
+void  default_deinterleave_stereo		(audio_sample_t*  left, audio_sample_t*  right, const audio_sample_t*  src, nframes_t nframes);
+// Clips and rounds to 16 bit integer samples
+void  default_convert_to_int16			(short*  dst, const audio_sample_t*  src, nframes_t nsamples);
+// Clips and rounds to bits wide integer samples, left aligned in 32 bits
+void  default_convert_to_int32			(int*  dst, const audio_sample_t*  src, nframes_t nsamples, int bits);
 
 
 #if (defined (ARCH_X86) || defined (ARCH_X86_64)) && defined (SSE_OPTIMIZATIONS)
@@ -78,12 +108,59 @@ extern "C"
 }
 #endif
 
+#if (defined (ARCH_X86) || defined (ARCH_X86_64)) && defined (__GNUC__)
+#define MIXER_X86_AVX_KERNELS
+
+/* AVX2 (with FMA) functions */
+float x86_avx2_compute_peak			(const audio_sample_t*  buf, nframes_t nsamples, float current);
+void  x86_avx2_find_peaks			(const audio_sample_t*  buf, nframes_t nframes, float* min, float* max);
+void  x86_avx2_apply_gain_to_buffer		(audio_sample_t*  buf, nframes_t nframes, float gain);
+void  x86_avx2_mix_buffers_with_gain		(audio_sample_t*  dst, const audio_sample_t*  src, nframes_t nframes, float gain);
+void  x86_avx2_mix_buffers_no_gain		(audio_sample_t*  dst, const audio_sample_t*  src, nframes_t nframes);
+void  x86_avx2_mix_buffers_with_gain_ramp	(audio_sample_t*  dst, const audio_sample_t*  src, nframes_t nframes, float startGain, float endGain);
+void  x86_avx2_apply_gain_ramp		(audio_sample_t*  buf, nframes_t nframes, float startGain, float endGain);
+void  x86_avx2_apply_stereo_gain		(audio_sample_t*  left, audio_sample_t*  right, nframes_t nframes, float leftGain, float rightGain);
+void  x86_avx2_interleave_stereo		(audio_sample_t*  dst, const audio_sample_t*  left, const audio_sample_t*  right, nframes_t nframes);
+void  x86_avx2_deinterleave_stereo		(audio_sample_t*  left, audio_sample_t*  right, const audio_sample_t*  src, nframes_t nframes);
+void  x86_avx2_convert_to_int16		(short*  dst, const audio_sample_t*  src, nframes_t nsamples);
+void  x86_avx2_convert_to_int32		(int*  dst, const audio_sample_t*  src, nframes_t nsamples, int bits);
+
+/* AVX-512 functions */
+float x86_avx512_compute_peak			(const audio_sample_t*  buf, nframes_t nsamples, float current);
+void  x86_avx512_find_peaks		(const audio_sample_t*  buf, nframes_t nframes, float* min, float* max);
+void  x86_avx512_apply_gain_to_buffer		(audio_sample_t*  buf, nframes_t nframes, float gain);
+void  x86_avx512_mix_buffers_with_gain		(audio_sample_t*  dst, const audio_sample_t*  src, nframes_t nframes, float gain);
+void  x86_avx512_mix_buffers_no_gain		(audio_sample_t*  dst, const audio_sample_t*  src, nframes_t nframes);
+void  x86_avx512_mix_buffers_with_gain_ramp	(audio_sample_t*  dst, const audio_sample_t*  src, nframes_t nframes, float startGain, float endGain);
+void  x86_avx512_apply_gain_ramp		(audio_sample_t*  buf, nframes_t nframes, float startGain, float endGain);
+void  x86_avx512_apply_stereo_gain		(audio_sample_t*  left, audio_sample_t*  right, nframes_t nframes, float leftGain, float rightGain);
+#endif
+
+#if defined (__ARM_NEON) || defined (__ARM_NEON__)
+#define MIXER_ARM_NEON_KERNELS
+
+/* NEON functions */
+float arm_neon_compute_peak			(const audio_sample_t*  buf, nframes_t nsamples, float current);
+void  arm_neon_find_peaks			(const audio_sample_t*  buf, nframes_t nframes, float* min, float* max);
+void  arm_neon_apply_gain_to_buffer		(audio_sample_t*  buf, nframes_t nframes, float gain);
+void  arm_neon_mix_buffers_with_gain		(audio_sample_t*  dst, const audio_sample_t*  src, nframes_t nframes, float gain);
+void  arm_neon_mix_buffers_no_gain		(audio_sample_t*  dst, const audio_sample_t*  src, nframes_t nframes);
+void  arm_neon_mix_buffers_with_gain_ramp	(audio_sample_t*  dst, const audio_sample_t*  src, nframes_t nframes, float startGain, float endGain);
+void  arm_neon_apply_gain_ramp		(audio_sample_t*  buf, nframes_t nframes, float startGain, float endGain);
+void  arm_neon_apply_stereo_gain		(audio_sample_t*  left, audio_sample_t*  right, nframes_t nframes, float leftGain, float rightGain);
+void  arm_neon_interleave_stereo		(audio_sample_t*  dst, const audio_sample_t*  left, const audio_sample_t*  right, nframes_t nframes);
+void  arm_neon_deinterleave_stereo		(audio_sample_t*  left, audio_sample_t*  right, const audio_sample_t*  src, nframes_t nframes);
+void  arm_neon_convert_to_int16		(short*  dst, const audio_sample_t*  src, nframes_t nsamples);
+void  arm_neon_convert_to_int32		(int*  dst, const audio_sample_t*  src, nframes_t nsamples, int bits);
+#endif
+
 #if defined (__APPLE__)  && defined (BUILD_VECLIB_OPTIMIZATIONS)
 
 float veclib_compute_peak              (const audio_sample_t* buf, nframes_t nsamples, float current);
 void  veclib_apply_gain_to_buffer      (audio_sample_t* buf, nframes_t nframes, float gain);
 void  veclib_mix_buffers_with_gain     (audio_sample_t* dst, const audio_sample_t* src, nframes_t nframes, float gain);
 void  veclib_mix_buffers_no_gain       (audio_sample_t* dst, const audio_sample_t* src, nframes_t nframes);
+void  veclib_find_peaks                (const audio_sample_t* buf, nframes_t nframes, float* min, float* max);
 
 #endif
 
@@ -94,11 +171,27 @@ public:
         typedef void  (*apply_gain_to_buffer_t)		(audio_sample_t* , nframes_t, float);
         typedef void  (*mix_buffers_with_gain_t)	(audio_sample_t* , const audio_sample_t* , nframes_t, float);
         typedef void  (*mix_buffers_no_gain_t)		(audio_sample_t* , const audio_sample_t* , nframes_t);
+        typedef void  (*find_peaks_t)			(const audio_sample_t* , nframes_t, float* , float* );
+        typedef void  (*mix_buffers_with_gain_ramp_t)	(audio_sample_t* , const audio_sample_t* , nframes_t, float, float);
+        typedef void  (*apply_gain_ramp_t)		(audio_sample_t* , nframes_t, float, float);
+        typedef void  (*apply_stereo_gain_t)		(audio_sample_t* , audio_sample_t* , nframes_t, float, float);
+        typedef void  (*interleave_stereo_t)		(audio_sample_t* , const audio_sample_t* , const audio_sample_t* , nframes_t);
+        typedef void  (*deinterleave_stereo_t)		(audio_sample_t* , audio_sample_t* , const audio_sample_t* , nframes_t);
+        typedef void  (*convert_to_int16_t)		(short* , const audio_sample_t* , nframes_t);
+        typedef void  (*convert_to_int32_t)		(int* , const audio_sample_t* , nframes_t, int);
 
         static compute_peak_t		compute_peak;
         static apply_gain_to_buffer_t	apply_gain_to_buffer;
         static mix_buffers_with_gain_t	mix_buffers_with_gain;
         static mix_buffers_no_gain_t	mix_buffers_no_gain;
+        static find_peaks_t		find_peaks;
+        static mix_buffers_with_gain_ramp_t	mix_buffers_with_gain_ramp;
+        static apply_gain_ramp_t	apply_gain_ramp;
+        static apply_stereo_gain_t	apply_stereo_gain;
+        static interleave_stereo_t	interleave_stereo;
+        static deinterleave_stereo_t	deinterleave_stereo;
+        static convert_to_int16_t	convert_to_int16;
+        static convert_to_int32_t	convert_to_int32;
 };
 
 #endif
@@ -0,0 +1,647 @@
+/*
+Copyright (C) 2026 The Traverso developers
+
+This file is part of Traverso
+
+Traverso is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.
+
+*/
+
+/* AVX2, AVX-512 and NEON versions of the Mixer functions.
+ *
+ * The x86 kernels are compiled with per function target attributes, so the
+ * rest of Traverso can still be build for a plain (SSE) x86 cpu. They may only
+ * be called after FPU detected support for them, see Traverso::init_sse().
+ * None of them requires aligned buffers.
+ */
+
+#include "Mixer.h"
+
+#if defined (MIXER_X86_AVX_KERNELS)
+#include <immintrin.h>
+#endif
+
+#if defined (MIXER_ARM_NEON_KERNELS)
+#include <arm_neon.h>
+#endif
+
+
+#if defined (MIXER_X86_AVX_KERNELS)
+
+#define AVX2_TARGET	__attribute__ ((target ("avx2,fma")))
+#define AVX512_TARGET	__attribute__ ((target ("avx512f")))
+
+/* AVX2 SET */
+
+AVX2_TARGET float x86_avx2_compute_peak (const audio_sample_t* buf, nframes_t nsamples, float current)
+{
+	const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+	__m256 peak = _mm256_setzero_ps();
+	nframes_t i = 0;
+
+	for (; i + 8 <= nsamples; i += 8) {
+		peak = _mm256_max_ps(peak, _mm256_and_ps(_mm256_loadu_ps(buf + i), absMask));
+	}
+
+	__m128 peak4 = _mm_max_ps(_mm256_castps256_ps128(peak), _mm256_extractf128_ps(peak, 1));
+	peak4 = _mm_max_ps(peak4, _mm_movehl_ps(peak4, peak4));
+	peak4 = _mm_max_ss(peak4, _mm_shuffle_ps(peak4, peak4, 1));
+
+	current = f_max(current, _mm_cvtss_f32(peak4));
+
+	return default_compute_peak(buf + i, nsamples - i, current);
+}
+
+AVX2_TARGET void x86_avx2_find_peaks (const audio_sample_t* buf, nframes_t nframes, float* min, float* max)
+{
+	__m256 vmin = _mm256_set1_ps(*min);
+	__m256 vmax = _mm256_set1_ps(*max);
+	nframes_t i = 0;
+
+	for (; i + 8 <= nframes; i += 8) {
+		__m256 x = _mm256_loadu_ps(buf + i);
+		vmin = _mm256_min_ps(x, vmin);
+		vmax = _mm256_max_ps(x, vmax);
+	}
+
+	__m128 min4 = _mm_min_ps(_mm256_castps256_ps128(vmin), _mm256_extractf128_ps(vmin, 1));
+	min4 = _mm_min_ps(min4, _mm_movehl_ps(min4, min4));
+	min4 = _mm_min_ss(min4, _mm_shuffle_ps(min4, min4, 1));
+
+	__m128 max4 = _mm_max_ps(_mm256_castps256_ps128(vmax), _mm256_extractf128_ps(vmax, 1));
+	max4 = _mm_max_ps(max4, _mm_movehl_ps(max4, max4));
+	max4 = _mm_max_ss(max4, _mm_shuffle_ps(max4, max4, 1));
+
+	*min = _mm_cvtss_f32(min4);
+	*max = _mm_cvtss_f32(max4);
+
+	default_find_peaks(buf + i, nframes - i, min, max);
+}
+
+AVX2_TARGET void x86_avx2_apply_gain_to_buffer (audio_sample_t* buf, nframes_t nframes, float gain)
+{
+	const __m256 g = _mm256_set1_ps(gain);
+	nframes_t i = 0;
+
+	for (; i + 8 <= nframes; i += 8) {
+		_mm256_storeu_ps(buf + i, _mm256_mul_ps(_mm256_loadu_ps(buf + i), g));
+	}
+
+	for (; i < nframes; ++i) {
+		buf[i] *= gain;
+	}
+}
+
+AVX2_TARGET void x86_avx2_mix_buffers_with_gain (audio_sample_t* dst, const audio_sample_t* src, nframes_t nframes, float gain)
+{
+	const __m256 g = _mm256_set1_ps(gain);
+	nframes_t i = 0;
+
+	for (; i + 8 <= nframes; i += 8) {
+		_mm256_storeu_ps(dst + i, _mm256_fmadd_ps(_mm256_loadu_ps(src + i), g, _mm256_loadu_ps(dst + i)));
+	}
+
+	for (; i < nframes; ++i) {
+		dst[i] += src[i] * gain;
+	}
+}
+
+AVX2_TARGET void x86_avx2_mix_buffers_no_gain (audio_sample_t* dst, const audio_sample_t* src, nframes_t nframes)
+{
+	nframes_t i = 0;
+
+	for (; i + 8 <= nframes; i += 8) {
+		_mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_loadu_ps(dst + i), _mm256_loadu_ps(src + i)));
+	}
+
+	for (; i < nframes; ++i) {
+		dst[i] += src[i];
+	}
+}
+
+AVX2_TARGET void x86_avx2_mix_buffers_with_gain_ramp (audio_sample_t* dst, const audio_sample_t* src, nframes_t nframes, float startGain, float endGain)
+{
+	if (nframes == 0) {
+		return;
+	}
+
+	const float delta = (endGain - startGain) / nframes;
+	const __m256 d = _mm256_set1_ps(delta);
+	const __m256 start = _mm256_set1_ps(startGain);
+	const __m256 step = _mm256_set1_ps(8.0f);
+	__m256 index = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+	nframes_t i = 0;
+
+	for (; i + 8 <= nframes; i += 8) {
+		__m256 g = _mm256_fmadd_ps(index, d, start);
+		_mm256_storeu_ps(dst + i, _mm256_fmadd_ps(_mm256_loadu_ps(src + i), g, _mm256_loadu_ps(dst + i)));
+		index = _mm256_add_ps(index, step);
+	}
+
+	for (; i < nframes; ++i) {
+		dst[i] += src[i] * (startGain + i * delta);
+	}
+}
+
+AVX2_TARGET void x86_avx2_apply_gain_ramp (audio_sample_t* buf, nframes_t nframes, float startGain, float endGain)
+{
+	if (nframes == 0) {
+		return;
+	}
+
+	const float delta = (endGain - startGain) / nframes;
+	const __m256 d = _mm256_set1_ps(delta);
+	const __m256 start = _mm256_set1_ps(startGain);
+	const __m256 step = _mm256_set1_ps(8.0f);
+	__m256 index = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+	nframes_t i = 0;
+
+	for (; i + 8 <= nframes; i += 8) {
+		__m256 g = _mm256_fmadd_ps(index, d, start);
+		_mm256_storeu_ps(buf + i, _mm256_mul_ps(_mm256_loadu_ps(buf + i), g));
+		index = _mm256_add_ps(index, step);
+	}
+
+	for (; i < nframes; ++i) {
+		buf[i] *= startGain + i * delta;
+	}
+}
+
+AVX2_TARGET void x86_avx2_apply_stereo_gain (audio_sample_t* left, audio_sample_t* right, nframes_t nframes, float leftGain, float rightGain)
+{
+	const __m256 lg = _mm256_set1_ps(leftGain);
+	const __m256 rg = _mm256_set1_ps(rightGain);
+	nframes_t i = 0;
+
+	for (; i + 8 <= nframes; i += 8) {
+		_mm256_storeu_ps(left + i, _mm256_mul_ps(_mm256_loadu_ps(left + i), lg));
+		_mm256_storeu_ps(right + i, _mm256_mul_ps(_mm256_loadu_ps(right + i), rg));
+	}
+
+	for (; i < nframes; ++i) {
+		left[i] *= leftGain;
+		right[i] *= rightGain;
+	}
+}
+
+AVX2_TARGET void x86_avx2_interleave_stereo (audio_sample_t* dst, const audio_sample_t* left, const audio_sample_t* right, nframes_t nframes)
+{
+	nframes_t i = 0;
+
+	for (; i + 8 <= nframes; i += 8) {
+		__m256 l = _mm256_loadu_ps(left + i);
+		__m256 r = _mm256_loadu_ps(right + i);
+		// l0 r0 l1 r1 | l4 r4 l5 r5 and l2 r2 l3 r3 | l6 r6 l7 r7
+		__m256 lo = _mm256_unpacklo_ps(l, r);
+		__m256 hi = _mm256_unpackhi_ps(l, r);
+		_mm256_storeu_ps(dst + 2 * i, _mm256_permute2f128_ps(lo, hi, 0x20));
+		_mm256_storeu_ps(dst + 2 * i + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+	}
+
+	default_interleave_stereo(dst + 2 * i, left + i, right + i, nframes - i);
+}
+
+AVX2_TARGET void x86_avx2_deinterleave_stereo (audio_sample_t* left, audio_sample_t* right, const audio_sample_t* src, nframes_t nframes)
+{
+	nframes_t i = 0;
+
+	for (; i + 8 <= nframes; i += 8) {
+		__m256 a = _mm256_loadu_ps(src + 2 * i);
+		__m256 b = _mm256_loadu_ps(src + 2 * i + 8);
+		// l0 r0 l1 r1 | l4 r4 l5 r5 and l2 r2 l3 r3 | l6 r6 l7 r7
+		__m256 lo = _mm256_permute2f128_ps(a, b, 0x20);
+		__m256 hi = _mm256_permute2f128_ps(a, b, 0x31);
+		_mm256_storeu_ps(left + i, _mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0)));
+		_mm256_storeu_ps(right + i, _mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1)));
+	}
+
+	default_deinterleave_stereo(left + i, right + i, src + 2 * i, nframes - i);
+}
+
+AVX2_TARGET void x86_avx2_convert_to_int16 (short* dst, const audio_sample_t* src, nframes_t nsamples)
+{
+	const __m256 scale = _mm256_set1_ps(32768.0f);
+	const __m256 lo = _mm256_set1_ps(-32768.0f);
+	const __m256 hi = _mm256_set1_ps(32767.0f);
+	nframes_t i = 0;
+
+	for (; i + 16 <= nsamples; i += 16) {
+		__m256 a = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(src + i), scale), lo), hi);
+		__m256 b = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(src + i + 8), scale), lo), hi);
+		// packs works per 128 bit lane, put the quarters back in order
+		__m256i packed = _mm256_packs_epi32(_mm256_cvtps_epi32(a), _mm256_cvtps_epi32(b));
+		_mm256_storeu_si256((__m256i*) (dst + i), _mm256_permute4x64_epi64(packed, _MM_SHUFFLE(3, 1, 2, 0)));
+	}
+
+	default_convert_to_int16(dst + i, src + i, nsamples - i);
+}
+
+AVX2_TARGET void x86_avx2_convert_to_int32 (int* dst, const audio_sample_t* src, nframes_t nsamples, int bits)
+{
+	const __m256 scale = _mm256_set1_ps(int_sample_scale(bits));
+	const __m256 lo = _mm256_set1_ps(-int_sample_scale(bits));
+	const __m256 hi = _mm256_set1_ps(int_sample_max(bits));
+	const __m128i shift = _mm_cvtsi32_si128(32 - bits);
+	nframes_t i = 0;
+
+	for (; i + 8 <= nsamples; i += 8) {
+		__m256 y = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(src + i), scale), lo), hi);
+		_mm256_storeu_si256((__m256i*) (dst + i), _mm256_sll_epi32(_mm256_cvtps_epi32(y), shift));
+	}
+
+	default_convert_to_int32(dst + i, src + i, nsamples - i, bits);
+}
+
+
+/* AVX-512 SET, the remainder is handled with masked loads and stores */
+
+static inline AVX512_TARGET __mmask16 avx512_tail_mask (nframes_t remaining)
+{
+	return (__mmask16) ((1u << remaining) - 1);
+}
+
+AVX512_TARGET float x86_avx512_compute_peak (const audio_sample_t* buf, nframes_t nsamples, float current)
+{
+	__m512 peak = _mm512_setzero_ps();
+	nframes_t i = 0;
+
+	for (; i + 16 <= nsamples; i += 16) {
+		peak = _mm512_max_ps(peak, _mm512_abs_ps(_mm512_loadu_ps(buf + i)));
+	}
+
+	if (i < nsamples) {
+		__m512 tail = _mm512_maskz_loadu_ps(avx512_tail_mask(nsamples - i), buf + i);
+		peak = _mm512_max_ps(peak, _mm512_abs_ps(tail));
+	}
+
+	return f_max(current, _mm512_reduce_max_ps(peak));
+}
+
+AVX512_TARGET void x86_avx512_find_peaks (const audio_sample_t* buf, nframes_t nframes, float* min, float* max)
+{
+	__m512 vmin = _mm512_set1_ps(*min);
+	__m512 vmax = _mm512_set1_ps(*max);
+	nframes_t i = 0;
+
+	for (; i + 16 <= nframes; i += 16) {
+		__m512 x = _mm512_loadu_ps(buf + i);
+		vmin = _mm512_min_ps(x, vmin);
+		vmax = _mm512_max_ps(x, vmax);
+	}
+
+	if (i < nframes) {
+		// Lanes past the end keep the current min/max
+		__mmask16 mask = avx512_tail_mask(nframes - i);
+		vmin = _mm512_min_ps(_mm512_mask_loadu_ps(vmin, mask, buf + i), vmin);
+		vmax = _mm512_max_ps(_mm512_mask_loadu_ps(vmax, mask, buf + i), vmax);
+	}
+
+	*min = _mm512_reduce_min_ps(vmin);
+	*max = _mm512_reduce_max_ps(vmax);
+}
+
+AVX512_TARGET void x86_avx512_apply_gain_to_buffer (audio_sample_t* buf, nframes_t nframes, float gain)
+{
+	const __m512 g = _mm512_set1_ps(gain);
+	nframes_t i = 0;
+
+	for (; i + 16 <= nframes; i += 16) {
+		_mm512_storeu_ps(buf + i, _mm512_mul_ps(_mm512_loadu_ps(buf + i), g));
+	}
+
+	if (i < nframes) {
+		__mmask16 mask = avx512_tail_mask(nframes - i);
+		_mm512_mask_storeu_ps(buf + i, mask, _mm512_mul_ps(_mm512_maskz_loadu_ps(mask, buf + i), g));
+	}
+}
+
+AVX512_TARGET void x86_avx512_mix_buffers_with_gain (audio_sample_t* dst, const audio_sample_t* src, nframes_t nframes, float gain)
+{
+	const __m512 g = _mm512_set1_ps(gain);
+	nframes_t i = 0;
+
+	for (; i + 16 <= nframes; i += 16) {
+		_mm512_storeu_ps(dst + i, _mm512_fmadd_ps(_mm512_loadu_ps(src + i), g, _mm512_loadu_ps(dst + i)));
+	}
+
+	if (i < nframes) {
+		__mmask16 mask = avx512_tail_mask(nframes - i);
+		__m512 sum = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, src + i), g, _mm512_maskz_loadu_ps(mask, dst + i));
+		_mm512_mask_storeu_ps(dst + i, mask, sum);
+	}
+}
+
+AVX512_TARGET void x86_avx512_mix_buffers_no_gain (audio_sample_t* dst, const audio_sample_t* src, nframes_t nframes)
+{
+	nframes_t i = 0;
+
+	for (; i + 16 <= nframes; i += 16) {
+		_mm512_storeu_ps(dst + i, _mm512_add_ps(_mm512_loadu_ps(dst + i), _mm512_loadu_ps(src + i)));
+	}
+
+	if (i < nframes) {
+		__mmask16 mask = avx512_tail_mask(nframes - i);
+		__m512 sum = _mm512_add_ps(_mm512_maskz_loadu_ps(mask, dst + i), _mm512_maskz_loadu_ps(mask, src + i));
+		_mm512_mask_storeu_ps(dst + i, mask, sum);
+	}
+}
+
+AVX512_TARGET void x86_avx512_mix_buffers_with_gain_ramp (audio_sample_t* dst, const audio_sample_t* src, nframes_t nframes, float startGain, float endGain)
+{
+	if (nframes == 0) {
+		return;
+	}
+
+	const __m512 d = _mm512_set1_ps((endGain - startGain) / nframes);
+	const __m512 start = _mm512_set1_ps(startGain);
+	const __m512 step = _mm512_set1_ps(16.0f);
+	__m512 index = _mm512_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f,
+				      8.0f, 9.0f, 10.0f, 11.0f, 12.0f, 13.0f, 14.0f, 15.0f);
+	nframes_t i = 0;
+
+	for (; i + 16 <= nframes; i += 16) {
+		__m512 g = _mm512_fmadd_ps(index, d, start);
+		_mm512_storeu_ps(dst + i, _mm512_fmadd_ps(_mm512_loadu_ps(src + i), g, _mm512_loadu_ps(dst + i)));
+		index = _mm512_add_ps(index, step);
+	}
+
+	if (i < nframes) {
+		__mmask16 mask = avx512_tail_mask(nframes - i);
+		__m512 g = _mm512_fmadd_ps(index, d, start);
+		__m512 sum = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, src + i), g, _mm512_maskz_loadu_ps(mask, dst + i));
+		_mm512_mask_storeu_ps(dst + i, mask, sum);
+	}
+}
+
+AVX512_TARGET void x86_avx512_apply_gain_ramp (audio_sample_t* buf, nframes_t nframes, float startGain, float endGain)
+{
+	if (nframes == 0) {
+		return;
+	}
+
+	const __m512 d = _mm512_set1_ps((endGain - startGain) / nframes);
+	const __m512 start = _mm512_set1_ps(startGain);
+	const __m512 step = _mm512_set1_ps(16.0f);
+	__m512 index = _mm512_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f,
+				      8.0f, 9.0f, 10.0f, 11.0f, 12.0f, 13.0f, 14.0f, 15.0f);
+	nframes_t i = 0;
+
+	for (; i + 16 <= nframes; i += 16) {
+		__m512 g = _mm512_fmadd_ps(index, d, start);
+		_mm512_storeu_ps(buf + i, _mm512_mul_ps(_mm512_loadu_ps(buf + i), g));
+		index = _mm512_add_ps(index, step);
+	}
+
+	if (i < nframes) {
+		__mmask16 mask = avx512_tail_mask(nframes - i);
+		__m512 g = _mm512_fmadd_ps(index, d, start);
+		_mm512_mask_storeu_ps(buf + i, mask, _mm512_mul_ps(_mm512_maskz_loadu_ps(mask, buf + i), g));
+	}
+}
+
+AVX512_TARGET void x86_avx512_apply_stereo_gain (audio_sample_t* left, audio_sample_t* right, nframes_t nframes, float leftGain, float rightGain)
+{
+	const __m512 lg = _mm512_set1_ps(leftGain);
+	const __m512 rg = _mm512_set1_ps(rightGain);
+	nframes_t i = 0;
+
+	for (; i + 16 <= nframes; i += 16) {
+		_mm512_storeu_ps(left + i, _mm512_mul_ps(_mm512_loadu_ps(left + i), lg));
+		_mm512_storeu_ps(right + i, _mm512_mul_ps(_mm512_loadu_ps(right + i), rg));
+	}
+
+	if (i < nframes) {
+		__mmask16 mask = avx512_tail_mask(nframes - i);
+		_mm512_mask_storeu_ps(left + i, mask, _mm512_mul_ps(_mm512_maskz_loadu_ps(mask, left + i), lg));
+		_mm512_mask_storeu_ps(right + i, mask, _mm512_mul_ps(_mm512_maskz_loadu_ps(mask, right + i), rg));
+	}
+}
+
+#endif /* MIXER_X86_AVX_KERNELS */
+
+
+#if defined (MIXER_ARM_NEON_KERNELS)
+
+/* NEON SET */
+
+float arm_neon_compute_peak (const audio_sample_t* buf, nframes_t nsamples, float current)
+{
+	float32x4_t peak = vdupq_n_f32(0.0f);
+	nframes_t i = 0;
+
+	for (; i + 4 <= nsamples; i += 4) {
+		peak = vmaxq_f32(peak, vabsq_f32(vld1q_f32(buf + i)));
+	}
+
+	float32x2_t peak2 = vpmax_f32(vget_low_f32(peak), vget_high_f32(peak));
+	peak2 = vpmax_f32(peak2, peak2);
+
+	current = f_max(current, vget_lane_f32(peak2, 0));
+
+	return default_compute_peak(buf + i, nsamples - i, current);
+}
+
+void arm_neon_find_peaks (const audio_sample_t* buf, nframes_t nframes, float* min, float* max)
+{
+	float32x4_t vmin = vdupq_n_f32(*min);
+	float32x4_t vmax = vdupq_n_f32(*max);
+	nframes_t i = 0;
+
+	for (; i + 4 <= nframes; i += 4) {
+		float32x4_t x = vld1q_f32(buf + i);
+		vmin = vminq_f32(x, vmin);
+		vmax = vmaxq_f32(x, vmax);
+	}
+
+	float32x2_t min2 = vpmin_f32(vget_low_f32(vmin), vget_high_f32(vmin));
+	min2 = vpmin_f32(min2, min2);
+	float32x2_t max2 = vpmax_f32(vget_low_f32(vmax), vget_high_f32(vmax));
+	max2 = vpmax_f32(max2, max2);
+
+	*min = vget_lane_f32(min2, 0);
+	*max = vget_lane_f32(max2, 0);
+
+	default_find_peaks(buf + i, nframes - i, min, max);
+}
+
+void arm_neon_apply_gain_to_buffer (audio_sample_t* buf, nframes_t nframes, float gain)
+{
+	nframes_t i = 0;
+
+	for (; i + 4 <= nframes; i += 4) {
+		vst1q_f32(buf + i, vmulq_n_f32(vld1q_f32(buf + i), gain));
+	}
+
+	for (; i < nframes; ++i) {
+		buf[i] *= gain;
+	}
+}
+
+void arm_neon_mix_buffers_with_gain (audio_sample_t* dst, const audio_sample_t* src, nframes_t nframes, float gain)
+{
+	nframes_t i = 0;
+
+	for (; i + 4 <= nframes; i += 4) {
+		vst1q_f32(dst + i, vmlaq_n_f32(vld1q_f32(dst + i), vld1q_f32(src + i), gain));
+	}
+
+	for (; i < nframes; ++i) {
+		dst[i] += src[i] * gain;
+	}
+}
+
+void arm_neon_mix_buffers_no_gain (audio_sample_t* dst, const audio_sample_t* src, nframes_t nframes)
+{
+	nframes_t i = 0;
+
+	for (; i + 4 <= nframes; i += 4) {
+		vst1q_f32(dst + i, vaddq_f32(vld1q_f32(dst + i), vld1q_f32(src + i)));
+	}
+
+	for (; i < nframes; ++i) {
+		dst[i] += src[i];
+	}
+}
+
+void arm_neon_mix_buffers_with_gain_ramp (audio_sample_t* dst, const audio_sample_t* src, nframes_t nframes, float startGain, float endGain)
+{
+	if (nframes == 0) {
+		return;
+	}
+
+	const float delta = (endGain - startGain) / nframes;
+	const float32x4_t start = vdupq_n_f32(startGain);
+	const float32x4_t step = vdupq_n_f32(4.0f);
+	const float initialIndex[4] = {0.0f, 1.0f, 2.0f, 3.0f};
+	float32x4_t index = vld1q_f32(initialIndex);
+	nframes_t i = 0;
+
+	for (; i + 4 <= nframes; i += 4) {
+		float32x4_t g = vmlaq_n_f32(start, index, delta);
+		vst1q_f32(dst + i, vmlaq_f32(vld1q_f32(dst + i), vld1q_f32(src + i), g));
+		index = vaddq_f32(index, step);
+	}
+
+	for (; i < nframes; ++i) {
+		dst[i] += src[i] * (startGain + i * delta);
+	}
+}
+
+void arm_neon_apply_gain_ramp (audio_sample_t* buf, nframes_t nframes, float startGain, float endGain)
+{
+	if (nframes == 0) {
+		return;
+	}
+
+	const float delta = (endGain - startGain) / nframes;
+	const float32x4_t start = vdupq_n_f32(startGain);
+	const float32x4_t step = vdupq_n_f32(4.0f);
+	const float initialIndex[4] = {0.0f, 1.0f, 2.0f, 3.0f};
+	float32x4_t index = vld1q_f32(initialIndex);
+	nframes_t i = 0;
+
+	for (; i + 4 <= nframes; i += 4) {
+		float32x4_t g = vmlaq_n_f32(start, index, delta);
+		vst1q_f32(buf + i, vmulq_f32(vld1q_f32(buf + i), g));
+		index = vaddq_f32(index, step);
+	}
+
+	for (; i < nframes; ++i) {
+		buf[i] *= startGain + i * delta;
+	}
+}
+
+void arm_neon_apply_stereo_gain (audio_sample_t* left, audio_sample_t* right, nframes_t nframes, float leftGain, float rightGain)
+{
+	nframes_t i = 0;
+
+	for (; i + 4 <= nframes; i += 4) {
+		vst1q_f32(left + i, vmulq_n_f32(vld1q_f32(left + i), leftGain));
+		vst1q_f32(right + i, vmulq_n_f32(vld1q_f32(right + i), rightGain));
+	}
+
+	for (; i < nframes; ++i) {
+		left[i] *= leftGain;
+		right[i] *= rightGain;
+	}
+}
+
+void arm_neon_interleave_stereo (audio_sample_t* dst, const audio_sample_t* left, const audio_sample_t* right, nframes_t nframes)
+{
+	nframes_t i = 0;
+
+	for (; i + 4 <= nframes; i += 4) {
+		float32x4x2_t pair;
+		pair.val[0] = vld1q_f32(left + i);
+		pair.val[1] = vld1q_f32(right + i);
+		vst2q_f32(dst + 2 * i, pair);
+	}
+
+	default_interleave_stereo(dst + 2 * i, left + i, right + i, nframes - i);
+}
+
+void arm_neon_deinterleave_stereo (audio_sample_t* left, audio_sample_t* right, const audio_sample_t* src, nframes_t nframes)
+{
+	nframes_t i = 0;
+
+	for (; i + 4 <= nframes; i += 4) {
+		float32x4x2_t pair = vld2q_f32(src + 2 * i);
+		vst1q_f32(left + i, pair.val[0]);
+		vst1q_f32(right + i, pair.val[1]);
+	}
+
+	default_deinterleave_stereo(left + i, right + i, src + 2 * i, nframes - i);
+}
+
+// Rounding to nearest needs ARMv8, 32 bit ARM uses the generic conversion
+
+void arm_neon_convert_to_int16 (short* dst, const audio_sample_t* src, nframes_t nsamples)
+{
+	nframes_t i = 0;
+
+#if defined (__aarch64__)
+	const float32x4_t lo = vdupq_n_f32(-32768.0f);
+	const float32x4_t hi = vdupq_n_f32(32767.0f);
+
+	for (; i + 8 <= nsamples; i += 8) {
+		float32x4_t a = vminq_f32(vmaxq_f32(vmulq_n_f32(vld1q_f32(src + i), 32768.0f), lo), hi);
+		float32x4_t b = vminq_f32(vmaxq_f32(vmulq_n_f32(vld1q_f32(src + i + 4), 32768.0f), lo), hi);
+		vst1q_s16(dst + i, vcombine_s16(vqmovn_s32(vcvtnq_s32_f32(a)), vqmovn_s32(vcvtnq_s32_f32(b))));
+	}
+#endif
+
+	default_convert_to_int16(dst + i, src + i, nsamples - i);
+}
+
+void arm_neon_convert_to_int32 (int* dst, const audio_sample_t* src, nframes_t nsamples, int bits)
+{
+	nframes_t i = 0;
+
+#if defined (__aarch64__)
+	const float scale = int_sample_scale(bits);
+	const float32x4_t lo = vdupq_n_f32(-scale);
+	const float32x4_t hi = vdupq_n_f32(int_sample_max(bits));
+	const int32x4_t shift = vdupq_n_s32(32 - bits);
+
+	for (; i + 4 <= nsamples; i += 4) {
+		float32x4_t y = vminq_f32(vmaxq_f32(vmulq_n_f32(vld1q_f32(src + i), scale), lo), hi);
+		vst1q_s32(dst + i, vshlq_s32(vcvtnq_s32_f32(y), shift));
+	}
+#endif
+
+	default_convert_to_int32(dst + i, src + i, nsamples - i, bits);
+}
+
+#endif /* MIXER_ARM_NEON_KERNELS */
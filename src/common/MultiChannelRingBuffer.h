@@ -0,0 +1,284 @@
+/*
+Copyright (C) 2026 The Traverso developers
+
+This file is part of Traverso
+
+Traverso is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.
+
+*/
+
+#ifndef MULTI_CHANNEL_RINGBUFFER_H
+#define MULTI_CHANNEL_RINGBUFFER_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if ! defined (Q_OS_WIN)
+#include <sys/mman.h>
+#endif
+
+#include "defines.h"
+
+#define MCRB_CACHE_LINE_SIZE 64
+
+/* Single reader / single writer ringbuffer holding the data of several channels.
+ *
+ * All channels share one read and one write pointer, so reading or writing a
+ * cycle for all channels costs one atomic publish. The data lives in one
+ * contiguous, cache line aligned allocation, each channel in it's own cache
+ * line aligned block, so a channel's data can still be copied with one memcpy,
+ * or be decoded into directly using the read/write vectors.
+ *
+ * The element size is not required to be a power of two.
+ */
+
+template<class T>
+class MultiChannelRingBuffer
+{
+  public:
+	MultiChannelRingBuffer (uint channels, size_t sz) {
+		channelCount = channels;
+		size = sz;
+
+		// Round up the channel size, so each channel starts at a cache line
+		size_t elementsPerLine = MCRB_CACHE_LINE_SIZE / sizeof(T);
+		if (elementsPerLine == 0) {
+			elementsPerLine = 1;
+		}
+		stride = ((size + elementsPerLine - 1) / elementsPerLine) * elementsPerLine;
+
+		allocationSize = stride * channelCount * sizeof(T) + MCRB_CACHE_LINE_SIZE;
+		allocation = (char*) malloc(allocationSize);
+		buf = (T*) (((uintptr_t) allocation + MCRB_CACHE_LINE_SIZE - 1) & ~uintptr_t(MCRB_CACHE_LINE_SIZE - 1));
+
+		locked = false;
+#ifdef USE_MLOCK
+		lock_memory();
+#endif /* USE_MLOCK */
+		reset ();
+	};
+
+	virtual ~MultiChannelRingBuffer() {
+#if ! defined (Q_OS_WIN)
+		if (locked) {
+			munlock (allocation, allocationSize);
+		}
+#endif
+		free (allocation);
+	}
+
+	// Locks the (single) allocation into RAM, returns false if that failed
+	bool lock_memory () {
+#if ! defined (Q_OS_WIN)
+		if (!locked && mlock (allocation, allocationSize)) {
+			printf("Unable to lock memory\n");
+			return false;
+		}
+		locked = true;
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	void reset () {
+		/* !!! NOT THREAD SAFE !!! */
+		t_atomic_int_set (&write_ptr, 0);
+		t_atomic_int_set (&read_ptr, 0);
+	}
+
+	size_t  read  (T **dest, size_t cnt);
+	size_t  write (T **src, size_t cnt);
+
+	/* The vectors hold offsets which are valid for all channels,
+	   use channel_buffer(channel) + offset[n] to get the location.
+	*/
+	struct rw_vector {
+	    size_t offset[2];
+	    size_t len[2];
+	};
+
+	void get_read_vector (rw_vector *);
+	void get_write_vector (rw_vector *);
+
+	void increment_read_ptr (size_t cnt) {
+		t_atomic_int_set (&read_ptr, (t_atomic_int_get(&read_ptr) + cnt) % size);
+	}
+
+	void increment_write_ptr (size_t cnt) {
+		t_atomic_int_set (&write_ptr,  (t_atomic_int_get(&write_ptr) + cnt) % size);
+	}
+
+	size_t write_space () const {
+		size_t w, r;
+
+		w = t_atomic_int_get (&write_ptr);
+		r = t_atomic_int_get (&read_ptr);
+
+		if (w > r) {
+			return ((r - w + size) % size) - 1;
+		} else if (w < r) {
+			return (r - w) - 1;
+		} else {
+			return size - 1;
+		}
+	}
+
+	size_t read_space () const {
+		size_t w, r;
+
+		w = t_atomic_int_get (&write_ptr);
+		r = t_atomic_int_get (&read_ptr);
+
+		if (w > r) {
+			return w - r;
+		} else {
+			return (w - r + size) % size;
+		}
+	}
+
+	T *channel_buffer (uint channel) { return buf + channel * stride; }
+	uint channel_count () const { return channelCount; }
+	size_t bufsize () const { return size; }
+
+  protected:
+	T *buf;
+	char *allocation;
+	size_t allocationSize;
+	size_t size;
+	size_t stride;
+	uint channelCount;
+	bool locked;
+
+	// Keep the pointers on their own cache line, they are written by different threads
+	char pad0[MCRB_CACHE_LINE_SIZE];
+	mutable volatile int write_ptr;
+	char pad1[MCRB_CACHE_LINE_SIZE - sizeof(int)];
+	mutable volatile int read_ptr;
+	char pad2[MCRB_CACHE_LINE_SIZE - sizeof(int)];
+
+	void copy_out (T *chanbuf, size_t pos, T *dest, size_t cnt) {
+		size_t n1 = (pos + cnt > size) ? size - pos : cnt;
+		memcpy (dest, &chanbuf[pos], n1 * sizeof (T));
+		if (n1 < cnt) {
+			memcpy (dest + n1, chanbuf, (cnt - n1) * sizeof (T));
+		}
+	}
+
+	void copy_in (T *chanbuf, size_t pos, const T *src, size_t cnt) {
+		size_t n1 = (pos + cnt > size) ? size - pos : cnt;
+		memcpy (&chanbuf[pos], src, n1 * sizeof (T));
+		if (n1 < cnt) {
+			memcpy (chanbuf, src + n1, (cnt - n1) * sizeof (T));
+		}
+	}
+};
+
+template<class T> size_t
+MultiChannelRingBuffer<T>::read (T **dest, size_t cnt)
+{
+	size_t free_cnt;
+	size_t to_read;
+	size_t priv_read_ptr;
+
+	if ((free_cnt = read_space ()) == 0) {
+		return 0;
+	}
+
+	to_read = cnt > free_cnt ? free_cnt : cnt;
+	priv_read_ptr = t_atomic_int_get(&read_ptr);
+
+	for (uint chan = 0; chan < channelCount; ++chan) {
+		copy_out (channel_buffer(chan), priv_read_ptr, dest[chan], to_read);
+	}
+
+	t_atomic_int_set(&read_ptr, (priv_read_ptr + to_read) % size);
+	return to_read;
+}
+
+template<class T> size_t
+MultiChannelRingBuffer<T>::write (T **src, size_t cnt)
+{
+	size_t free_cnt;
+	size_t to_write;
+	size_t priv_write_ptr;
+
+	if ((free_cnt = write_space ()) == 0) {
+		return 0;
+	}
+
+	to_write = cnt > free_cnt ? free_cnt : cnt;
+	priv_write_ptr = t_atomic_int_get(&write_ptr);
+
+	for (uint chan = 0; chan < channelCount; ++chan) {
+		copy_in (channel_buffer(chan), priv_write_ptr, src[chan], to_write);
+	}
+
+	t_atomic_int_set(&write_ptr, (priv_write_ptr + to_write) % size);
+	return to_write;
+}
+
+template<class T> void
+MultiChannelRingBuffer<T>::get_read_vector (MultiChannelRingBuffer<T>::rw_vector *vec)
+{
+	size_t free_cnt = read_space ();
+	size_t r = t_atomic_int_get (&read_ptr);
+	size_t cnt2 = r + free_cnt;
+
+	vec->offset[0] = r;
+
+	if (cnt2 > size) {
+		/* Two part vector: the rest of the buffer after the
+		   current read ptr, plus some from the start of
+		   the buffer.
+		*/
+		vec->len[0] = size - r;
+		vec->offset[1] = 0;
+		vec->len[1] = cnt2 % size;
+	} else {
+		/* Single part vector: just the rest of the buffer */
+		vec->len[0] = free_cnt;
+		vec->offset[1] = 0;
+		vec->len[1] = 0;
+	}
+}
+
+template<class T> void
+MultiChannelRingBuffer<T>::get_write_vector (MultiChannelRingBuffer<T>::rw_vector *vec)
+{
+	size_t free_cnt = write_space ();
+	size_t w = t_atomic_int_get (&write_ptr);
+	size_t cnt2 = w + free_cnt;
+
+	vec->offset[0] = w;
+
+	if (cnt2 > size) {
+		/* Two part vector: the rest of the buffer after the
+		   current write ptr, plus some from the start of
+		   the buffer.
+		*/
+		vec->len[0] = size - w;
+		vec->offset[1] = 0;
+		vec->len[1] = cnt2 % size;
+	} else {
+		vec->len[0] = free_cnt;
+		vec->offset[1] = 0;
+		vec->len[1] = 0;
+	}
+}
+
+#endif /* MULTI_CHANNEL_RINGBUFFER_H */
@@ -27,15 +27,19 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.
 
 #include <fpu.h>
 
+#if (defined (ARCH_X86) || defined (ARCH_X86_64)) && defined (__GNUC__)
+#include <cpuid.h>
+#endif
+
 FPU::FPU ()
 {
         unsigned long cpuflags = 0;
 
         _flags = Flags (0);
 
-#ifndef ARCH_X86
+#if !defined (ARCH_X86) && !defined (ARCH_X86_64)
         return;
-#endif
+#else
 
 #ifndef USE_X86_64_ASM
         asm volatile (
@@ -108,6 +112,47 @@ FPU::FPU ()
                         free (fxbuf);
                 }
         }
+
+        detect_avx ();
+#endif /* ARCH_X86 || ARCH_X86_64 */
+}
+
+void FPU::detect_avx ()
+{
+#if (defined (ARCH_X86) || defined (ARCH_X86_64)) && defined (__GNUC__)
+        unsigned int eax, ebx, ecx, edx;
+
+        if (!__get_cpuid (1, &eax, &ebx, &ecx, &edx)) {
+                return;
+        }
+
+        bool hasFMA = ecx & (1<<12);
+
+        // The OS has to save the ymm/zmm registers on a context switch,
+        // which it signals with OSXSAVE and the xgetbv feature mask
+        if (!(ecx & (1<<27)) || !(ecx & (1<<28))) {
+                return;
+        }
+
+        unsigned int xcr0, xcr0high;
+        asm volatile ("xgetbv" : "=a" (xcr0), "=d" (xcr0high) : "c" (0));
+
+        if ((xcr0 & 0x6) != 0x6) {
+                return;
+        }
+
+        if (!__get_cpuid_count (7, 0, &eax, &ebx, &ecx, &edx)) {
+                return;
+        }
+
+        if ((ebx & (1<<5)) && hasFMA) {
+                _flags = Flags (_flags | HasAVX2);
+        }
+
+        if ((ebx & (1<<16)) && (xcr0 & 0xe6) == 0xe6) {
+                _flags = Flags (_flags | HasAVX512F);
+        }
+#endif
 }
 
 FPU::~FPU ()
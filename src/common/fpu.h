@@ -31,7 +31,9 @@ class FPU {
 		HasFlushToZero = 0x1,
 		HasDenormalsAreZero = 0x2,
 		HasSSE = 0x4,
-		HasSSE2 = 0x8
+		HasSSE2 = 0x8,
+		HasAVX2 = 0x10,
+		HasAVX512F = 0x20
 	};
 
   public:
@@ -42,9 +44,14 @@ class FPU {
 	bool has_denormals_are_zero () const { return _flags & HasDenormalsAreZero; }
 	bool has_sse () const { return _flags & HasSSE; }
 	bool has_sse2 () const { return _flags & HasSSE2; }
+	// Only set if the OS saves the extended registers too, AVX2 implies FMA
+	bool has_avx2 () const { return _flags & HasAVX2; }
+	bool has_avx512f () const { return _flags & HasAVX512F; }
 	
   private:
 	Flags _flags;
+
+	void detect_avx ();
 };
 
 #endif /* __pbd_fpu_h__ */
@@ -437,15 +437,16 @@ int AudioClip::process(nframes_t nframes)
 
     Q_ASSERT(m_readSource);
 
-    AudioBus* bus = m_sheet->get_clip_render_bus();
-    bus->silence_buffers(nframes);
-
     TimeRef mix_pos;
     uint channelcount = get_channel_count();
 
     // since we only use 2 channels, this will do for now
     // FIXME make it future proof so it can deal with any amount of channels?
     audio_sample_t* mixdown[6];
+    // The buffers we render into, they start at the transport location
+    audio_sample_t* buffers[2];
+    uint offset = 0;
+    bool inPlace;
 
     uint framesToProcess = nframes;
 
@@ -460,22 +461,13 @@ int AudioClip::process(nframes_t nframes)
             // Using to_frame() for both the m_trackStartLocation and transportLocation seems to round
             // better then using (m_trackStartLocation - transportLocation).to_frame()
             // TODO : find out why!
-            uint offset = (m_trackStartLocation).to_frame(outputRate) - transportLocation.to_frame(outputRate);
+            offset = (m_trackStartLocation).to_frame(outputRate) - transportLocation.to_frame(outputRate);
             mix_pos = m_sourceStartLocation;
             // 			printf("offset %d\n", offset);
-
-            for (uint chan=0; chan<bus->get_channel_count(); ++chan) {
-                audio_sample_t* buf = bus->get_buffer(chan, framesToProcess);
-                mixdown[chan] = buf + offset;
-            }
             framesToProcess -= offset;
         } else {
             mix_pos = (transportLocation - m_trackStartLocation + m_sourceStartLocation);
             // 			printf("else: Setting mix pos to start location %d\n", mix_pos.to_frame(96000));
-
-            for (uint chan=0; chan<bus->get_channel_count(); ++chan) {
-                mixdown[chan] = bus->get_buffer(chan, framesToProcess);
-            }
         }
         if (m_trackEndLocation < upperRange) {
             // Using to_frame() for both the upperRange and m_trackEndLocation seems to round
@@ -488,6 +480,13 @@ int AudioClip::process(nframes_t nframes)
         return 0;
     }
 
+    // The first Clip of a cycle renders straight into the (silent) Track
+    // process bus, the next ones are mixed into it afterwards.
+    inPlace = m_track->get_clip_buffers(buffers, nframes);
+    for (uint chan=0; chan<2; ++chan) {
+        mixdown[chan] = buffers[chan] + offset;
+    }
+
     uint read_frames = 0;
 
     if (m_sheet->realtime_path()) {
@@ -512,7 +511,7 @@ int AudioClip::process(nframes_t nframes)
 
 
     apill_foreach(FadeCurve* fade, FadeCurve*, m_fades) {
-        fade->process(bus, nframes);
+        fade->process(buffers, 2, nframes);
     }
 
     TimeRef endlocation = mix_pos + TimeRef(read_frames, get_rate());
@@ -520,14 +519,20 @@ int AudioClip::process(nframes_t nframes)
 
     AudioBus* processBus = m_track->get_process_bus();
 
-    // NEVER EVER FORGET that the mixing should be done on the WHOLE buffer, not just part of it
-    // so use an unmodified nframes variable!!!!!!!!!!!!!!!!!!!!!!!!!!!1
+    // Only the part we read has to be mixed, the rest of the buffers is not touched.
+    audio_sample_t* left = processBus->get_buffer(0, nframes) + offset;
+    audio_sample_t* right = processBus->get_buffer(1, nframes) + offset;
+
     if (channelcount == 1) {
-        Mixer::mix_buffers_no_gain(processBus->get_buffer(0, nframes), bus->get_buffer(0, nframes), nframes);
-        Mixer::mix_buffers_no_gain(processBus->get_buffer(1, nframes), bus->get_buffer(0, nframes), nframes);
-    } else if (channelcount == 2) {
-        Mixer::mix_buffers_no_gain(processBus->get_buffer(0, nframes), bus->get_buffer(0, nframes), nframes);
-        Mixer::mix_buffers_no_gain(processBus->get_buffer(1, nframes), bus->get_buffer(1, nframes), nframes);
+        if (inPlace) {
+            memcpy(right, left, read_frames * sizeof(audio_sample_t));
+        } else {
+            Mixer::mix_buffers_no_gain(left, mixdown[0], read_frames);
+            Mixer::mix_buffers_no_gain(right, mixdown[0], read_frames);
+        }
+    } else if (channelcount == 2 && !inPlace) {
+        Mixer::mix_buffers_no_gain(left, mixdown[0], read_frames);
+        Mixer::mix_buffers_no_gain(right, mixdown[1], read_frames);
     }
 
     return 1;
@@ -26,7 +26,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.
 
 #include <QObject>
 
-#include "RingBufferNPT.h"
+#include "MultiChannelRingBuffer.h"
 
 
 class QString;
@@ -54,10 +54,11 @@ public :
     uint get_bit_depth() const;
 	
 protected:
-	QList<RingBufferNPT<audio_sample_t>*> 	m_buffers;
+	MultiChannelRingBuffer<audio_sample_t>*	m_buffer{};
 	
     uint		m_bufferSize{};
     uint		m_chunkSize{};
+    uint		m_wakeupWatermark{};
 	
     uint		m_channelCount{};
     qint64		m_origSheetId{};
@@ -29,6 +29,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.
 #include "AudioClipManager.h"
 #include "AudioBus.h"
 #include "AudioDevice.h"
+#include "TAudioBufferArena.h"
 #include "PluginChain.h"
 #include "Information.h"
 #include "ProjectManager.h"
@@ -76,6 +77,9 @@ AudioTrack::AudioTrack( Sheet * sheet, const QDomNode node)
 AudioTrack::~AudioTrack()
 {
         PENTERDES;
+        delete m_processBus;
+        delete m_preSendBus;
+        m_bufferArena->release_slot(m_bufferSlot);
 }
 
 void AudioTrack::init()
@@ -84,7 +88,25 @@ void AudioTrack::init()
 
         m_type = AUDIOTRACK;
         m_isArmed = false;
-        m_processBus = m_sheet->get_render_bus();
+        m_rendered = false;
+        m_processBusUsed = false;
+        m_renderResult = 0;
+
+        // Each Track has it's own buses, so Tracks can be processed in parallel
+        BusConfig busConfig;
+        busConfig.name = "Track Render Bus";
+        busConfig.channelcount = 2;
+        busConfig.type = "output";
+        busConfig.isInternalBus = true;
+        m_processBus = new AudioBus(busConfig);
+
+        busConfig.name = "Track Pre Send Bus";
+        m_preSendBus = new AudioBus(busConfig);
+
+        // The buses use buffers from the Sheet's arena
+        m_bufferArena = m_sheet->get_buffer_arena();
+        m_bufferSlot = m_bufferArena->allocate_slot();
+        update_render_buffers();
 
         connect(this, SIGNAL(privateAudioClipAdded(AudioClip*)), this, SLOT(private_audioclip_added(AudioClip*)));
         connect(this, SIGNAL(privateAudioClipRemoved(AudioClip*)), this, SLOT(private_audioclip_removed(AudioClip*)));
@@ -120,6 +142,44 @@ QDomNode AudioTrack::get_state( QDomDocument doc, bool istemplate)
         return node;
 }
 
+/**
+ *	(Re)fetches the render buffers from the Sheet's buffer arena, to be called
+ *	when the arena's buffer size changed, and before the track is processed
+ *	again after it was removed. Not thread safe!
+ */
+void AudioTrack::update_render_buffers()
+{
+        nframes_t size = m_bufferArena->get_buffer_size();
+
+        for (uint chan=0; chan<2; ++chan) {
+                m_processBus->get_channel(chan)->set_external_buffer(m_bufferArena->get_buffer(m_bufferSlot, int(chan)), size);
+                m_preSendBus->get_channel(chan)->set_external_buffer(m_bufferArena->get_buffer(m_bufferSlot, int(chan) + 2), size);
+                m_clipBuffers[chan] = m_bufferArena->get_buffer(m_bufferSlot, int(chan) + 4);
+        }
+}
+
+//
+//  Function called in RealTime AudioThread processing path
+//
+//  Returns true if buffers point to the process bus, which is the case for the
+//  first Clip asking for them in a cycle, the Clip can render into them directly.
+//  Otherwise buffers point to scratch buffers, which have to be mixed into the
+//  process bus by the Clip.
+//
+bool AudioTrack::get_clip_buffers(audio_sample_t** buffers, nframes_t nframes)
+{
+        if (m_processBusUsed) {
+                buffers[0] = m_clipBuffers[0];
+                buffers[1] = m_clipBuffers[1];
+                return false;
+        }
+
+        m_processBusUsed = true;
+        buffers[0] = m_processBus->get_buffer(0, nframes);
+        buffers[1] = m_processBus->get_buffer(1, nframes);
+        return true;
+}
+
 TimeRef AudioTrack::get_end_location() const
 {
     TimeRef endLocation{};
@@ -260,20 +320,37 @@ void AudioTrack::add_input_bus(AudioBus *bus)
 //  Function called in RealTime AudioThread processing path
 //
 int AudioTrack::process( nframes_t nframes )
+{
+    int processResult = render(nframes);
+
+    mix_sends_into(nullptr, nframes);
+
+    return processResult;
+}
+
+//
+//  Function called in RealTime AudioThread processing path
+//
+//  Renders the Track into it's process bus, without touching any
+//  other bus, so Tracks can be rendered in parallel.
+//  The sends are mixed afterwards by mix_sends_into()
+//
+int AudioTrack::render( nframes_t nframes )
 {
     int processResult = 0;
 
+    m_rendered = false;
+
     if ( (m_isMuted || m_mutedBySolo) && ( ! m_isArmed) ) {
         return 0;
     }
 
-    // Get the 'render bus' from sheet, a bit hackish solution, but
-    // it avoids to have a dedicated render bus for each Track,
-    // or buffers located on the heap...
+    m_rendered = true;
+
     m_processBus->silence_buffers(nframes);
+    m_processBusUsed = false;
 
     int result;
-    float panFactor;
 
     // Read in clip data into process bus.
     apill_foreach(AudioClip* clip, AudioClip*, m_rtAudioClips) {
@@ -293,26 +370,18 @@ int AudioTrack::process( nframes_t nframes )
         processResult |= result;
     }
 
-    // Then do the pre-send:
-    process_pre_sends(nframes);
+    // Keep the pre-send signal for mix_sends_into()
+    if (m_preSends.size()) {
+        for (uint chan=0; chan<m_processBus->get_channel_count(); ++chan) {
+            memcpy(m_preSendBus->get_buffer(chan, nframes), m_processBus->get_buffer(chan, nframes), nframes * sizeof(audio_sample_t));
+        }
+    }
 
 
     // Then apply the pre fader plugins;
     m_pluginChain->process_pre_fader(m_processBus, nframes);
 
 
-    // Apply PAN
-    if ( (m_processBus->get_channel_count() >= 1) && (m_pan > 0) )  {
-        panFactor = 1 - m_pan;
-        Mixer::apply_gain_to_buffer(m_processBus->get_buffer(0, nframes), nframes, panFactor);
-    }
-
-    if ( (m_processBus->get_channel_count() >= 2) && (m_pan < 0) )  {
-        panFactor = 1 + m_pan;
-        Mixer::apply_gain_to_buffer(m_processBus->get_buffer(1, nframes), nframes, panFactor);
-    }
-
-
     // gain automation curve only understands audio_sample_t** atm
     // so wrap the process buffers into a audio_sample_t**
     // FIXME make it future proof so it can deal with any amount of channels?
@@ -323,8 +392,8 @@ int AudioTrack::process( nframes_t nframes )
 
     TimeRef location = m_sheet->get_transport_location();
     TimeRef endlocation = location + TimeRef(nframes, audiodevice().get_sample_rate());
-    // Apply fader Gain/envelope
-    m_fader->process_gain(mixdown, location, endlocation, nframes, m_processBus->get_channel_count());
+    // Apply PAN and fader Gain/envelope
+    m_fader->process_gain(mixdown, location, endlocation, nframes, m_processBus->get_channel_count(), m_pan);
 
 
     // Post fader plugins now
@@ -336,14 +405,32 @@ int AudioTrack::process( nframes_t nframes )
         if (!m_isArmed) {
             m_processBus->process_monitoring(m_vumonitors);
         }
-
-        // And finally do the post sends
-        process_post_sends(nframes);
     }
 
+    m_renderResult = processResult;
+
     return processResult;
 }
 
+//
+//  Function called in RealTime AudioThread processing path
+//
+//  Mixes the result of render() into the buses of the pre and post sends,
+//  or only into receiver if it's not 0.
+//
+void AudioTrack::mix_sends_into(AudioBus* receiver, nframes_t nframes)
+{
+    if (!m_rendered) {
+        return;
+    }
+
+    process_sends(m_preSends, m_preSendBus, receiver, nframes);
+
+    if (m_renderResult) {
+        process_sends(m_postSends, m_processBus, receiver, nframes);
+    }
+}
+
 
 TCommand* AudioTrack::toggle_arm()
 {
@@ -26,6 +26,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.
 #include <QString>
 #include <QDomDocument>
 #include <QList>
+#include <QSharedPointer>
 
 #include "ContextItem.h"
 #include "Track.h"
@@ -33,6 +34,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.
 #include "defines.h"
 
 class Sheet;
+class TAudioBufferArena;
 
 
 class AudioTrack : public Track
@@ -65,6 +67,10 @@ public :
         bool armed();
         int disarm();
         int process(nframes_t nframes);
+        int render(nframes_t nframes);
+        void mix_sends_into(AudioBus* receiver, nframes_t nframes);
+        bool get_clip_buffers(audio_sample_t** buffers, nframes_t nframes);
+        void update_render_buffers();
 
 protected:
         void add_input_bus(AudioBus* bus);
@@ -78,6 +84,16 @@ private :
         // only to be accessed from GUI thread
         QList<AudioClip*>   m_audioClips;
 
+        // Used by the (parallel) processing path only
+        AudioBus*       m_preSendBus;
+        audio_sample_t* m_clipBuffers[2];
+        // Shared, as the Sheet can be deleted before it's Tracks
+        QSharedPointer<TAudioBufferArena> m_bufferArena;
+        int             m_bufferSlot;
+        int             m_renderResult;
+        bool            m_rendered;
+        bool            m_processBusUsed;
+
         int             m_numtakes{};
         bool            m_isArmed{};
 	bool		m_showClipVolumeAutomation{};
@@ -29,6 +29,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.
 
 #include "Curve.h"
 #include <cmath>
+#include <cfloat>
 
 #include "Sheet.h"
 #include "Utils.h"
@@ -127,13 +128,17 @@ int Curve::set_state( const QDomNode & node )
 	return 1;
 }
 
+// Cubic segments are applied as a series of linear ramps of at most this length
+#define CURVE_RAMP_FRAMES 32
+
 int Curve::process(
 	audio_sample_t** buffer,
 	const TimeRef& startlocation,
 	const TimeRef& endlocation,
 	nframes_t nframes,
 	uint channels,
-    audio_sample_t makeupgain
+    audio_sample_t makeupgain,
+	const float* channelgains
 	)
 {
 	// Do nothing if there are no nodes!
@@ -145,29 +150,108 @@ int Curve::process(
 	if (endlocation > qint64(get_range())) {
         audio_sample_t gain = audio_sample_t((static_cast<CurveNode*>(m_nodes.last()))->value) * makeupgain;
 
-		if (gain == 1.0f) {
+		if (gain == 1.0f && !channelgains) {
 			return 0;
 		}
 		
 		for (uint chan=0; chan<channels; ++chan) {
-			Mixer::apply_gain_to_buffer(buffer[chan], nframes, gain);
+			audio_sample_t chanGain = channelgains ? gain * channelgains[chan] : gain;
+			if (chanGain != 1.0f) {
+				Mixer::apply_gain_to_buffer(buffer[chan], nframes, chanGain);
+			}
 		}
 		
 		return 1;
 	}
 	
-	// Calculate the vector, an apply to the buffer including the makeup gain.
-        get_vector(startlocation.universal_frame(), endlocation.universal_frame(), m_session->mixdown, nframes);
-	
-	for (uint chan=0; chan<channels; ++chan) {
-		for (nframes_t n = 0; n < nframes; ++n) {
-                        buffer[chan][n] *= (m_session->mixdown[n] * makeupgain);
+	if (m_changed && m_nodes.size() > 2) {
+		solve ();
+	}
+
+	// Walk the curve segment by segment, each segment (or stretch of a cubic
+	// segment) is applied to all channels as one ramp, with the makeup gain folded in.
+	double x0 = startlocation.universal_frame();
+	double dx = (endlocation.universal_frame() - x0) / nframes;
+	double segmentEnd;
+	bool cubic;
+	audio_sample_t startGain = audio_sample_t(segment_value(x0, segmentEnd, cubic)) * makeupgain;
+	nframes_t pos = 0;
+
+	while (pos < nframes) {
+		nframes_t len = nframes - pos;
+		double framesToNode = ceil((segmentEnd - (x0 + pos * dx)) / dx);
+
+		if (framesToNode < len) {
+			len = qMax(nframes_t(1), nframes_t(framesToNode));
+		}
+		if (cubic && len > CURVE_RAMP_FRAMES) {
+			len = CURVE_RAMP_FRAMES;
+		}
+
+		audio_sample_t endGain = audio_sample_t(segment_value(x0 + (pos + len) * dx, segmentEnd, cubic)) * makeupgain;
+
+		for (uint chan=0; chan<channels; ++chan) {
+			audio_sample_t chanGain = channelgains ? channelgains[chan] : 1.0f;
+			audio_sample_t* buf = buffer[chan] + pos;
+
+			if (startGain == endGain) {
+				if (startGain * chanGain != 1.0f) {
+					Mixer::apply_gain_to_buffer(buf, len, startGain * chanGain);
+				}
+			} else {
+				Mixer::apply_gain_ramp(buf, len, startGain * chanGain, endGain * chanGain);
+			}
 		}
+
+		startGain = endGain;
+		pos += len;
 	}
 	
 	return 1;
 }
 
+/**
+ * Value of the Curve at x, for the realtime process path.
+ *
+ * segmentEnd is set to the location of the first node after x, up to there
+ * the Curve is a cubic spline if cubic is set, or else a straight line.
+ */
+double Curve::segment_value(double x, double& segmentEnd, bool& cubic)
+{
+	CurveNode* firstnode = static_cast<CurveNode*>(m_nodes.first());
+	CurveNode* lastnode = static_cast<CurveNode*>(m_nodes.last());
+
+	cubic = false;
+
+	if (x < firstnode->when) {
+		segmentEnd = firstnode->when;
+		return firstnode->value;
+	}
+
+	if (x >= lastnode->when || m_nodes.size() == 1) {
+		segmentEnd = DBL_MAX;
+		return lastnode->value;
+	}
+
+	segmentEnd = lastnode->when;
+
+	if (m_nodes.size() == 2) {
+		double slope = (lastnode->value - firstnode->value) / (lastnode->when - firstnode->when);
+		return firstnode->value + slope * (x - firstnode->when);
+	}
+
+	cubic = true;
+
+	double value = multipoint_eval(x);
+
+	// multipoint_eval() leaves the node after x in the lookup cache
+	if (m_lookup_cache.range.second && m_lookup_cache.range.second->when > x) {
+		segmentEnd = m_lookup_cache.range.second->when;
+	}
+
+	return value;
+}
+
 
 void Curve::solve ()
 {
@@ -52,7 +52,9 @@ public:
 
 	QDomNode get_state(QDomDocument doc, const QString& name);
 	virtual int set_state( const QDomNode& node );
-	int process(audio_sample_t** buffer, const TimeRef& startlocation, const TimeRef& endlocation, nframes_t nframes, uint channels, float makeupgain=1.0f);
+	// channelgains optionally holds an extra gain per channel (e.g. pan),
+	// which is applied in the same pass as the curve
+	int process(audio_sample_t** buffer, const TimeRef& startlocation, const TimeRef& endlocation, nframes_t nframes, uint channels, float makeupgain=1.0f, const float* channelgains=nullptr);
 	
 	TCommand* add_node(CurveNode* node, bool historable=true);
 	TCommand* remove_node(CurveNode* node, bool historable=true);
@@ -93,6 +95,7 @@ private :
 
 	
 	double multipoint_eval (double x);
+	double segment_value (double x, double& segmentEnd, bool& cubic);
 	void x_scale(double factor);
 	void solve ();
 	void init();
@@ -100,7 +103,7 @@ private :
 	friend class CurveNode;
 
 protected slots:
-	void set_changed();
+	virtual void set_changed();
 
 private slots:
 	void private_add_node(CurveNode* node);
@@ -22,6 +22,10 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.
 #include "DiskIO.h"
 #include "Sheet.h"
 #include <QThread>
+#include <QSemaphore>
+#include <QAtomicInt>
+#include <QVector>
+#include <cmath>
 
 #if defined (Q_OS_UNIX)
 
@@ -75,30 +79,88 @@ const char *to_prio[] = { "none", "realtime", "best-effort", "idle", };
 #include "AudioDevice.h"
 #include "RingBuffer.h"
 #include "TConfig.h"
+#include "TDecodeCache.h"
 
 // Always put me below _all_ includes, this is needed
 // in case we run with memory leak detection enabled!
 #include "Debugger.h"
 
 
-#define UPDATE_INTERVAL		20
+// The disk threads are woken up by the sources as soon as a ringbuffer
+// crossed it's watermark. This interval is only a safety net in case
+// no source requested a wakeup, e.g. for finishing ringbuffer resyncs.
+#define FALLBACK_UPDATE_INTERVAL	200
+
+// Ringbuffer sizing, see balance_read_buffers(). Sources decoding one second
+// of audio in REFERENCE_DECODE_COST seconds get the configured buffer size.
+static const float REFERENCE_DECODE_COST = 0.01f;
+static const float MIN_READ_BUFFER_FACTOR = 0.5f;
+static const float MAX_READ_BUFFER_FACTOR = 4.0f;
+static const float MIN_READ_BUFFER_LENGTH = 0.25f;
+
+
+static void set_disk_io_priority(bool verbose)
+{
+#if defined (Q_OS_UNIX)
+    if (IOPRIO_SUPPORT) {
+        // When using the cfq scheduler we are able to set the priority of the io for what it's worth though :-)
+        int ioprio = 0, ioprio_class = IOPRIO_CLASS_RT;
+        int value = syscall(__NR_ioprio_set, IOPRIO_WHO_PROCESS, getpid(), ioprio | ioprio_class << IOPRIO_CLASS_SHIFT);
+
+        if (value == -1) {
+            ioprio_class = IOPRIO_CLASS_BE;
+            value = syscall(__NR_ioprio_set, IOPRIO_WHO_PROCESS, getpid(), ioprio | ioprio_class << IOPRIO_CLASS_SHIFT);
+        }
+
+        if (value == 0 && verbose) {
+            ioprio = syscall (__NR_ioprio_get, IOPRIO_WHO_PROCESS, getpid());
+            ioprio_class = ioprio >> IOPRIO_CLASS_SHIFT;
+            ioprio = ioprio & IOPRIO_PRIO_MASK;
+            printf("DiskIOThread: Using prioritized disk I/O using %s prio %d (Only effective with the cfq scheduler)\n", to_prio[ioprio_class], ioprio);
+        }
+    }
+#else
+    Q_UNUSED(verbose);
+#endif
+}
 
 
 // DiskIOThread is a private class to be used by
 // DiskIO only for processing read/write buffers
-// in a seperate thread.
+// in a seperate thread. The thread sleeps until
+// it is woken up by wakeup(), or the fallback
+// interval passed, and then calls it's work function.
 class DiskIOThread : public QThread
 {
 public:
-    DiskIOThread(DiskIO* diskio)
+    typedef void (DiskIO::*WorkFunction)();
+
+    DiskIOThread(DiskIO* diskio, WorkFunction work)
         : QThread(diskio),
-          m_diskio(diskio)
+          m_diskio(diskio),
+          m_work(work)
     {
-        connect(&m_workTimer, SIGNAL(timeout()), m_diskio, SLOT(do_work()));
+        m_quit = 0;
+    }
+
+    // Safe to be called from the realtime audio thread, the
+    // semaphore is only touched once per requested wakeup.
+    void wakeup() {
+        if (m_wakeupPending.testAndSetOrdered(0, 1)) {
+            m_wakeup.release();
+        }
+    }
+
+    void quit_work() {
+        m_quit = 1;
+        m_wakeup.release();
     }
 
     DiskIO*		m_diskio;
-    QTimer			m_workTimer;
+    WorkFunction	m_work;
+    QSemaphore		m_wakeup;
+    QAtomicInt		m_wakeupPending;
+    volatile size_t	m_quit;
 
 protected:
     void run() override;
@@ -106,26 +168,56 @@ protected:
 
 void DiskIOThread::run()
 {
-#if defined (Q_OS_UNIX)
-    if (IOPRIO_SUPPORT) {
-        // When using the cfq scheduler we are able to set the priority of the io for what it's worth though :-)
-        int ioprio = 0, ioprio_class = IOPRIO_CLASS_RT;
-        int value = syscall(__NR_ioprio_set, IOPRIO_WHO_PROCESS, getpid(), ioprio | ioprio_class << IOPRIO_CLASS_SHIFT);
+    set_disk_io_priority(true);
 
-        if (value == -1) {
-            ioprio_class = IOPRIO_CLASS_BE;
-            value = syscall(__NR_ioprio_set, IOPRIO_WHO_PROCESS, getpid(), ioprio | ioprio_class << IOPRIO_CLASS_SHIFT);
+    while (!m_quit) {
+        m_wakeup.tryAcquire(1, FALLBACK_UPDATE_INTERVAL);
+
+        // Reset before doing the work, so wakeup requests
+        // made while working result in another work cycle.
+        m_wakeupPending.fetchAndStoreOrdered(0);
+
+        if (m_quit) {
+            break;
         }
 
-        if (value == 0) {
-            ioprio = syscall (__NR_ioprio_get, IOPRIO_WHO_PROCESS, getpid());
-            ioprio_class = ioprio >> IOPRIO_CLASS_SHIFT;
-            ioprio = ioprio & IOPRIO_PRIO_MASK;
-            printf("DiskIOThread: Using prioritized disk I/O using %s prio %d (Only effective with the cfq scheduler)\n", to_prio[ioprio_class], ioprio);
+        (m_diskio->*m_work)();
+    }
+}
+
+
+// DiskIOReaderThread is a private class to be used by
+// DiskIO only. A pool of these threads refills the
+// ReadSource ring buffers queued by DiskIO::do_work(),
+// so a slow decoder doesn't hold up the other sources.
+class DiskIOReaderThread : public QThread
+{
+public:
+    DiskIOReaderThread(DiskIO* diskio)
+        : QThread(diskio),
+          m_diskio(diskio)
+    {
+    }
+
+    DiskIO*		m_diskio;
+    DecodeBuffer	m_decodebuffer;
+
+protected:
+    void run() override;
+};
+
+void DiskIOReaderThread::run()
+{
+    set_disk_io_priority(false);
+
+    // take_read_job() returns with the source's process mutex locked,
+    // and 0 when DiskIO is shutting down.
+    while (ReadSource* source = m_diskio->take_read_job()) {
+        if (!m_diskio->m_stopWork) {
+            source->process_ringbuffer(&m_decodebuffer, m_diskio->m_seeking);
         }
+        m_diskio->finish_read_job(source);
     }
-#endif
-    exec();
 }
 
 
@@ -143,34 +235,41 @@ void DiskIOThread::run()
 DiskIO::DiskIO(Sheet* sheet)
     : m_sheet(sheet)
 {
-    m_diskThread = new DiskIOThread(this);
+    m_diskThread = new DiskIOThread(this, &DiskIO::do_work);
+    m_writeThread = new DiskIOThread(this, &DiskIO::do_write_work);
     m_lastdoWorkReadTime = get_microseconds();
     m_stopWork = m_seeking = false;
+    m_quitReaders = 0;
+    m_pendingReadJobs = 0;
     m_sampleRateChanged = false;
     m_resampleQuality = config().get_property("Conversion", "RTResamplingConverterType", DEFAULT_RESAMPLE_QUALITY).toInt();
     m_readBufferFillStatus = m_writeBufferFillStatus = 0;
     m_hardDiskOverLoadCounter = 0;
 
-    // TODO This is a LARGE buffer, any ideas how to make it smaller ??
-    framebuffer[0] = new audio_sample_t[audiodevice().get_sample_rate() * writebuffertime];
-
     m_decodebuffer = new DecodeBuffer;
     m_resampleDecodeBuffer = new DecodeBuffer;
 
-    // Move this instance to the workthread
-//    moveToThread(m_diskThread);
-//    m_workTimer.moveToThread(m_diskThread);
+    // A value of 0 (the default) means: pick a sensible amount for this machine
+    int readerThreadCount = config().get_property("Hardware", "diskioreaderthreads", 0).toInt();
+    if (readerThreadCount <= 0) {
+        readerThreadCount = qBound(1, QThread::idealThreadCount() - 1, 4);
+    }
 
-//    connect(&m_workTimer, SIGNAL(timeout()), this, SLOT(do_work()));
+    for (int i=0; i<readerThreadCount; ++i) {
+        DiskIOReaderThread* reader = new DiskIOReaderThread(this);
+        m_readerThreads.append(reader);
+        reader->start(QThread::HighPriority);
+    }
 
-    m_diskThread->start();
+    m_diskThread->start(QThread::HighPriority);
+    // Recording should never have to wait for (slow) decoding of ReadSources
+    m_writeThread->start(QThread::TimeCriticalPriority);
 }
 
 DiskIO::~DiskIO()
 {
     PENTERDES;
     stop();
-    delete [] framebuffer[0];
     delete m_decodebuffer;
     delete m_resampleDecodeBuffer;
 }
@@ -189,6 +288,9 @@ void DiskIO::seek()
     Q_ASSERT_X(m_sheet->threadId != QThread::currentThreadId (), "DiskIO::seek", "Error, running in gui thread!!!!!");
 #endif
 
+    // Wait for a running do_work() to return, prepare_for_seek()
+    // made sure it bails out as soon as possible.
+    m_workMutex.lock();
     mutex.lock();
 
     m_stopWork = 0;
@@ -196,16 +298,36 @@ void DiskIO::seek()
 
     TimeRef location = m_sheet->get_new_transport_location();
 
-    foreach(ReadSource* source, m_readSources) {
-        if (m_sampleRateChanged) {
+    if (m_sampleRateChanged) {
+        // Sources can move between playing from memory and from their
+        // ringbuffers, since their length in frames changed
+        QList<ReadSource*> sources = m_readSources + m_ramSources;
+        m_readSources.clear();
+        m_ramSources.clear();
+
+        foreach(ReadSource* source, sources) {
+            QMutexLocker sourceLocker(source->get_process_mutex());
             source->set_diskio(this);
+            if (source->is_ram_source()) {
+                m_ramSources.append(source);
+            } else {
+                m_readSources.append(source);
+            }
         }
+    }
+
+    // The buffers are refilled anyway, so this is the moment to resize them
+    balance_read_buffers();
+
+    foreach(ReadSource* source, m_readSources) {
+        QMutexLocker sourceLocker(source->get_process_mutex());
         source->rb_seek_to_file_position(location);
     }
 
     m_sampleRateChanged = false;
 
     mutex.unlock();
+    m_workMutex.unlock();
 
     // Now, fill the buffers like normal
     do_work();
@@ -218,6 +340,60 @@ void DiskIO::seek()
 }
 
 
+// Internal function, called while seeking with the sources mutex held.
+// Sizes the ringbuffers of the sources to their measured decode cost and
+// underruns: cheap sources get less than "Hardware"/"readbuffersize" seconds,
+// expensive or underrunning ones more. The total is kept within
+// "Hardware"/"readbuffermemory" MB, by default the memory all buffers
+// would take at readbuffersize.
+void DiskIO::balance_read_buffers()
+{
+    if (m_readSources.isEmpty() || !config().get_property("Hardware", "adaptivereadbuffers", true).toBool()) {
+        return;
+    }
+
+    float baseLength = config().get_property("Hardware", "readbuffersize", 1.0).toDouble();
+    QVector<float> lengths(m_readSources.size());
+    qint64 bytesPerSecond = 0;
+    qint64 totalBytes = 0;
+
+    for (int i=0; i<m_readSources.size(); ++i) {
+        ReadSource* source = m_readSources.at(i);
+        QMutexLocker sourceLocker(source->get_process_mutex());
+
+        float cost = source->get_decode_cost();
+        int underruns = source->take_underrun_count();
+        float factor = 1.0f;
+
+        if (cost >= 0) {
+            factor = qBound(MIN_READ_BUFFER_FACTOR, std::sqrt(cost / REFERENCE_DECODE_COST), MAX_READ_BUFFER_FACTOR);
+        }
+        if (underruns) {
+            factor = qMin(factor * 2, MAX_READ_BUFFER_FACTOR);
+        }
+
+        qint64 sourceBytesPerSecond = qint64(m_outputRate) * source->get_channel_count() * sizeof(audio_sample_t);
+        lengths[i] = baseLength * factor;
+        bytesPerSecond += sourceBytesPerSecond;
+        totalBytes += qint64(lengths[i] * sourceBytesPerSecond);
+    }
+
+    qint64 budget = qint64(config().get_property("Hardware", "readbuffermemory", 0).toInt()) * 1024 * 1024;
+    if (budget <= 0) {
+        budget = qint64(baseLength * bytesPerSecond);
+    }
+
+    float scale = (totalBytes > budget) ? float(budget) / totalBytes : 1.0f;
+
+    for (int i=0; i<m_readSources.size(); ++i) {
+        ReadSource* source = m_readSources.at(i);
+        QMutexLocker sourceLocker(source->get_process_mutex());
+        float length = qMax(lengths[i] * scale, MIN_READ_BUFFER_LENGTH);
+        source->set_rt_buffer_size(nframes_t(length * m_outputRate));
+    }
+}
+
+
 void DiskIO::output_rate_changed(uint rate)
 {
     m_sampleRateChanged = true;
@@ -226,35 +402,40 @@ void DiskIO::output_rate_changed(uint rate)
 
 
 // Internal function
+// Collects the ReadSources that need processing, and hands them over to the
+// reader threads. The WriteSources are processed by do_write_work()
 void DiskIO::do_work( )
 {
 #if defined (THREAD_CHECK)
     Q_ASSERT_X(m_sheet->threadId != QThread::currentThreadId (), "DiskIO::do_work", "Error, running in gui thread!!!!!");
 #endif
 
-    QMutexLocker locker(&mutex);
+    QMutexLocker workLocker(&m_workMutex);
 
     int whilecount = 0;
     m_hardDiskOverLoadCounter = 0;
 
-    while (there_are_processable_sources()) {
-
-        m_doWorkStartTime = get_microseconds();
-
-        for (int i=0; i<m_processableReadSources.size(); ++i) {
-            ReadSource* source = m_processableReadSources.at(i);
+    while (true) {
+        {
+            // The sources mutex only has to be held while collecting and
+            // queueing the processable sources. (Un)registering a source
+            // doesn't have to wait for the reader threads to finish.
+            QMutexLocker locker(&mutex);
 
-            if (m_stopWork) {
-                update_time_usage();
+            if (m_stopWork || !there_are_processable_sources()) {
                 return;
             }
 
-            source->process_ringbuffer(m_decodebuffer, m_seeking);
+            m_doWorkStartTime = get_microseconds();
+
+            queue_read_jobs();
         }
 
-        for (int i=0; i<m_processableWriteSources.size(); ++i) {
-            WriteSource* source = m_processableWriteSources.at(i);
-            source->process_ringbuffer(framebuffer[0]);
+        wait_for_read_jobs();
+
+        if (m_stopWork) {
+            update_time_usage();
+            return;
         }
 
         if (whilecount++ > 2000) {
@@ -268,22 +449,105 @@ void DiskIO::do_work( )
 
 
 // Internal function
+// Runs in the dedicated write thread, processes the WriteSources only.
+void DiskIO::do_write_work( )
+{
+    QMutexLocker locker(&m_writeMutex);
+
+    int whilecount = 0;
+    m_writeOverRunCounter = 0;
+
+    while (there_are_processable_write_sources()) {
+
+        trav_time_t startTime = get_microseconds();
+
+        for (int i=0; i<m_processableWriteSources.size(); ++i) {
+            WriteSource* source = m_processableWriteSources.at(i);
+            source->process_ringbuffer();
+        }
+
+        m_totalWriteWorkTime += (get_microseconds() - startTime);
+
+        if (whilecount++ > 2000) {
+            printf("DiskIO::do_write_work -> probably detected a loop here, or do_write_work() is REALLY buzy!!\n");
+            break;
+        }
+    }
+}
+
+
+// Internal function, called with the sources mutex held
+void DiskIO::queue_read_jobs()
+{
+    QMutexLocker locker(&m_jobMutex);
+
+    // The processable sources are sorted by priority, the reader
+    // threads take them from the front of the queue.
+    m_readJobs = m_processableReadSources;
+    m_pendingReadJobs = m_readJobs.size();
+
+    if (m_pendingReadJobs > 0) {
+        m_readJobAvailable.wakeAll();
+    }
+}
+
+
+// Internal function, blocks until the reader threads processed all queued jobs
+void DiskIO::wait_for_read_jobs()
+{
+    QMutexLocker locker(&m_jobMutex);
+
+    while (m_pendingReadJobs > 0) {
+        m_readJobsFinished.wait(&m_jobMutex);
+    }
+}
+
+
+// Internal function, called by the reader threads.
+// Returns the next queued ReadSource with it's process mutex locked,
+// or 0 if the reader thread has to quit.
+ReadSource* DiskIO::take_read_job()
+{
+    QMutexLocker locker(&m_jobMutex);
+
+    while (m_readJobs.isEmpty()) {
+        if (m_quitReaders) {
+            return nullptr;
+        }
+        m_readJobAvailable.wait(&m_jobMutex);
+    }
+
+    ReadSource* source = m_readJobs.takeFirst();
+
+    // Lock the source while still holding the job mutex, this way
+    // unregister_read_source() can't miss a source that is about to be processed.
+    source->get_process_mutex()->lock();
+
+    return source;
+}
+
+
+// Internal function, called by the reader threads.
+void DiskIO::finish_read_job(ReadSource* source)
+{
+    source->get_process_mutex()->unlock();
+
+    QMutexLocker locker(&m_jobMutex);
+
+    if (--m_pendingReadJobs == 0) {
+        m_readJobsFinished.wakeAll();
+    }
+}
+
+
+// Internal function, called with the sources mutex held
 int DiskIO::there_are_processable_sources( )
 {
     m_processableReadSources.clear();
-    m_processableWriteSources.clear();
     m_readersStatus.clear();
-    m_writersStatus.clear();
     QList<ReadSource* > syncSources;
 
 
-    for (int j=0; j<m_writeSources.size(); ++j) {
-        WriteSource* source = m_writeSources.at(j);
-        int space = source->get_processable_buffer_space();
-        QPair<int, WriteSource*> data(space, source);
-        m_writersStatus.append(data);
-    }
-
     for (int j=0; j<m_readSources.size(); ++j) {
         ReadSource* source = m_readSources.at(j);
         BufferStatus* status = source->get_buffer_status();
@@ -293,29 +557,6 @@ int DiskIO::there_are_processable_sources( )
 
     for (int i=(bufferdividefactor-2); i >= 0; --i) {
 
-        for(int pair=0; pair<m_writersStatus.size(); ++pair) {
-            WriteSource* source = m_writersStatus.at(pair).second;
-            int space = m_writersStatus.at(pair).first;
-            int prio = int(space  / source->get_chunck_size());
-
-            // If the source stopped recording, it will write it's remaining samples in the next
-            // process_buffers call, and unregister itself from this DiskIO instance!
-            if ( (prio > i) || ( ! source->is_recording()) ) {
-
-                if ((source->get_buffer_size() - space) < 8192) {
-                    if (! m_hardDiskOverLoadCounter++) {
-                        emit writeSourceBufferOverRun();
-                    }
-                }
-
-                if (space > t_atomic_int_get(&m_writeBufferFillStatus)) {
-                    t_atomic_int_set(&m_writeBufferFillStatus, space);
-                }
-
-                m_processableWriteSources.append(source);
-            }
-        }
-
         for(int pair=0; pair<m_readersStatus.size(); ++pair) {
             ReadSource* source = m_readersStatus.at(pair).second;
             BufferStatus* status = m_readersStatus.at(pair).first;
@@ -343,14 +584,16 @@ int DiskIO::there_are_processable_sources( )
             }
         }
 
-        if (m_processableReadSources.size() > 0 || m_processableWriteSources.size() > 0) {
+        if (m_processableReadSources.size() > 0) {
             return 1;
         }
     }
 
 
     if (syncSources.size() > 0) {
-        syncSources.at(0)->sync(m_decodebuffer);
+        ReadSource* source = syncSources.at(0);
+        QMutexLocker sourceLocker(source->get_process_mutex());
+        source->sync(m_decodebuffer);
         return 1;
     }
 
@@ -359,6 +602,53 @@ int DiskIO::there_are_processable_sources( )
 }
 
 
+// Internal function, called with the write mutex held
+int DiskIO::there_are_processable_write_sources( )
+{
+    m_processableWriteSources.clear();
+    m_writersStatus.clear();
+
+    for (int j=0; j<m_writeSources.size(); ++j) {
+        WriteSource* source = m_writeSources.at(j);
+        int space = source->get_processable_buffer_space();
+        QPair<int, WriteSource*> data(space, source);
+        m_writersStatus.append(data);
+    }
+
+    for (int i=(bufferdividefactor-2); i >= 0; --i) {
+
+        for(int pair=0; pair<m_writersStatus.size(); ++pair) {
+            WriteSource* source = m_writersStatus.at(pair).second;
+            int space = m_writersStatus.at(pair).first;
+            int prio = int(space  / source->get_chunck_size());
+
+            // If the source stopped recording, it will write it's remaining samples in the next
+            // process_buffers call, and unregister itself from this DiskIO instance!
+            if ( (prio > i) || ( ! source->is_recording()) ) {
+
+                if ((source->get_buffer_size() - space) < 8192) {
+                    if (! m_writeOverRunCounter++) {
+                        emit writeSourceBufferOverRun();
+                    }
+                }
+
+                if (space > t_atomic_int_get(&m_writeBufferFillStatus)) {
+                    t_atomic_int_set(&m_writeBufferFillStatus, space);
+                }
+
+                m_processableWriteSources.append(source);
+            }
+        }
+
+        if (m_processableWriteSources.size() > 0) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
 // Internal function
 int DiskIO::stop( )
 {
@@ -368,15 +658,30 @@ int DiskIO::stop( )
     // Stop any processing in do_work()
     m_stopWork = 1;
 
-    // Exit the diskthreads event loop
-    m_diskThread->exit(0);
+    // Let the reader threads return once the job queue is empty
+    m_jobMutex.lock();
+    m_quitReaders = 1;
+    m_readJobAvailable.wakeAll();
+    m_jobMutex.unlock();
+
+    // Let the diskthreads return from their work loop
+    m_diskThread->quit_work();
+    m_writeThread->quit_work();
 
-    // Wait for the Thread to return from it's event loop. 1000 ms should be (more then) enough,
-    // if not, terminate this thread and print a warning!
-    if ( ! m_diskThread->wait(2000) ) {
-        qWarning("DiskIO :: Still running after 2 second wait, terminating!");
-        m_diskThread->terminate();
-        res = -1;
+    QList<QThread*> threads;
+    threads << m_diskThread << m_writeThread;
+    foreach(DiskIOReaderThread* reader, m_readerThreads) {
+        threads << reader;
+    }
+
+    // Wait for the Threads to return from their work loop. 2000 ms should be (more then) enough,
+    // if not, terminate the thread and print a warning!
+    foreach(QThread* thread, threads) {
+        if ( ! thread->wait(2000) ) {
+            qWarning("DiskIO :: Still running after 2 second wait, terminating!");
+            thread->terminate();
+            res = -1;
+        }
     }
 
     return res;
@@ -384,6 +689,7 @@ int DiskIO::stop( )
 
 /**
  *      Registers the ReadSource source. The source's RingBuffer will be initialized at this point.
+ *	Short sources are played from memory instead, see TAudioRamCache.
  *
  *	Note: This function is thread save.
  * @param source The ReadSource to register
@@ -398,9 +704,23 @@ void DiskIO::register_read_source (ReadSource* source )
 
     source->set_diskio(this);
 
-    QMutexLocker locker(&mutex);
+    // Sources played from memory don't need the reader threads, they're
+    // only kept to follow output rate changes
+    if (source->is_ram_source()) {
+        QMutexLocker locker(&mutex);
+        m_ramSources.append(source);
+        return;
+    }
+
+    {
+        QMutexLocker locker(&mutex);
+
+        m_readSources.append(source);
+    }
 
-    m_readSources.append(source);
+    // Compressed sources are decoded in the background, and read from
+    // the decoded copy once it's complete
+    decode_cache().add_source(source);
 }
 
 /**
@@ -415,7 +735,7 @@ void DiskIO::register_write_source( WriteSource * source )
 
     source->set_diskio(this);
 
-    QMutexLocker locker(&mutex);
+    QMutexLocker locker(&m_writeMutex);
 
     m_writeSources.append(source);
 }
@@ -423,18 +743,36 @@ void DiskIO::register_write_source( WriteSource * source )
 /**
  * 	Unregisters the ReadSource from this DiskIO instance
  *
- *	Note: This function is Thread save.
+ *	Note: This function is Thread save. When it returns, none of the
+ *	reader threads is processing the source anymore.
  * @param source The ReadSource to be removed from the DiskIO instance.
  */
 void DiskIO::unregister_read_source( ReadSource * source )
 {
-    QMutexLocker locker(&mutex);
+    decode_cache().remove_source(source);
 
-    m_readSources.removeAll(source);
+    {
+        QMutexLocker locker(&mutex);
+
+        m_readSources.removeAll(source);
+        m_ramSources.removeAll(source);
+
+        QMutexLocker jobLocker(&m_jobMutex);
+        int removed = m_readJobs.removeAll(source);
+        if (removed) {
+            m_pendingReadJobs -= removed;
+            if (m_pendingReadJobs == 0) {
+                m_readJobsFinished.wakeAll();
+            }
+        }
+    }
+
+    // Wait for a reader thread which might still be processing this source
+    QMutexLocker sourceLocker(source->get_process_mutex());
 }
 
 
-// internal function
+// internal function, called from within do_write_work()
 void DiskIO::unregister_write_source( WriteSource * source )
 {
     m_writeSources.removeAll(source);
@@ -464,8 +802,8 @@ void DiskIO::update_time_usage( )
 trav_time_t DiskIO::get_cpu_time( )
 {
     trav_time_t currentTime = get_microseconds();
-    trav_time_t result = (m_totalDoWorkTime  / (currentTime - m_lastdoWorkReadTime) ) * 100;
-    m_totalDoWorkTime = 0;
+    trav_time_t result = ((m_totalDoWorkTime + m_totalWriteWorkTime)  / (currentTime - m_lastdoWorkReadTime) ) * 100;
+    m_totalDoWorkTime = m_totalWriteWorkTime = 0;
     m_lastdoWorkReadTime = currentTime;
 
     // 	if (result > 95) {
@@ -512,7 +850,8 @@ int DiskIO::get_read_buffers_fill_status( )
 void DiskIO::start_io( )
 {
     //	Q_ASSERT_X(m_sheet->threadId != QThread::currentThreadId (), "DiskIO::start_io", "Error, running in gui thread!!!!!");
-    m_diskThread->m_workTimer.start(UPDATE_INTERVAL);
+    m_diskThread->wakeup();
+    m_writeThread->wakeup();
     emit ioStartRequested();
 }
 
@@ -528,3 +867,56 @@ void DiskIO::set_resample_quality(int quality)
     m_resampleQuality = quality;
 }
 
+/**
+ *	Wakes up the read thread, to be called by ReadSources once their
+ *	ringbuffer drained below the watermark, or need a resync.
+ *
+ *	Note: This function doesn't lock and is safe to be called from the realtime thread
+ */
+void DiskIO::wakeup_read_thread()
+{
+    m_diskThread->wakeup();
+}
+
+/**
+ *	Wakes up the write thread, to be called by WriteSources once their
+ *	ringbuffer filled beyond the watermark, or stopped recording.
+ *
+ *	Note: This function doesn't lock and is safe to be called from the realtime thread
+ */
+void DiskIO::wakeup_write_thread()
+{
+    m_writeThread->wakeup();
+}
+
+/**
+ *	The watermark is the amount of ringbuffer space, as a percentage of the
+ *	ringbuffer size, that has to be processable before a source wakes up
+ *	the disk thread. Configured by Hardware/diskiowatermark.
+ *
+ * @return The number of frames for a ringbuffer of size \a bufferSize
+ */
+uint DiskIO::get_wakeup_watermark(uint bufferSize)
+{
+    int percentage = config().get_property("Hardware", "diskiowatermark", 100 / bufferdividefactor).toInt();
+    percentage = qBound(1, percentage, 90);
+
+    return uint((quint64(bufferSize) * percentage) / 100);
+}
+
+/**
+ *	The resample DecodeBuffer can only be shared by all ReadSources if
+ *	they are processed one after another by a single reader thread.
+ *
+ * @return The shared resample DecodeBuffer, or 0 if each ResampleAudioReader
+ *		has to use it's own.
+ */
+DecodeBuffer* DiskIO::get_resample_decode_buffer()
+{
+    if (m_readerThreads.size() > 1) {
+        return nullptr;
+    }
+
+    return m_resampleDecodeBuffer;
+}
+
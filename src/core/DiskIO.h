@@ -23,8 +23,8 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.
 #define DISKIO_H
 
 #include <QMutex>
+#include <QWaitCondition>
 #include <QList>
-#include <QTimer>
 #include <QPair>
 
 #include "defines.h"
@@ -33,6 +33,7 @@ class ReadSource;
 class WriteSource;
 class AudioSource;
 class DiskIOThread;
+class DiskIOReaderThread;
 class Sheet;
 class DecodeBuffer;
 
@@ -65,35 +66,52 @@ public:
 	void unregister_read_source(ReadSource* source);
 	void unregister_write_source(WriteSource* source);
 
+	void wakeup_read_thread();
+	void wakeup_write_thread();
+	static uint get_wakeup_watermark(uint bufferSize);
+
 	trav_time_t get_cpu_time();
 	int get_write_buffers_fill_status();
 	int get_read_buffers_fill_status();
 	int get_output_rate() {return m_outputRate;}
 	int get_resample_quality() {return m_resampleQuality;}
-	DecodeBuffer* get_resample_decode_buffer() {return m_resampleDecodeBuffer;}
+	int get_reader_thread_count() const {return m_readerThreads.size();}
+	DecodeBuffer* get_resample_decode_buffer();
 
 private:
 	Sheet* 			m_sheet;
 	volatile size_t		m_stopWork;
+	volatile size_t		m_quitReaders;
 	QList<ReadSource*>	m_readSources;
+	// Short sources played from memory, not processed by the reader threads
+	QList<ReadSource*>	m_ramSources;
 	QList<WriteSource*>	m_writeSources;
 	QList<ReadSource*>	m_processableReadSources;
 	QList<WriteSource*>	m_processableWriteSources;
 	QList<QPair<BufferStatus*, ReadSource*> > m_readersStatus;
 	QList<QPair<int, WriteSource*> > m_writersStatus;
 	DiskIOThread*		m_diskThread;
-        QTimer			m_workTimer;
+	DiskIOThread*		m_writeThread;
+	QList<DiskIOReaderThread*> m_readerThreads;
         QMutex			mutex;
+	QMutex			m_workMutex;
+	QMutex			m_writeMutex;
+	QMutex			m_jobMutex;
+	QWaitCondition		m_readJobAvailable;
+	QWaitCondition		m_readJobsFinished;
+	QList<ReadSource*>	m_readJobs;
+	int			m_pendingReadJobs;
 	volatile int		m_readBufferFillStatus;
 	volatile int		m_writeBufferFillStatus;
         trav_time_t             m_totalDoWorkTime{};
+	trav_time_t             m_totalWriteWorkTime{};
 	trav_time_t		m_doWorkStartTime{};
         trav_time_t		m_lastdoWorkReadTime;
 	bool			m_seeking;
 	int			m_resampleQuality;
 	bool			m_sampleRateChanged;
 	int			m_hardDiskOverLoadCounter;
-	audio_sample_t*		framebuffer[2]{};
+	int			m_writeOverRunCounter{};
 	audio_sample_t*		m_readbuffer{};
 	DecodeBuffer*		m_decodebuffer;
 	DecodeBuffer*		m_resampleDecodeBuffer;
@@ -101,11 +119,19 @@ private:
 
 	
 	void update_time_usage();
+	void balance_read_buffers();
 	
         int stop();
 	int there_are_processable_sources();
+	int there_are_processable_write_sources();
+
+	void queue_read_jobs();
+	void wait_for_read_jobs();
+	ReadSource* take_read_job();
+	void finish_read_job(ReadSource* source);
 
 	friend class DiskIOThread;
+	friend class DiskIOReaderThread;
 
 public slots:
 	void seek();
@@ -114,6 +140,7 @@ public slots:
 
 private slots:
         void do_work();
+	void do_write_work();
 
 signals:
 	void seekFinished();
@@ -22,7 +22,11 @@
 
 #include "Export.h"
 #include "Project.h"
+#include "WriteSource.h"
+#include <QTemporaryFile>
+#include <climits>
 #include <cstdio>
+#include <cstring>
 
 // Always put me below _all_ includes, this is needed
 // in case we run with memory leak detection enabled!
@@ -46,6 +50,209 @@ void ExportThread::run( )
         m_project->start_export(m_spec);
 }
 
+ExportWorker::ExportWorker(Project* project)
+{
+	m_project = project;
+}
+
+void ExportWorker::run()
+{
+	while (m_project->export_next_sheet()) {}
+}
+
+ExportSpill::ExportSpill(const QString& dir, qint64 expectedSamples, qint64 ramSize)
+{
+	m_file = nullptr;
+	m_readPos = 0;
+	m_failed = false;
+	m_dir = dir;
+	m_ramSize = qMin(ramSize, qint64(INT_MAX / 2) * qint64(sizeof(audio_sample_t)));
+
+	if (expectedSamples * qint64(sizeof(audio_sample_t)) <= m_ramSize) {
+		m_ram.reserve(int(expectedSamples));
+		return;
+	}
+
+	open_file();
+}
+
+ExportSpill::~ExportSpill()
+{
+	delete m_file;
+}
+
+// Switches to the temporary file, moving what was kept in memory into it
+bool ExportSpill::open_file()
+{
+	m_file = new QTemporaryFile(m_dir + "/.traverso-render-XXXXXX");
+	if (!m_file->open()) {
+		PWARN(QString("Couldn't create temporary render file in %1").arg(m_dir).toLatin1().data());
+		m_failed = true;
+		return false;
+	}
+
+	if (!m_ram.isEmpty()) {
+		qint64 bytes = qint64(m_ram.size()) * sizeof(audio_sample_t);
+		if (m_file->write(reinterpret_cast<const char*>(m_ram.constData()), bytes) != bytes) {
+			PWARN(QString("Couldn't write temporary render file %1").arg(m_file->fileName()).toLatin1().data());
+			m_failed = true;
+		}
+	}
+
+	m_ram = QVector<audio_sample_t>();
+
+	return !m_failed;
+}
+
+bool ExportSpill::write(const audio_sample_t* data, nframes_t count)
+{
+	if (m_failed) {
+		return false;
+	}
+
+	if (!m_file && (qint64(m_ram.size()) + count) * qint64(sizeof(audio_sample_t)) > m_ramSize) {
+		// More than expected, and too much to keep in memory
+		if (!open_file()) {
+			return false;
+		}
+	}
+
+	if (!m_file) {
+		int size = m_ram.size();
+		m_ram.resize(size + int(count));
+		memcpy(m_ram.data() + size, data, count * sizeof(audio_sample_t));
+		return true;
+	}
+
+	qint64 bytes = qint64(count) * sizeof(audio_sample_t);
+	if (m_file->write(reinterpret_cast<const char*>(data), bytes) != bytes) {
+		PWARN(QString("Couldn't write temporary render file %1").arg(m_file->fileName()).toLatin1().data());
+		m_failed = true;
+	}
+
+	return !m_failed;
+}
+
+// Returns the number of samples read, less than count at the end
+nframes_t ExportSpill::read(audio_sample_t* data, nframes_t count)
+{
+	if (!m_file) {
+		nframes_t available = nframes_t(qMax(0, m_ram.size() - m_readPos));
+		count = qMin(count, available);
+		memcpy(data, m_ram.constData() + m_readPos, count * sizeof(audio_sample_t));
+		m_readPos += int(count);
+		return count;
+	}
+
+	qint64 bytes = m_file->read(reinterpret_cast<char*>(data), qint64(count) * sizeof(audio_sample_t));
+
+	return bytes > 0 ? nframes_t(bytes / qint64(sizeof(audio_sample_t))) : 0;
+}
+
+void ExportSpill::rewind()
+{
+	m_readPos = 0;
+
+	if (m_file) {
+		m_file->flush();
+		m_file->seek(0);
+	}
+}
+
+ExportEncoder::ExportEncoder(WriteSource* source, uint channels, nframes_t blocksize, int depth)
+	: m_free(size_t(depth + 1))
+	, m_filled(size_t(depth + 1))
+	, m_freeCount(depth)
+{
+	m_source = source;
+	m_channels = channels;
+	m_failed = 0;
+
+	m_blocks.resize(depth);
+	for (int i = 0; i < depth; ++i) {
+		Block* block = &m_blocks[i];
+		block->data = new audio_sample_t[blocksize * channels];
+		m_free.write(&block, 1);
+	}
+}
+
+ExportEncoder::~ExportEncoder()
+{
+	for (int i = 0; i < m_blocks.size(); ++i) {
+		delete [] m_blocks[i].data;
+	}
+}
+
+// Called from the render thread, waits for a free block if the encoder
+// is behind. Returns -1 if the encoder failed.
+int ExportEncoder::write(const audio_sample_t* data, nframes_t nframes, bool endOfInput)
+{
+	if (t_atomic_int_get(&m_failed)) {
+		return -1;
+	}
+
+	m_freeCount.acquire();
+
+	Block* block;
+	m_free.read(&block, 1);
+
+	memcpy(block->data, data, nframes * m_channels * sizeof(audio_sample_t));
+	block->nframes = nframes;
+	block->endOfInput = endOfInput;
+
+	m_filled.write(&block, 1);
+	m_filledCount.release();
+
+	return 0;
+}
+
+// Waits until all blocks are written, returns -1 if the encoder failed
+int ExportEncoder::finish()
+{
+	// A block without frames ends the thread
+	m_freeCount.acquire();
+
+	Block* block;
+	m_free.read(&block, 1);
+	block->nframes = 0;
+
+	m_filled.write(&block, 1);
+	m_filledCount.release();
+
+	wait();
+
+	return t_atomic_int_get(&m_failed) ? -1 : 0;
+}
+
+void ExportEncoder::run()
+{
+	while (true) {
+		m_filledCount.acquire();
+
+		Block* block;
+		m_filled.read(&block, 1);
+
+		if (block->nframes == 0) {
+			return;
+		}
+
+		// Once failed, keep taking blocks so the render thread doesn't block
+		if (!t_atomic_int_get(&m_failed) && m_source->process(block->data, block->nframes, block->endOfInput)) {
+			t_atomic_int_set(&m_failed, 1);
+		}
+
+		m_free.write(&block, 1);
+		m_freeCount.release();
+	}
+}
+
+ExportTarget::ExportTarget()
+{
+	data_width = -1;
+	sample_rate = 0;
+	dither_type = GDitherShaped;
+}
+
 ExportSpecification::ExportSpecification()
 {
     sample_rate = 0;
@@ -59,6 +266,8 @@ ExportSpecification::ExportSpecification()
     dither_type = GDitherShaped;
 
     dataF = nullptr;
+    spill = nullptr;
+    spillRamSize = 0;
     blocksize = 0;
 	data_width = -1;
 	
@@ -80,6 +289,27 @@ ExportSpecification::ExportSpecification()
 	isCdExport = false;
 }
 
+// Returns a copy of this specification writing the format of target,
+// owned by the caller
+ExportSpecification* ExportSpecification::create_target_specification(const ExportTarget& target) const
+{
+	ExportSpecification* spec = new ExportSpecification(*this);
+
+	spec->writerType = target.writerType;
+	if (target.data_width != -1) {
+		spec->data_width = target.data_width;
+	}
+	if (target.sample_rate != 0) {
+		spec->sample_rate = target.sample_rate;
+	}
+	spec->dither_type = target.dither_type;
+	spec->extraFormat = target.extraFormat;
+	spec->name += target.suffix;
+	spec->targets.clear();
+
+	return spec;
+}
+
 int ExportSpecification::is_valid()
 {
 
@@ -26,21 +26,44 @@ $Id: Export.h,v 1.20 2009/05/07 19:59:03 n_doebelin Exp $
 #include <QThread>
 #include <QString>
 #include <QMap>
+#include <QVector>
+#include <QSemaphore>
 
 #include <samplerate.h>
 
 #include "defines.h"
 #include "gdither.h"
+#include "RingBufferNPT.h"
 
 class Project;
 class ExportThread;
+class ExportSpill;
 class Marker;
+class WriteSource;
+class QTemporaryFile;
+
+// A file format written by an export. One render can feed several of them,
+// e.g. a wav master and mp3 and ogg previews. The suffix is appended to the
+// file name, and keeps targets with the same extension apart. A sample rate
+// of 0 or data width of -1 keeps the one of the specification.
+struct ExportTarget
+{
+	ExportTarget();
+
+	QString		writerType;
+	int		data_width;
+    uint		sample_rate;
+	GDitherType	dither_type;
+	QMap<QString, QString>	extraFormat;
+	QString		suffix;
+};
 
 struct ExportSpecification
 {
 	ExportSpecification();
 	
 	int is_valid();
+	ExportSpecification* create_target_specification(const ExportTarget& target) const;
 	
 	enum RenderPass {
 		CALC_NORM_FACTOR,
@@ -61,12 +84,16 @@ struct ExportSpecification
 
 	QString		writerType;
 	float*          dataF;
+	ExportSpill*	spill;
+	qint64		spillRamSize;	/* bytes a spill may keep in memory */
     uint		blocksize;
 	int	        data_width;
 
 	TimeRef      	totalTime;
 	TimeRef      	pos;
 	QMap<QString, QString>	extraFormat;
+	// if not empty, these are written instead of the format above
+	QList<ExportTarget>	targets;
 
 	/* shared between UI thread and audio thread */
 
@@ -98,6 +125,65 @@ struct ExportSpecification
 };
 
 
+// Holds the interleaved mix of a normalised export, rendered by the norm
+// factor pass, so the write pass doesn't have to mix it again. Kept in memory
+// up to ramSize bytes, else in a temporary file in the export dir.
+class ExportSpill
+{
+public:
+	ExportSpill(const QString& dir, qint64 expectedSamples, qint64 ramSize);
+	~ExportSpill();
+
+	bool write(const audio_sample_t* data, nframes_t count);
+	nframes_t read(audio_sample_t* data, nframes_t count);
+	void rewind();
+	bool failed() const {return m_failed;}
+
+private:
+	QVector<audio_sample_t>	m_ram;
+	QTemporaryFile*		m_file;
+	QString			m_dir;
+	qint64			m_ramSize;
+	int			m_readPos;
+	bool			m_failed;
+
+	bool open_file();
+};
+
+
+// Runs the resampling, dithering and encoding of a WriteSource on it's own
+// thread, so they overlap with mixing the next block. Blocks are passed
+// through lock free queues, the semaphores only wake up the waiting side.
+class ExportEncoder : public QThread
+{
+public:
+	ExportEncoder(WriteSource* source, uint channels, nframes_t blocksize, int depth);
+	~ExportEncoder();
+
+	int write(const audio_sample_t* data, nframes_t nframes, bool endOfInput);
+	int finish();
+
+protected:
+	void run();
+
+private:
+	struct Block {
+		audio_sample_t*	data;
+		nframes_t	nframes;
+		bool		endOfInput;
+	};
+
+	WriteSource*		m_source;
+	uint			m_channels;
+	QVector<Block>		m_blocks;
+	RingBufferNPT<Block*>	m_free;
+	RingBufferNPT<Block*>	m_filled;
+	QSemaphore		m_freeCount;
+	QSemaphore		m_filledCount;
+	volatile int		m_failed;
+};
+
+
 class ExportThread : public QThread
 {
 	Q_OBJECT
@@ -119,4 +205,19 @@ private:
 };
 
 
+// Renders sheets of a parallel export until none are left
+class ExportWorker : public QThread
+{
+public:
+	ExportWorker(Project* project);
+	~ExportWorker()
+	{}
+
+	void run();
+
+private:
+	Project*		m_project;
+};
+
+
 #endif
@@ -32,11 +32,14 @@ $Id: FadeCurve.cpp,v 1.36 2008/11/07 10:43:08 r_sijrier Exp $
 #include <AddRemove.h>
 #include "AudioDevice.h"
 #include "AudioBus.h"
+#include "Mixer.h"
 
 // Always put me below _all_ includes, this is needed
 // in case we run with memory leak detection enabled!
 #include "Debugger.h"
 
+// The gain table is applied as linear ramps of this length
+#define FADE_RAMP_FRAMES 32
 
 QStringList FadeCurve::defaultShapes = QStringList() << "Fastest" << "Fast" << "Linear"  << "Slow" << "Slowest";
 
@@ -66,6 +69,7 @@ FadeCurve::FadeCurve(AudioClip* clip, Sheet* sheet, const QString& type )
 	m_mode = 2;
 	m_raster = 0;
 	m_bypass = false;
+	m_tableDirty = 1;
 	
 	connect(this, SIGNAL(stateChanged()), this, SLOT(solve_node_positions()));
 	connect(this, SIGNAL(bendValueChanged()), this, SIGNAL(stateChanged()));
@@ -167,7 +171,7 @@ int FadeCurve::set_state( const QDomNode & node )
 }
 
 
-void FadeCurve::process(AudioBus *bus, nframes_t nframes)
+void FadeCurve::process(audio_sample_t** buffers, uint channels, nframes_t nframes)
 {
 
         if (is_bypassed()) {
@@ -206,16 +210,15 @@ void FadeCurve::process(AudioBus *bus, nframes_t nframes)
                         mix_pos = TimeRef();
 //                        printf("offset %d\n", offset);
 
-                        for (int chan=0; chan<bus->get_channel_count(); ++chan) {
-                                audio_sample_t* buf = bus->get_buffer(chan, framesToProcess);
-                                mixdown[chan] = buf + offset;
+                        for (uint chan=0; chan<channels; ++chan) {
+                                mixdown[chan] = buffers[chan] + offset;
                         }
                         framesToProcess = framesToProcess - offset;
                 } else {
                         mix_pos = (transportLocation - trackStartLocation);
 
-                        for (int chan=0; chan<bus->get_channel_count(); ++chan) {
-                                mixdown[chan] = bus->get_buffer(chan, framesToProcess);
+                        for (uint chan=0; chan<channels; ++chan) {
+                                mixdown[chan] = buffers[chan];
                         }
                 }
                 if (trackEndLocation < upperRange) {
@@ -230,15 +233,70 @@ void FadeCurve::process(AudioBus *bus, nframes_t nframes)
         }
 
 
+        if (t_atomic_int_get(&m_tableDirty)) {
+                update_gain_table();
+        }
+
+        // Walk the fade in short ramps, each ramp is interpolated from the gain table
         upperRange = mix_pos + TimeRef(framesToProcess, outputRate);
+        double range = fadeRange.universal_frame();
+        double x0 = mix_pos.universal_frame() / range;
+        double dx = (upperRange.universal_frame() - mix_pos.universal_frame()) / (range * framesToProcess);
+
+        float startGain = get_table_gain(x0);
+        nframes_t pos = 0;
+
+        while (pos < framesToProcess) {
+                nframes_t len = qMin(nframes_t(FADE_RAMP_FRAMES), framesToProcess - pos);
+                float endGain = get_table_gain(x0 + (pos + len) * dx);
+
+                for (uint chan=0; chan<channels; ++chan) {
+                        if (startGain == endGain) {
+                                if (startGain != 1.0f) {
+                                        Mixer::apply_gain_to_buffer(mixdown[chan] + pos, len, startGain);
+                                }
+                        } else {
+                                Mixer::apply_gain_ramp(mixdown[chan] + pos, len, startGain, endGain);
+                        }
+                }
+
+                startGain = endGain;
+                pos += len;
+        }
+}
 
-        get_vector(mix_pos.universal_frame(), upperRange.universal_frame(), m_session->gainbuffer, framesToProcess);
+void FadeCurve::update_gain_table()
+{
+        // Clear the flag first, a change during the update will trigger another one
+        t_atomic_int_set(&m_tableDirty, 0);
 
-        for (int chan=0; chan<bus->get_channel_count(); ++chan) {
-                for (nframes_t frame = 0; frame < framesToProcess; ++frame) {
-                        mixdown[chan][frame] *= m_session->gainbuffer[frame];
-                }
+        // get_vector() includes both ends, so entry i is at i / FADE_TABLE_SIZE
+        double range = get_range();
+        get_vector(0.0, range, m_gainTable, FADE_TABLE_SIZE + 1);
+}
+
+// position is relative to the range, 0.0 is the start of the fade, 1.0 the end
+float FadeCurve::get_table_gain(double position) const
+{
+        if (position <= 0.0) {
+                return m_gainTable[0];
+        }
+
+        double index = position * FADE_TABLE_SIZE;
+        int i = int(index);
+
+        if (i >= FADE_TABLE_SIZE) {
+                return m_gainTable[FADE_TABLE_SIZE];
         }
+
+        float fraction = float(index - i);
+        return m_gainTable[i] + (m_gainTable[i + 1] - m_gainTable[i]) * fraction;
+}
+
+void FadeCurve::set_changed()
+{
+        Curve::set_changed();
+        t_atomic_int_set(&m_tableDirty, 1);
 }
 
 
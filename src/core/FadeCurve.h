@@ -52,7 +52,8 @@ public:
 	QDomNode get_state(QDomDocument doc);
 	int set_state( const QDomNode & node );
 	
-        void process(AudioBus* bus, nframes_t nframes);
+        // buffers start at the transport location, like the Track process bus
+        void process(audio_sample_t** buffers, uint channels, nframes_t nframes);
 	
 	float get_bend_factor() {return m_bendFactor;}
 	float get_strength_factor() {return m_strenghtFactor;}
@@ -85,6 +86,19 @@ private:
 	
 	QPointF get_curve_point(float f);
 	void init();
+
+	// The fade shape, sampled at FADE_TABLE_SIZE + 1 evenly spaced points over
+	// the (normalized) range, both ends included. Rebuilt by the audio thread
+	// on the first process() call after the Curve changed.
+	static const int FADE_TABLE_SIZE = 1024;
+	float		m_gainTable[FADE_TABLE_SIZE + 1];
+	volatile int	m_tableDirty;
+
+	void update_gain_table();
+	float get_table_gain(double position) const;
+
+protected:
+	void set_changed();
 	
 public slots:
 	void solve_node_positions();
@@ -29,6 +29,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.
 #include "defines.h"
 #include "Mixer.h"
 #include "FileHelpers.h"
+#include "TAudioTileCache.h"
 #include <QFileInfo>
 #include <QDateTime>
 #include <QMutexLocker>
@@ -37,7 +38,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.
 
 #define NORMALIZE_CHUNK_SIZE	10000
 #define PEAKFILE_MAJOR_VERSION	1
-#define PEAKFILE_MINOR_VERSION	4
+#define PEAKFILE_MINOR_VERSION	5
 
 int Peak::zoomStep[] = {
     // non-cached zoomlevels.
@@ -91,13 +92,11 @@ Peak::~Peak()
 {
     PENTERDES;
 
+    audio_tile_cache().cancel_requests(this);
+
     delete m_source;
 
     foreach(ChannelData* data, m_channelData) {
-        if (data->normFile.isOpen()) {
-            QFile::remove(data->normFileName);
-        }
-
         delete data->peakreader;
         delete data;
     }
@@ -165,6 +164,12 @@ int Peak::read_header()
         data->file.read((char*)&data->headerdata.normValuesDataOffset, sizeof(data->headerdata.normValuesDataOffset));
         data->file.read((char*)&data->headerdata.headerSize, sizeof(data->headerdata.headerSize));
 
+        // Waveform drawing reads the peak data straight from the mapped file
+        data->fileMap = data->file.map(0, data->file.size());
+        if (!data->fileMap) {
+            PWARN(QString("Couldn't map peak file, falling back to reading it (%1)").arg(data->fileName).toLatin1().data());
+        }
+
         data->peakreader = new PeakDataReader(data);
         data->peakdataDecodeBuffer = new DecodeBuffer;
     }
@@ -205,16 +210,14 @@ void Peak::start_peak_loading()
     pp().queue_task(this);
 }
 
-
-int Peak::calculate_peaks(
-        int chan,
-        float ** buffer,
-        TimeRef startlocation,
-        int peakDataCount,
-        qreal framesPerPeak)
+void Peak::prioritize_peak_loading()
 {
-    PENTER3;
+    pp().prioritize_task(this);
+}
+
 
+int Peak::check_peak_data(int peakDataCount)
+{
     if (m_permanentFailure) {
         return PERMANENT_FAILURE;
     }
@@ -229,72 +232,156 @@ int Peak::calculate_peaks(
         return NO_PEAKDATA_FOUND;
     }
 
+    return 1;
+}
+
+
+/**
+ * Points buffer to peakDataCount values of the cached zoom level closest
+ * to framesPerPeak (>= 64), starting at startlocation. The data stays
+ * valid until the next call for this channel.
+ *
+ * Returns the amount of available values, which can be less than requested
+ * at the end of the peak data.
+ */
+int Peak::calculate_peaks(
+        int chan,
+        const peak_data_t** buffer,
+        TimeRef startlocation,
+        int peakDataCount,
+        qreal framesPerPeak)
+{
+    PENTER3;
+
+    int result = check_peak_data(peakDataCount);
+    if (result < 0) {
+        return result;
+    }
+
     ChannelData* data = m_channelData.at(chan);
-    int produced = 0;
 
-    // 	PROFILE_START;
+    int highbit;
+    unsigned long nearestpow2 = nearest_power_of_two(qRound(framesPerPeak), highbit);
+    if (nearestpow2 == 0) {
+        return NO_PEAKDATA_FOUND;
+    }
 
-    // Macro view mode
-    if (framesPerPeak >= 64) {
-        int highbit;
-        unsigned long nearestpow2 = nearest_power_of_two(qRound(framesPerPeak), highbit);
-        if (nearestpow2 == 0) {
-            return NO_PEAKDATA_FOUND;
-        }
+    nframes_t startPos = startlocation.to_frame(44100);
 
+    int index = cache_index_lut()->value(nearestpow2, -1);
+    if (index < 0) {
+        return NO_PEAKDATA_FOUND;
+    }
 
-        nframes_t startPos = startlocation.to_frame(44100);
+    int offset = qRound(float(startPos) / nearestpow2) * 2;
 
-        int index = cache_index_lut()->value(nearestpow2, -1);
-        if(index >= 0) {
-            // 			printf("index %d\n", index);
-        }
+    // Don't hand out data of the next zoom level
+    int available = qMin(peakDataCount, data->headerdata.peakDataSizeForLevel[index] - offset);
+    if (available <= 0) {
+        return NO_PEAKDATA_FOUND;
+    }
 
-        int offset = qRound(float(startPos) / nearestpow2) * 2;
-        int truncate = 0;
+    nframes_t readposition = data->headerdata.headerSize + (data->headerdata.peakDataOffsets[index] + offset) * sizeof(peak_data_t);
 
-        // Check if this zoom level has as many data as requested.
-        if ( (peakDataCount + offset) > data->headerdata.peakDataSizeForLevel[index]) {
-            truncate = peakDataCount - (data->headerdata.peakDataSizeForLevel[index] - offset);
-            //FIXME: nothing done here?
-            //            qDebug("Peak::calculate_peaks truncate: %d", truncate);
-            //            peakDataCount = data->headerdata.peakDataSizeForLevel[index] - offset;
-        }
+    if (data->fileMap) {
+        *buffer = reinterpret_cast<const peak_data_t*>(data->fileMap + readposition);
+        return available;
+    }
 
-        nframes_t readposition = data->headerdata.headerSize + (data->headerdata.peakDataOffsets[index] + offset) * sizeof(peak_data_t);
-        produced = data->peakreader->read_from(data->peakdataDecodeBuffer, readposition, peakDataCount);
+    if (data->peakReadBuffer.size() < available) {
+        data->peakReadBuffer.resize(available);
+    }
 
-        if (produced != peakDataCount) {
-            //			PERROR("Could not read in all peak data, peakDataCount is %d, read count is %d", peakDataCount, produced);
-        }
+    int produced = data->peakreader->read_from(data->peakReadBuffer.data(), readposition, available);
 
-        // 		PROFILE_END("Peak calculate_peaks");
+    if (produced == 0) {
+        return NO_PEAKDATA_FOUND;
+    }
 
-        if (produced == 0) {
-            return NO_PEAKDATA_FOUND;
-        }
+    *buffer = data->peakReadBuffer.constData();
 
-        // 		for (int i=(pixelcount-truncate); i<(pixelcount); ++i) {
-        // 			data->peakdataDecodeBuffer->destination[0][i] = 0;
-        // 		}
-        //
-        *buffer = data->peakdataDecodeBuffer->destination[0];
+    return produced;
+}
 
-        return produced;
 
-        // Micro view mode
+/**
+ * Calculates peakDataCount values from the audio source itself, used for
+ * zoom levels below the first cached one. Unlike calculate_peaks() there is
+ * one value per peak, the sample value with the highest magnitude.
+ *
+ * The audio comes from the micro view tile cache, if part of it isn't decoded
+ * yet DATA_PENDING is returned, and TAudioTileCache::tileAvailable() is
+ * emitted once it is.
+ */
+int Peak::calculate_micro_peaks(
+        int chan,
+        float** buffer,
+        TimeRef startlocation,
+        int peakDataCount,
+        qreal framesPerPeak)
+{
+    PENTER3;
+
+    int result = check_peak_data(peakDataCount);
+    if (result < 0) {
+        return result;
     }
+
+    ChannelData* data = m_channelData.at(chan);
+
     // Calculate the amount of frames to be read
     nframes_t toRead = qRound(peakDataCount * framesPerPeak * qreal(m_source->get_file_rate()) / qreal(44100));
 
-    nframes_t readFrames = m_source->file_read(data->peakdataDecodeBuffer, startlocation, toRead);
+    uint rate = m_source->get_output_rate();
+    nframes_t startFrame = startlocation.to_frame(rate);
+    nframes_t sourceFrames = m_source->get_nframes();
 
-    if (readFrames == 0) {
+    if (toRead == 0 || startFrame >= sourceFrames) {
         return NO_PEAKDATA_FOUND;
     }
 
-    if ( readFrames != toRead) {
-        PWARN(QString("Unable to read nframes %1 (only %2 available)").arg(toRead).arg(readFrames).toLatin1().data());
+    toRead = qMin(toRead, sourceFrames - startFrame);
+
+    data->peakdataDecodeBuffer->check_buffers_capacity(qMax(toRead, nframes_t(peakDataCount)), 1);
+    audio_sample_t* samples = data->peakdataDecodeBuffer->destination[0];
+
+    TAudioTileCache& cache = audio_tile_cache();
+    qint64 firstTile = startFrame / TAudioTileCache::TILE_FRAMES;
+    qint64 lastTile = (startFrame + toRead - 1) / TAudioTileCache::TILE_FRAMES;
+    nframes_t readFrames = 0;
+    bool pending = false;
+
+    for (qint64 tile = firstTile; tile <= lastTile; ++tile) {
+        QVector<audio_sample_t> tileSamples;
+
+        if (!cache.get_tile(m_source->get_id(), rate, chan, tile, tileSamples)) {
+            cache.request_tile(this, tile);
+            pending = true;
+            continue;
+        }
+
+        if (pending) {
+            continue;
+        }
+
+        nframes_t tileStart = nframes_t(tile * TAudioTileCache::TILE_FRAMES);
+        nframes_t from = startFrame + readFrames - tileStart;
+
+        if (from >= nframes_t(tileSamples.size())) {
+            break;
+        }
+
+        nframes_t count = qMin(nframes_t(tileSamples.size()) - from, toRead - readFrames);
+        memcpy(samples + readFrames, tileSamples.constData() + from, count * sizeof(audio_sample_t));
+        readFrames += count;
+    }
+
+    if (pending) {
+        return DATA_PENDING;
+    }
+
+    if (readFrames == 0) {
+        return NO_PEAKDATA_FOUND;
     }
 
     int count = 0;
@@ -316,7 +403,7 @@ int Peak::calculate_peaks(
 
         pd.processLocation += pd.stepSize;
 
-        sample = data->peakdataDecodeBuffer->destination[chan][i];
+        sample = samples[i];
 
         pd.normValue = f_max(pd.normValue, fabsf(sample));
 
@@ -361,9 +448,6 @@ int Peak::prepare_processing(uint rate)
 
     foreach(ChannelData* data, m_channelData) {
 
-        data->normFileName = data->fileName;
-        data->normFileName.append(".norm");
-
         // Create read/write enabled file
         data->file.setFileName(data->fileName);
 
@@ -373,15 +457,6 @@ int Peak::prepare_processing(uint rate)
             return -1;
         }
 
-        // Create the temporary normalization data file
-        data->normFile.setFileName(data->normFileName);
-
-        if (! data->normFile.open(QIODevice::ReadWrite)) {
-            PWARN(QString("Couldn't open normalization data file for writing! (%1)").arg(data->normFileName).toLatin1().data());
-            m_permanentFailure  = true;
-            return -1;
-        }
-
         // We need to know the headerSize.
         data->headerdata.headerSize =
                 sizeof(data->headerdata.label) +
@@ -397,6 +472,7 @@ int Peak::prepare_processing(uint rate)
         data->pd = new Peak::ProcessData;
         data->pd->stepSize = TimeRef(nframes_t(1), rate);
         data->pd->processRange = TimeRef(nframes_t(64), 44100);
+        data->pd->peakWriteBuffer = new peak_data_t[PEAK_WRITE_BUFFER_SIZE];
     }
 
 
@@ -410,97 +486,64 @@ int Peak::finish_processing()
 
     foreach(ChannelData* data, m_channelData) {
 
-        if (data->pd->processLocation < data->pd->nextDataPointLocation) {
-            peak_data_t peakvalue = (peak_data_t)(data->pd->peakUpperValue * MAX_DB_VALUE);
-            data->file.write((char*)&peakvalue, sizeof(peak_data_t));
-            peakvalue = (peak_data_t)(-1 * data->pd->peakLowerValue * MAX_DB_VALUE);
-            data->file.write((char*)&peakvalue, sizeof(peak_data_t));
-            data->pd->processBufferSize += 2;
-        }
-
-        int totalBufferSize = 0;
+        ProcessData* pd = data->pd;
 
-        data->headerdata.peakDataSizeForLevel[0] = data->pd->processBufferSize;
-        totalBufferSize += data->pd->processBufferSize;
-
-        for( int i = SAVING_ZOOM_FACTOR + 1; i < ZOOM_LEVELS+1; ++i) {
-            data->headerdata.peakDataSizeForLevel[i - SAVING_ZOOM_FACTOR] = data->headerdata.peakDataSizeForLevel[i - SAVING_ZOOM_FACTOR - 1] / 2;
-            totalBufferSize += data->headerdata.peakDataSizeForLevel[i - SAVING_ZOOM_FACTOR];
+        if (pd->processLocation < pd->nextDataPointLocation) {
+            if (pd->peakWriteBufferFill == PEAK_WRITE_BUFFER_SIZE) {
+                flush_process_buffers(data);
+            }
+            peak_data_t upper = (peak_data_t)(pd->peakUpperValue * MAX_DB_VALUE);
+            peak_data_t lower = (peak_data_t)(-1 * pd->peakLowerValue * MAX_DB_VALUE);
+            pd->peakWriteBuffer[pd->peakWriteBufferFill++] = upper;
+            pd->peakWriteBuffer[pd->peakWriteBufferFill++] = lower;
+            pd->processBufferSize += 2;
+            push_pyramid_pair(pd, 1, upper, lower);
         }
 
+        flush_process_buffers(data);
 
-        data->file.seek(data->headerdata.headerSize);
-
-        // The routine below uses a different total buffer size calculation
-        // which might end up with a size >= totalbufferSize !!!
-        // Need to look into that, for now + 2 seems to work...
-        peak_data_t* saveBuffer = new peak_data_t[totalBufferSize + 1*sizeof(peak_data_t)];
-
-        int read = data->file.read((char*)saveBuffer, sizeof(peak_data_t) * data->pd->processBufferSize) / sizeof(peak_data_t);
-
-        if (read != data->pd->processBufferSize) {
-            //			PERROR("couldn't read in all saved data?? (%d read)", read);
+        // A pair without a partner still covers the tail of the audio, so keep it
+        // in it's own level, and pass it on to the next one.
+        for (int level = 1; level < CACHED_ZOOM_LEVELS; ++level) {
+            if (pd->hasPendingPair[level]) {
+                pd->hasPendingPair[level] = false;
+                pd->levelData[level].append(pd->pendingPair[level][0]);
+                pd->levelData[level].append(pd->pendingPair[level][1]);
+                push_pyramid_pair(pd, level + 1, pd->pendingPair[level][0], pd->pendingPair[level][1]);
+            }
         }
 
-
-        int prevLevelBufferPos = 0;
-        int nextLevelBufferPos;
-        data->headerdata.peakDataSizeForLevel[0] = data->pd->processBufferSize;
+        // Level 0 is already on disk, append the coarser levels and the norm values
         data->headerdata.peakDataOffsets[0] = 0;
+        data->headerdata.peakDataSizeForLevel[0] = pd->processBufferSize;
 
-        for (int i = SAVING_ZOOM_FACTOR+1; i < ZOOM_LEVELS+1; ++i) {
+        for (int level = 1; level < CACHED_ZOOM_LEVELS; ++level) {
+            data->headerdata.peakDataOffsets[level] = data->headerdata.peakDataOffsets[level - 1] + data->headerdata.peakDataSizeForLevel[level - 1];
+            data->headerdata.peakDataSizeForLevel[level] = pd->levelData[level].size();
 
-            int prevLevelSize = data->headerdata.peakDataSizeForLevel[i - SAVING_ZOOM_FACTOR - 1];
-            data->headerdata.peakDataOffsets[i - SAVING_ZOOM_FACTOR] = data->headerdata.peakDataOffsets[i - SAVING_ZOOM_FACTOR - 1] + prevLevelSize;
-            prevLevelBufferPos = data->headerdata.peakDataOffsets[i - SAVING_ZOOM_FACTOR - 1];
-            nextLevelBufferPos = data->headerdata.peakDataOffsets[i - SAVING_ZOOM_FACTOR];
+            int written = data->file.write((char*)pd->levelData[level].constData(), sizeof(peak_data_t) * pd->levelData[level].size()) / sizeof(peak_data_t);
 
-
-            int count = 0;
-
-            do {
-                Q_ASSERT(nextLevelBufferPos <= totalBufferSize);
-                saveBuffer[nextLevelBufferPos] = (peak_data_t) f_max(saveBuffer[prevLevelBufferPos], saveBuffer[prevLevelBufferPos + 2]);
-                saveBuffer[nextLevelBufferPos + 1] = (peak_data_t) f_max(saveBuffer[prevLevelBufferPos + 1], saveBuffer[prevLevelBufferPos + 3]);
-                nextLevelBufferPos += 2;
-                prevLevelBufferPos += 4;
-                count+=4;
+            if (written != pd->levelData[level].size()) {
+                PWARN(QString("couldnt write peak data, only (%1)").arg(written).toLatin1().data());
             }
-            while (count < prevLevelSize);
-        }
-
-        data->file.seek(data->headerdata.headerSize);
-
-        int written = data->file.write((char*)saveBuffer, sizeof(peak_data_t) * totalBufferSize) / sizeof(peak_data_t);
-
-        if (written != totalBufferSize) {
-            //			PERROR("could not write complete buffer! (only %d)", written);
-            // 		return -1;
-        }
-
-        data->normFile.seek(0);
-
-        read = data->normFile.read((char*)saveBuffer, sizeof(audio_sample_t) * data->pd->normDataCount) / sizeof(audio_sample_t);
-
-        if (read != data->pd->normDataCount) {
-            //			PERROR("Could not read in all (%d) norm. data, only %d", data->pd->normDataCount, read);
         }
 
+        int totalBufferSize = data->headerdata.peakDataOffsets[CACHED_ZOOM_LEVELS - 1] + data->headerdata.peakDataSizeForLevel[CACHED_ZOOM_LEVELS - 1];
         data->headerdata.normValuesDataOffset = data->headerdata.headerSize + totalBufferSize * sizeof(peak_data_t);
 
-        data->normFile.close();
+        int written = data->file.write((char*)pd->normData.constData(), sizeof(audio_sample_t) * pd->normData.size()) / sizeof(audio_sample_t);
 
-        if (!QFile::remove(data->normFileName)) {
-            //			PERROR("Failed to remove temp. norm. data file! (%s)", data->normFileName.toLatin1().data());
+        if (written != pd->normData.size()) {
+            PWARN(QString("couldnt write norm data, only (%1)").arg(written).toLatin1().data());
         }
 
-        written = data->file.write((char*)saveBuffer, sizeof(audio_sample_t) * read) / sizeof(audio_sample_t);
+        // A rebuild may be shorter than the previous file
+        data->file.resize(data->file.pos());
 
         write_header(data);
 
         data->file.close();
 
-        delete [] saveBuffer;
         delete data->pd;
         data->pd = nullptr;
 
@@ -518,35 +561,50 @@ void Peak::process(uint channel, const audio_sample_t* buffer, nframes_t nframes
     ChannelData* data = m_channelData.at(channel);
     ProcessData* pd = data->pd;
 
-    for (uint i=0; i < nframes; i++) {
+    qint64 step = pd->stepSize.universal_frame();
 
-        pd->processLocation += pd->stepSize;
+    while (nframes) {
+        // The amount of frames up to and including the one which completes
+        // the current peak value, and the current norm value
+        qint64 toPeak = (pd->nextDataPointLocation.universal_frame() - pd->processLocation.universal_frame() + step - 1) / step;
+        nframes_t toNorm = NORMALIZE_CHUNK_SIZE - pd->normProcessedFrames + 1;
 
-        audio_sample_t sample = buffer[i];
+        nframes_t count = qMin(nframes, toNorm);
+        if (toPeak < count) {
+            count = nframes_t(qMax(qint64(1), toPeak));
+        }
 
-        pd->normValue = f_max(pd->normValue, fabsf(sample));
+        audio_sample_t blockMin = buffer[0];
+        audio_sample_t blockMax = buffer[0];
+        Mixer::find_peaks(buffer, count, &blockMin, &blockMax);
 
-        if (sample > pd->peakUpperValue) {
-            pd->peakUpperValue = sample;
-        }
+        pd->normValue = f_max(pd->normValue, f_max(blockMax, -blockMin));
 
-        if (sample < pd->peakLowerValue) {
-            pd->peakLowerValue = sample;
+        if (blockMax > pd->peakUpperValue) {
+            pd->peakUpperValue = blockMax;
         }
 
-        if (pd->processLocation >= pd->nextDataPointLocation) {
-
-            peak_data_t peakbuffer[2];
+        if (blockMin < pd->peakLowerValue) {
+            pd->peakLowerValue = blockMin;
+        }
 
-            peakbuffer[0] = (peak_data_t) (pd->peakUpperValue * MAX_DB_VALUE );
-            peakbuffer[1] = (peak_data_t) (-1 * (pd->peakLowerValue * MAX_DB_VALUE ));
+        pd->processLocation += step * count;
+        pd->normProcessedFrames += count;
+        buffer += count;
+        nframes -= count;
 
-            int written = data->file.write((char*)peakbuffer, sizeof(peak_data_t) * 2) / sizeof(peak_data_t);
+        if (pd->processLocation >= pd->nextDataPointLocation) {
 
-            if (written != 2) {
-                PWARN(QString("couldnt write peak data, only (%1)").arg(written).toLatin1().data());
+            if (pd->peakWriteBufferFill == PEAK_WRITE_BUFFER_SIZE) {
+                flush_process_buffers(data);
             }
 
+            peak_data_t upper = (peak_data_t) (pd->peakUpperValue * MAX_DB_VALUE );
+            peak_data_t lower = (peak_data_t) (-1 * (pd->peakLowerValue * MAX_DB_VALUE ));
+            pd->peakWriteBuffer[pd->peakWriteBufferFill++] = upper;
+            pd->peakWriteBuffer[pd->peakWriteBufferFill++] = lower;
+            push_pyramid_pair(pd, 1, upper, lower);
+
             pd->peakUpperValue = -10.0;
             pd->peakLowerValue = 10.0;
 
@@ -554,19 +612,50 @@ void Peak::process(uint channel, const audio_sample_t* buffer, nframes_t nframes
             pd->nextDataPointLocation += pd->processRange;
         }
 
-        if (pd->normProcessedFrames == NORMALIZE_CHUNK_SIZE) {
-            int written = data->normFile.write((char*)&pd->normValue, sizeof(audio_sample_t)) / sizeof(audio_sample_t);
-
-            if (written != 1) {
-                PWARN(QString("couldnt write norm data, only (%1)").arg(written).toLatin1().data());
-            }
+        if (count == toNorm) {
+            pd->normData.append(pd->normValue);
 
             pd->normValue = 0.0;
-            pd->normProcessedFrames = 0;
+            pd->normProcessedFrames = 1;
             pd->normDataCount++;
         }
+    }
+}
+
+void Peak::flush_process_buffers(ChannelData* data)
+{
+    ProcessData* pd = data->pd;
+
+    if (pd->peakWriteBufferFill) {
+        int written = data->file.write((char*)pd->peakWriteBuffer, sizeof(peak_data_t) * pd->peakWriteBufferFill) / sizeof(peak_data_t);
+
+        if (written != pd->peakWriteBufferFill) {
+            PWARN(QString("couldnt write peak data, only (%1)").arg(written).toLatin1().data());
+        }
 
-        pd->normProcessedFrames++;
+        pd->peakWriteBufferFill = 0;
+    }
+}
+
+void Peak::push_pyramid_pair(ProcessData* pd, int level, peak_data_t upper, peak_data_t lower)
+{
+    // Each level holds the maximum of two consecutive pairs of the level below
+    while (level < CACHED_ZOOM_LEVELS) {
+        if (!pd->hasPendingPair[level]) {
+            pd->pendingPair[level][0] = upper;
+            pd->pendingPair[level][1] = lower;
+            pd->hasPendingPair[level] = true;
+            return;
+        }
+
+        upper = qMax(pd->pendingPair[level][0], upper);
+        lower = qMax(pd->pendingPair[level][1], lower);
+        pd->hasPendingPair[level] = false;
+
+        pd->levelData[level].append(upper);
+        pd->levelData[level].append(lower);
+
+        ++level;
     }
 }
 
@@ -657,6 +746,8 @@ audio_sample_t Peak::get_max_amplitude(TimeRef startlocation, TimeRef endlocatio
             return 0.0f;
         }
     }
+    QMutexLocker sourceLocker(&m_sourceMutex);
+
     int rate = m_source->get_file_rate();
     nframes_t startframe = startlocation.to_frame(rate);
     nframes_t endframe = endlocation.to_frame(rate);
@@ -731,105 +822,144 @@ PeakProcessor& pp()
 
 PeakProcessor::PeakProcessor()
 {
-    m_ppthread = new PPThread(this);
-    m_taskRunning = false;
-    m_runningPeak = 0;
+    m_quit = false;
 
-    moveToThread(m_ppthread);
-
-    m_ppthread->start();
+    // A value of 0 (the default) means: pick a value based on the amount of cores.
+    // Peak building is partly disk bound, so more than a few threads won't help.
+    int threadCount = config().get_property("Hardware", "peakbuildthreads", 0).toInt();
+    if (threadCount <= 0) {
+        threadCount = qBound(1, QThread::idealThreadCount() / 2, 4);
+    }
 
-    connect(this, SIGNAL(newTask()), this, SLOT(start_task()), Qt::QueuedConnection);
+    for (int i=0; i<threadCount; ++i) {
+        PPThread* worker = new PPThread(this);
+        m_workers.append(worker);
+        worker->start(QThread::LowPriority);
+    }
 }
 
 
 PeakProcessor::~ PeakProcessor()
 {
-    m_ppthread->exit(0);
+    m_mutex.lock();
+    m_quit = true;
+    m_taskAvailable.wakeAll();
+    m_mutex.unlock();
 
-    if (!m_ppthread->wait(1000)) {
-        m_ppthread->terminate();
+    foreach(PPThread* worker, m_workers) {
+        if (!worker->wait(1000)) {
+            worker->terminate();
+        }
+        delete worker;
     }
-
-    delete m_ppthread;
 }
 
 
-void PeakProcessor::start_task()
+// Called from the worker threads, blocks until there is work or we quit
+Peak* PeakProcessor::take_task()
 {
-    m_runningPeak->create_from_scratch();
+    QMutexLocker locker(&m_mutex);
+
+    while (!m_quit) {
+        for (int i=0; i<m_queue.size(); ++i) {
+            Peak* peak = m_queue.at(i);
+
+            // The Peak for the same file is being build already, it will
+            // be finished by that one
+            if (is_building(peak->m_source->get_filename())) {
+                continue;
+            }
+
+            m_queue.removeAt(i);
+            m_runningPeaks.append(peak);
+            return peak;
+        }
 
+        m_taskAvailable.wait(&m_mutex);
+    }
+
+    return nullptr;
+}
+
+void PeakProcessor::task_finished(Peak* peak)
+{
     QMutexLocker locker(&m_mutex);
 
-    m_taskRunning = false;
+    m_runningPeaks.removeAll(peak);
+
+    // Queued Peaks of the same file might be waiting for this one
+    m_taskAvailable.wakeAll();
 
-    if (m_runningPeak->m_interuptPeakBuild) {
+    if (peak->m_interuptPeakBuild) {
         PMESG("PeakProcessor:: Deleting interrupted Peak!");
-        delete m_runningPeak;
-        m_runningPeak = nullptr;
-        m_wait.wakeAll();
+        // free_peak() was called during the build, it's ours to delete now
+        peak->deleteLater();
         return;
     }
 
-    foreach(Peak* peak, m_queue) {
-        if (m_runningPeak->m_source->get_filename() == peak->m_source->get_filename()) {
-            m_queue.removeAll(peak);
-            emit peak->finished();
+    foreach(Peak* queued, m_queue) {
+        if (peak->m_source->get_filename() == queued->m_source->get_filename()) {
+            m_queue.removeAll(queued);
+            emit queued->finished();
         }
     }
+}
 
-    m_runningPeak = 0;
+bool PeakProcessor::is_building(const QString& fileName) const
+{
+    foreach(Peak* peak, m_runningPeaks) {
+        if (peak->m_source->get_filename() == fileName) {
+            return true;
+        }
+    }
 
-    dequeue_queue();
+    return false;
 }
 
 void PeakProcessor::queue_task(Peak * peak)
 {
     QMutexLocker locker(&m_mutex);
 
-    m_queue.enqueue(peak);
-
-    if (!m_taskRunning) {
-        dequeue_queue();
+    if (m_runningPeaks.contains(peak)) {
+        return;
     }
+
+    m_queue.removeAll(peak);
+    m_queue.prepend(peak);
+
+    m_taskAvailable.wakeOne();
 }
 
-void PeakProcessor::dequeue_queue()
+// Moves an already queued Peak to the front of the queue
+void PeakProcessor::prioritize_task(Peak * peak)
 {
-    if (!m_queue.isEmpty()) {
-        m_taskRunning = true;
-        m_runningPeak = m_queue.dequeue();
-        emit newTask();
+    QMutexLocker locker(&m_mutex);
+
+    if (m_queue.removeAll(peak)) {
+        m_queue.prepend(peak);
     }
 }
 
 void PeakProcessor::free_peak(Peak * peak)
 {
-    m_mutex.lock();
+    QMutexLocker locker(&m_mutex);
 
     m_queue.removeAll(peak);
 
-    if (peak == m_runningPeak) {
+    if (m_runningPeaks.contains(peak)) {
+        // Don't wait for the build to stop, the worker deletes the Peak once it did
         PMESG("PeakProcessor:: Interrupting running build process!");
         peak->m_interuptPeakBuild =  true;
-
-        PMESG("PeakProcessor:: Waiting GUI thread until interrupt finished");
-        m_wait.wait(&m_mutex);
-        PMESG("PeakProcessor:: Resuming GUI thread");
-
-        dequeue_queue();
-
-        m_mutex.unlock();
-
         return;
     }
 
-    m_mutex.unlock();
+    locker.unlock();
 
     delete peak;
 }
 
 
+
 PPThread::PPThread(PeakProcessor * pp)
 {
     m_pp = pp;
@@ -837,7 +967,10 @@ PPThread::PPThread(PeakProcessor * pp)
 
 void PPThread::run()
 {
-    exec();
+    while (Peak* peak = m_pp->take_task()) {
+        peak->create_from_scratch();
+        m_pp->task_finished(peak);
+    }
 }
 
 
@@ -850,7 +983,7 @@ PeakDataReader::PeakDataReader(Peak::ChannelData* data)
 }
 
 
-nframes_t PeakDataReader::read_from(DecodeBuffer* buffer, nframes_t start, nframes_t count)
+nframes_t PeakDataReader::read_from(peak_data_t* buffer, nframes_t start, nframes_t count)
 {
     // 	printf("read_from:: before_seek from %d, framepos is %d\n", start, m_readPos);
 
@@ -864,7 +997,8 @@ nframes_t PeakDataReader::read_from(DecodeBuffer* buffer, nframes_t start, nfram
 
 bool PeakDataReader::seek(nframes_t start)
 {
-    if (m_readPos != start) {
+    // get_max_amplitude() moves the file position too
+    if (m_readPos != start || m_d->file.pos() != start) {
         Q_ASSERT(m_d->file.isOpen());
 
 
@@ -884,29 +1018,19 @@ bool PeakDataReader::seek(nframes_t start)
 }
 
 
-nframes_t PeakDataReader::read(DecodeBuffer* buffer, nframes_t count)
+nframes_t PeakDataReader::read(peak_data_t* buffer, nframes_t count)
 {
     if ( ! (count && (m_readPos < m_nframes)) ) {
         return 0;
     }
 
-    // Make sure the read buffer is big enough for this read
-    buffer->check_buffers_capacity(count*3, 1);
-
     Q_ASSERT(m_d->file.isOpen());
 
-    qint64 framesRead = 0;
-    peak_data_t* readbuffer;
-
     qint64 length = sizeof(peak_data_t) * count;
-    framesRead = m_d->file.read(reinterpret_cast<char*>(buffer->readBuffer), length) / qint64(sizeof(peak_data_t));
-    readbuffer = reinterpret_cast<peak_data_t*>(buffer->readBuffer);
-
-    for (int f = 0; f < framesRead; f++) {
-        buffer->destination[0][f] = float(readbuffer[f]);
-    }
+    qint64 framesRead = m_d->file.read(reinterpret_cast<char*>(buffer), length) / qint64(sizeof(peak_data_t));
 
-    m_readPos += framesRead;
+    // m_readPos is a byte position, like start in read_from()
+    m_readPos += framesRead * sizeof(peak_data_t);
 
     return nframes_t(framesRead);
 }
@@ -937,6 +1061,10 @@ int Peak::max_zoom_value()
 
 Peak::ChannelData::~ ChannelData()
 {
+    if (fileMap) {
+        file.unmap(fileMap);
+    }
+
 
     delete peakdataDecodeBuffer;
 
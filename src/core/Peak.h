@@ -25,11 +25,12 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.
 #include <QObject>
 #include <QThread>
 #include <QMutex>
-#include <QQueue>
+#include <QList>
 #include <QWaitCondition>
 #include <QFile>
 #include <QHash>
 #include <QPair>
+#include <QVector>
 
 #include "defines.h"
 
@@ -40,37 +41,41 @@ class PPThread;
 class DecodeBuffer;
 class PeakDataReader;
 
+/**
+ * Builds the peak files of Peak objects on a small pool of worker threads.
+ *
+ * Peak building is requested when an AudioClipView is painted, so the most
+ * recent request belongs to a clip which is visible right now, it is put in
+ * front of the queue. Two Peaks of the same file are never built at once.
+ */
 class PeakProcessor : public QObject
 {
 	Q_OBJECT	
 	
 public:
 	void queue_task(Peak* peak);
+	void prioritize_task(Peak* peak);
 	void free_peak(Peak* peak);
 
 private:
-	PPThread* m_ppthread;
+	QList<PPThread*> m_workers;
 	QMutex m_mutex;
-	QWaitCondition m_wait;
-	bool m_taskRunning;
-	Peak* m_runningPeak;
+	QWaitCondition m_taskAvailable;
+	bool m_quit;
 		
-	QQueue<Peak* > m_queue;
+	QList<Peak* > m_queue;
+	QList<Peak* > m_runningPeaks;
 	
-	void dequeue_queue();
+	Peak* take_task();
+	void task_finished(Peak* peak);
+	bool is_building(const QString& fileName) const;
 	
 	PeakProcessor();
 	~PeakProcessor();
 	PeakProcessor(const PeakProcessor&);
 	// allow this function to create one instance
 	friend PeakProcessor& pp();
-	
-private slots:
-	void start_task();
-	
-signals:
-	void newTask();
-
+	friend class PPThread;
 };
 
 class PPThread : public QThread
@@ -98,6 +103,8 @@ public:
 	static const int ZOOM_LEVELS = 22;
 	static const int SAVING_ZOOM_FACTOR = 8;
 	static const int MAX_ZOOM_USING_SOURCEFILE = SAVING_ZOOM_FACTOR - 1;
+	// Zoom levels SAVING_ZOOM_FACTOR up to and including ZOOM_LEVELS are stored in the peak file
+	static const int CACHED_ZOOM_LEVELS = ZOOM_LEVELS - SAVING_ZOOM_FACTOR + 1;
 	// Use ~ 1/4 the range of peak_data_t (== short) so we have headroom
 	// for samples in the range [-4, +4] or + 12 dB
 	static const int MAX_DB_VALUE = 8000;
@@ -108,17 +115,20 @@ public:
 
 	enum { 	NO_PEAKDATA_FOUND = -1,
 		NO_PEAK_FILE = -2,
-  		PERMANENT_FAILURE = -3
+  		PERMANENT_FAILURE = -3,
+		DATA_PENDING = -4
 	};
 		
 	void process(uint channel, const audio_sample_t* buffer, nframes_t frames);
     int prepare_processing(uint rate);
 	int finish_processing();
-	int calculate_peaks(int chan, float** buffer, TimeRef startlocation, int peakDataCount, qreal framesPerPeak);
+	int calculate_peaks(int chan, const peak_data_t** buffer, TimeRef startlocation, int peakDataCount, qreal framesPerPeak);
+	int calculate_micro_peaks(int chan, float** buffer, TimeRef startlocation, int peakDataCount, qreal framesPerPeak);
 
 	void close();
 	
 	void start_peak_loading();
+	void prioritize_peak_loading();
 
 	audio_sample_t get_max_amplitude(TimeRef startlocation, TimeRef endlocation);
 	
@@ -129,14 +139,27 @@ private:
 	ReadSource* 	m_source;
 	bool 		m_peaksAvailable;
 	bool		m_permanentFailure;
-	bool		m_interuptPeakBuild;
+	volatile bool	m_interuptPeakBuild;
+	// m_source is shared with the micro view decoder thread
+	QMutex		m_sourceMutex;
 	static QHash<int, int> chacheIndexLut;
 	
+	// Peak values of the first cached level are collected in memory and written in chunks of this size
+	static const int PEAK_WRITE_BUFFER_SIZE = 8192;
+
 	struct ProcessData {
 		ProcessData() {
 			normValue = peakUpperValue = peakLowerValue = 0;
 			processBufferSize = progress = normProcessedFrames = normDataCount = 0;
+			peakWriteBufferFill = 0;
+			peakWriteBuffer = nullptr;
 			nextDataPointLocation = processRange;
+			for (int i=0; i<CACHED_ZOOM_LEVELS; ++i) {
+				hasPendingPair[i] = false;
+			}
+		}
+		~ProcessData() {
+			delete [] peakWriteBuffer;
 		}
 		
 		audio_sample_t		peakUpperValue;
@@ -153,13 +176,24 @@ private:
 		int 			progress;
 		int			processBufferSize;
 		int			normDataCount;
+
+		// Only allocated when building the peak file
+		peak_data_t*		peakWriteBuffer;
+		int			peakWriteBufferFill;
+
+		// The coarser levels are derived while the first level is built, each
+		// level only has to remember the last peak value pair it received.
+		QVector<peak_data_t>	levelData[CACHED_ZOOM_LEVELS];
+		peak_data_t		pendingPair[CACHED_ZOOM_LEVELS][2];
+		bool			hasPendingPair[CACHED_ZOOM_LEVELS];
+		QVector<audio_sample_t>	normData;
 	};
 	
 	struct PeakHeaderData {
 		int headerSize;
 		int normValuesDataOffset;
-		int peakDataOffsets[ZOOM_LEVELS - SAVING_ZOOM_FACTOR];
-		int peakDataSizeForLevel[ZOOM_LEVELS - SAVING_ZOOM_FACTOR];
+		int peakDataOffsets[CACHED_ZOOM_LEVELS];
+		int peakDataSizeForLevel[CACHED_ZOOM_LEVELS];
 		char label[6];	//TPFxxx -> Traverso Peak File version x.x.x
 		int version[2];
 	};
@@ -167,28 +201,35 @@ private:
 	struct ChannelData {
 		ChannelData() {
 			peakdataDecodeBuffer = 0;
+			peakreader = 0;
+			fileMap = 0;
 		}
 		~ChannelData();
 		QString		fileName;
-		QString		normFileName;
 		QFile 		file;
-		QFile		normFile;
 		PeakHeaderData	headerdata;
 		PeakDataReader*	peakreader;
 		ProcessData* 	pd;
 		DecodeBuffer*	peakdataDecodeBuffer;
-		QHash<uchar *, QPair<int /*offset*/, int /*handle|len*/> > maps;
+		// The peak file is mapped read only for the lifetime of the Peak,
+		// if mapping isn't possible peakreader reads into peakReadBuffer.
+		uchar*		fileMap;
+		QVector<peak_data_t> peakReadBuffer;
 	};
 	
 	QList<ChannelData* >	m_channelData;
 	
 	int create_from_scratch();
 	int read_header();
+	int check_peak_data(int peakDataCount);
 	int write_header(ChannelData* data);
+	void flush_process_buffers(ChannelData* data);
+	void push_pyramid_pair(ProcessData* pd, int level, peak_data_t upper, peak_data_t lower);
 	static void calculate_lut_data();
 
 	friend class PeakProcessor;
 	friend class PeakDataReader;
+	friend class TAudioTileCache;
 
 signals:
 	void finished();
@@ -201,7 +242,7 @@ public:
 	PeakDataReader(Peak::ChannelData* data);
 	~PeakDataReader(){};
 
-	nframes_t read_from(DecodeBuffer* buffer, nframes_t start, nframes_t count);
+	nframes_t read_from(peak_data_t* buffer, nframes_t start, nframes_t count);
 
 private:
 	Peak::ChannelData* m_d;
@@ -209,7 +250,7 @@ private:
 	nframes_t	m_nframes;
 
 	bool seek(nframes_t start);
-	nframes_t read(DecodeBuffer* buffer, nframes_t frameCount);
+	nframes_t read(peak_data_t* buffer, nframes_t frameCount);
 };
 
 inline QHash< int, int > * Peak::cache_index_lut()
@@ -150,6 +150,7 @@ int Project::create(int sheetcount, int numtracks)
 	if (create_peakfiles_dir() < 0) {
 		return -1;
 	}
+	AbstractAudioReader::set_index_dir(m_rootDir + "/peakfiles");
 	
 	if (create_audiosources_dir() < 0) {
 		return -1;
@@ -240,6 +241,7 @@ int Project::load(const QString& projectfile)
 	if (!dir.exists(m_rootDir + "/audiosources")) {
 		create_audiosources_dir();
 	}
+	AbstractAudioReader::set_index_dir(m_rootDir + "/peakfiles");
 
 	
 	// Start setting and parsing the content of the xml file
@@ -1164,7 +1166,8 @@ TSession* Project::get_current_session() const
 }
 
 
-/* call this function to initiate the export or cd-writing */
+/* call this function to initiate the export or cd-writing, fill in
+   spec->targets to write several formats from one render */
 int Project::export_project(ExportSpecification* spec)
 {
 	PENTER;
@@ -1211,10 +1214,15 @@ int Project::start_export(ExportSpecification* spec)
 {
 	PMESG("Starting export, rate is %d bitdepth is %d", spec->sample_rate, spec->data_width );
 
-        spec->blocksize = audiodevice().get_buffer_size(); //32768;
+        // the tracks are processed in audio device buffer sized cycles, which are
+        // collected and written to disk in blocks of "Export"/"blocksize" frames.
+        // Blocks hold whole cycles, only the last block of a track may end mid cycle.
+        nframes_t cycle = audiodevice().get_buffer_size();
+        nframes_t blocksize = qMax(cycle, nframes_t(config().get_property("Export", "blocksize", 65536).toInt()));
+        spec->blocksize = ((blocksize + cycle - 1) / cycle) * cycle;
 
-	spec->dataF = new audio_sample_t[spec->blocksize * spec->channels];
-	audio_sample_t* readbuffer = new audio_sample_t[spec->blocksize * spec->channels];
+        // the mixes kept by normalised exports share "Export"/"spillramsize" MB of memory
+        spec->spillRamSize = qint64(config().get_property("Export", "spillramsize", 256).toInt()) * 1024 * 1024;
 
 	overallExportProgress = renderedSheets = 0;
 	sheetsToRender.clear();
@@ -1231,81 +1239,223 @@ int Project::start_export(ExportSpecification* spec)
 		}
 	}
 
-        // process each sheet in the list sheetsToRender. here we set the renderpass mode,
-        // and then call Sheet::repare_export() and Sheet::render(), which do the actual
-        // processing.
-        foreach(Sheet* sheet, sheetsToRender) {
-                PMESG("Starting export for sheet %lld", sheet->get_id());
-		emit exportStartedForSheet(sheet);
-		spec->resumeTransport = false;
-                spec->resumeTransportLocation = sheet->get_transport_location();
-		sheet->readbuffer = readbuffer;
-		
-		if (spec->normalize) {
-                        // start one render pass in mode "CALC_NORM_FACTOR"
-			spec->peakvalue = 0.0;
-			spec->renderpass = ExportSpecification::CALC_NORM_FACTOR;
-			
-			
-			if (sheet->prepare_export(spec) < 0) {
-				PERROR("Failed to prepare sheet for export");
-				continue;
-			}
-			
-                        sheet->start_export(spec);
-			
-            spec->normvalue = (1.0f - FLT_EPSILON) / spec->peakvalue;
-			
-            if (spec->peakvalue > 1.0f) {
-				info().critical(tr("Detected clipping in exported audio! (%1)")
-						.arg(coefficient_to_dbstring(spec->peakvalue)));
+        // sheets don't share render state, so they can be rendered in parallel,
+        // by "Export"/"threads" threads, or one per core if that's 0
+	int threads = config().get_property("Export", "threads", 0).toInt();
+	if (threads <= 0) {
+		threads = QThread::idealThreadCount();
+	}
+	threads = qMin(threads, sheetsToRender.size());
+
+	if (threads > 1) {
+		export_sheets_parallel(spec, threads);
+	} else {
+		spec->dataF = new audio_sample_t[spec->blocksize * spec->channels];
+		audio_sample_t* readbuffer = new audio_sample_t[spec->blocksize * spec->channels];
+
+		// process each sheet in the list sheetsToRender
+		foreach(Sheet* sheet, sheetsToRender) {
+			sheet->readbuffer = readbuffer;
+
+			int result = export_sheet(sheet, spec);
+
+			if (result < 0 || spec->breakout) {
+				break;
 			}
-			
-			if (!spec->breakout) {
-				info().information(tr("calculated norm factor: %1").arg(coefficient_to_dbstring(spec->normvalue)));
+			if (result > 0) {
+				renderedSheets++;
 			}
 		}
 
-                // start the real render pass in mode "WRITE_TO_HARDDISK"
-		spec->renderpass = ExportSpecification::WRITE_TO_HARDDISK;
-		
-                // first call Sheet::prepare_export()...
+		delete [] spec->dataF;
+		delete [] readbuffer;
+		spec->dataF = nullptr;
+	}
+
+	PMESG("Export Finished");
+
+	spec->running = false;
+	overallExportProgress = 0;
+
+	emit exportFinished();
+
+	return 1;
+}
+
+// Renders one sheet, here we set the renderpass mode, and then call
+// Sheet::prepare_export() and Sheet::start_export(), which do the actual
+// processing. Returns 0 if the sheet was skipped, -1 if the export should stop.
+int Project::export_sheet(Sheet* sheet, ExportSpecification* spec)
+{
+        PMESG("Starting export for sheet %lld", sheet->get_id());
+	emit exportStartedForSheet(sheet);
+	spec->resumeTransport = false;
+        spec->resumeTransportLocation = sheet->get_transport_location();
+
+	if (spec->normalize) {
+                // start one render pass in mode "CALC_NORM_FACTOR"
+		spec->peakvalue = 0.0;
+		spec->renderpass = ExportSpecification::CALC_NORM_FACTOR;
+
+
 		if (sheet->prepare_export(spec) < 0) {
 			PERROR("Failed to prepare sheet for export");
-			break;
+			return 0;
 		}
-		
-                // ... then start the render process and wait until it's finished
-                sheet->start_export(spec);
-		
-		if (!QMetaObject::invokeMethod(sheet, "set_transport_pos",  Qt::QueuedConnection, Q_ARG(TimeRef, spec->resumeTransportLocation))) {
-			printf("Invoking Sheet::set_transport_pos() failed\n");
+
+		// keep the mix, so the write pass only has to apply the norm factor,
+		// dither and encode it
+		if (config().get_property("Export", "singlepassnormalize", true).toBool()) {
+			qint64 samples = qint64(spec->totalTime.to_frame(audiodevice().get_sample_rate())) * spec->channels;
+			spec->spill = new ExportSpill(spec->exportdir, samples, spec->spillRamSize);
 		}
-		if (spec->resumeTransport) {
-			if (!QMetaObject::invokeMethod(sheet, "start_transport",  Qt::QueuedConnection)) {
-				printf("Invoking Sheet::start_transport() failed\n");
+
+                sheet->start_export(spec);
+
+		if (spec->spill) {
+			if (spec->spill->failed()) {
+				// render the mix again in the write pass
+				delete spec->spill;
+				spec->spill = nullptr;
+			} else {
+				spec->spill->rewind();
 			}
 		}
-		if (spec->breakout) {
-			break;
+
+            spec->normvalue = (1.0f - FLT_EPSILON) / spec->peakvalue;
+
+            if (spec->peakvalue > 1.0f) {
+			info().critical(tr("Detected clipping in exported audio! (%1)")
+					.arg(coefficient_to_dbstring(spec->peakvalue)));
+		}
+
+		if (!spec->breakout) {
+			info().information(tr("calculated norm factor: %1").arg(coefficient_to_dbstring(spec->normvalue)));
 		}
-		renderedSheets++;
 	}
 
-	PMESG("Export Finished");
+        // start the real render pass in mode "WRITE_TO_HARDDISK"
+	spec->renderpass = ExportSpecification::WRITE_TO_HARDDISK;
 
-	spec->running = false;
-	overallExportProgress = 0;
-	
-	delete [] spec->dataF;
-	delete [] readbuffer;
-    spec->dataF = nullptr;
+        // first call Sheet::prepare_export()...
+	if (sheet->prepare_export(spec) < 0) {
+		PERROR("Failed to prepare sheet for export");
+		delete spec->spill;
+		spec->spill = nullptr;
+		return -1;
+	}
 
-	emit exportFinished();
+        // ... then start the render process and wait until it's finished
+        sheet->start_export(spec);
+
+	delete spec->spill;
+	spec->spill = nullptr;
+
+	if (!QMetaObject::invokeMethod(sheet, "set_transport_pos",  Qt::QueuedConnection, Q_ARG(TimeRef, spec->resumeTransportLocation))) {
+		printf("Invoking Sheet::set_transport_pos() failed\n");
+	}
+	if (spec->resumeTransport) {
+		if (!QMetaObject::invokeMethod(sheet, "start_transport",  Qt::QueuedConnection)) {
+			printf("Invoking Sheet::start_transport() failed\n");
+		}
+	}
 
 	return 1;
 }
 
+// Each sheet gets it's own copy of the specification and buffers, the worker
+// threads take the next sheet when done with one. Meanwhile we pass on aborts
+// from the UI, and report the progress of all sheets together.
+void Project::export_sheets_parallel(ExportSpecification* spec, int threads)
+{
+	for (int i = 0; i < sheetsToRender.size(); ++i) {
+		ExportSpecification* sheetSpec = new ExportSpecification(*spec);
+		sheetSpec->dataF = new audio_sample_t[spec->blocksize * spec->channels];
+		// each running sheet gets an equal share of the spill memory
+		sheetSpec->spillRamSize = spec->spillRamSize / threads;
+		m_sheetSpecs.append(sheetSpec);
+	}
+
+	m_nextSheetSpec = 0;
+	m_parallelExport = true;
+
+	QList<ExportWorker*> workers;
+	for (int i = 0; i < threads; ++i) {
+		ExportWorker* worker = new ExportWorker(this);
+		workers.append(worker);
+		worker->start();
+	}
+
+	foreach(ExportWorker* worker, workers) {
+		while (!worker->wait(100)) {
+			int progress = 0;
+
+			foreach(ExportSpecification* sheetSpec, m_sheetSpecs) {
+				if (spec->stop) {
+					sheetSpec->stop = true;
+				}
+				if (spec->breakout) {
+					sheetSpec->breakout = true;
+				}
+				progress += sheetSpec->running ? sheetSpec->progress : 100;
+			}
+
+			progress /= m_sheetSpecs.size();
+
+			// avoid a flood of progress changed signals
+			if (progress > overallExportProgress) {
+				overallExportProgress = progress;
+				emit overallExportProgressChanged(overallExportProgress);
+			}
+		}
+		delete worker;
+	}
+
+	m_parallelExport = false;
+
+	foreach(ExportSpecification* sheetSpec, m_sheetSpecs) {
+		delete [] sheetSpec->dataF;
+		delete sheetSpec;
+	}
+	m_sheetSpecs.clear();
+}
+
+// Called from the ExportWorker threads, returns false when there is no sheet
+// left to render
+bool Project::export_next_sheet()
+{
+	int index = m_nextSheetSpec.fetchAndAddOrdered(1);
+
+	if (index >= m_sheetSpecs.size()) {
+		return false;
+	}
+
+	ExportSpecification* spec = m_sheetSpecs.at(index);
+	Sheet* sheet = sheetsToRender.at(index);
+
+	if (spec->breakout) {
+		spec->running = false;
+		return false;
+	}
+
+	audio_sample_t* readbuffer = new audio_sample_t[spec->blocksize * spec->channels];
+	sheet->readbuffer = readbuffer;
+
+	int result = export_sheet(sheet, spec);
+
+	sheet->readbuffer = nullptr;
+	delete [] readbuffer;
+	spec->running = false;
+
+	if (result < 0) {
+		// like a serial export, don't start on the remaining sheets
+		m_nextSheetSpec = m_sheetSpecs.size();
+		return false;
+	}
+
+	return true;
+}
+
 void Project::export_finished()
 {
         connect_to_audio_device();
@@ -1423,6 +1573,11 @@ uint Project::get_bitdepth( ) const
 
 void Project::set_sheet_export_progress(int progress)
 {
+	// the overall progress of a parallel export is reported by start_export()
+	if (m_parallelExport) {
+		return;
+	}
+
 	overallExportProgress = (progress / sheetsToRender.count()) + 
 			(renderedSheets * (100 / sheetsToRender.count()) );
 
@@ -24,6 +24,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.
 
 #include <QString>
 #include <QList>
+#include <QAtomicInt>
 #include <QDomNode>
 #include "TSession.h"
 #include "APILinkedList.h"
@@ -142,6 +143,7 @@ public :
 	int load(const QString &projectfile = "");
 	int export_project(ExportSpecification* spec);
 	int start_export(ExportSpecification* spec);
+	bool export_next_sheet();
 	int create_cdrdao_toc(ExportSpecification* spec);
         TimeRef get_cd_totaltime(ExportSpecification*);
 
@@ -204,11 +206,17 @@ private:
 	int		overallExportProgress{};
 	int 		renderedSheets{};
 	QList<Sheet* > 	sheetsToRender;
+	// Per sheet copies of the export specification for a parallel export
+	QList<ExportSpecification* >	m_sheetSpecs;
+	QAtomicInt	m_nextSheetSpec;
+	bool		m_parallelExport{};
 
         qint64 		m_activeSheetId;
         qint64          m_activeSessionId;
 
         int create(int sheetcount, int numtracks);
+	int export_sheet(Sheet* sheet, ExportSpecification* spec);
+	void export_sheets_parallel(ExportSpecification* spec, int threads);
 	int create_audiosources_dir();
 	int create_peakfiles_dir();
 
@@ -31,6 +31,8 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.
 #include "AudioDevice.h"
 #include <QFile>
 #include "TConfig.h"
+#include "TDecodeCache.h"
+#include "TAudioRamCache.h"
 #include <climits>
 
 // Always put me below _all_ includes, this is needed
@@ -120,14 +122,18 @@ void ReadSource::private_init()
     m_clip = nullptr;
     m_audioReader = nullptr;
     m_bufferstatus = nullptr;
+    m_ramAudio = nullptr;
 }
 
 
 ReadSource::~ReadSource()
 {
 	PENTERDES;
-	for(int i=0; i<m_buffers.size(); ++i) {
-		delete m_buffers.at(i);
+	
+	decode_cache().remove_source(this);
+	
+	if (m_buffer) {
+		delete m_buffer;
 	}
 	
 	if (m_audioReader) {
@@ -137,6 +143,10 @@ ReadSource::~ReadSource()
 	if (m_bufferstatus) {
 		delete m_bufferstatus;
 	}
+	
+	if (m_ramAudio) {
+		audio_ram_cache().release(m_ramAudio);
+	}
 }
 
 QDomNode ReadSource::get_state( QDomDocument doc )
@@ -296,6 +306,24 @@ void ReadSource::set_output_rate(int rate)
 }
 
 
+// Switches reading to the decoded copy of our file made by the decode cache,
+// which is at our output rate already. Called from the decode cache thread.
+void ReadSource::use_decode_cache(const QString& fileName)
+{
+	AbstractAudioReader* reader = AbstractAudioReader::create_audio_reader(fileName, "mmap");
+	
+	if (!reader) {
+		return;
+	}
+	
+	QMutexLocker locker(&m_processMutex);
+	
+	if (!m_audioReader || !m_audioReader->set_cache_reader(reader)) {
+		delete reader;
+	}
+}
+
+
 int ReadSource::file_read(DecodeBuffer* buffer, const TimeRef& start, nframes_t cnt) const
 {
 //	PROFILE_START;
@@ -375,6 +403,20 @@ int ReadSource::rb_read(audio_sample_t** dst, TimeRef& start, nframes_t count)
 		return count;
 	}
 	
+	if (m_ramAudio) {
+		nframes_t pos = start.to_frame(m_outputRate);
+		if (pos >= m_ramAudio->nframes) {
+			return 0;
+		}
+		
+		nframes_t readcount = std::min(count, m_ramAudio->nframes - pos);
+		for (int chan=0; chan<m_channelCount; ++chan) {
+			memcpy(dst[chan], m_ramAudio->channels.at(chan).constData() + pos, readcount * sizeof(audio_sample_t));
+		}
+		
+		return readcount;
+	}
+	
 	if ( ! m_rbReady ) {
 // 		printf("ringbuffer not ready\n");
 		return 0;
@@ -393,7 +435,7 @@ int ReadSource::rb_read(audio_sample_t** dst, TimeRef& start, nframes_t count)
 	
 	if (start != m_rbRelativeFileReadPos) {
 		
-		TimeRef availabletime(nframes_t(m_buffers.at(0)->read_space()), m_outputRate);
+		TimeRef availabletime(nframes_t(m_buffer->read_space()), m_outputRate);
 /*		printf("rb_read:: m_rbRelativeFileReadPos, start: %lld, %lld\n", m_rbRelativeFileReadPos.universal_frame(), start.universal_frame());
 		printf("rb_read:: availabletime %d\n", availabletime.to_frame(m_outputRate));*/
 		
@@ -403,9 +445,7 @@ int ReadSource::rb_read(audio_sample_t** dst, TimeRef& start, nframes_t count)
 			if (availabletime < advance) {
 				printf("available < advance !!!!!!!\n");
 			}
-			for (int i=m_buffers.size()-1; i>=0; --i) {
-				m_buffers.at(i)->increment_read_ptr(advance.to_frame(m_outputRate));
-			}
+			m_buffer->increment_read_ptr(advance.to_frame(m_outputRate));
 			
 			m_rbRelativeFileReadPos += advance;
 /*			printf("rb_read:: advance %d\n", advance.to_frame(m_outputRate));
@@ -417,21 +457,27 @@ int ReadSource::rb_read(audio_sample_t** dst, TimeRef& start, nframes_t count)
 		}
 	}
 
-	nframes_t readcount = 0;
-	
-	for (int chan=0; chan<m_channelCount; ++chan) {
-		
-		readcount = m_buffers.at(chan)->read(dst[chan], count);
+	// All channels share the read pointer, they are read from one snapshot
+	// of the read space and the pointer is advanced once
+	nframes_t readcount = m_buffer->read(dst, count);
 
-		if (readcount != count) {
-			PMESG("readcount, count: %d, %d", readcount, count);
-		// Hmm, not sure what to do in this case....
-		}
-		
+	if (readcount != count) {
+		PMESG("readcount, count: %d, %d", readcount, count);
+	// Hmm, not sure what to do in this case....
+	}
+	
+	// The disk thread didn't keep up, DiskIO gives us a larger buffer next time
+	if (readcount < count) {
+		m_underrunCount++;
 	}
 
 	m_rbRelativeFileReadPos.add_frames(readcount, m_outputRate);
 	
+	// Let the disk thread refill our buffers right away
+	if (m_buffer->write_space() >= m_wakeupWatermark) {
+		m_diskio->wakeup_read_thread();
+	}
+	
 	return readcount;
 }
 
@@ -452,6 +498,50 @@ int ReadSource::rb_file_read(DecodeBuffer* buffer, nframes_t cnt)
 }
 
 
+// Reads cnt frames straight into the ringbuffers write vectors, used for
+// audio readers that support it (e.g. memory mapped uncompressed files)
+// to avoid the copies through the DecodeBuffer.
+int ReadSource::rb_file_read_direct(nframes_t cnt)
+{
+	MultiChannelRingBuffer<audio_sample_t>::rw_vector vector;
+	nframes_t start = m_rbFileReadPos.to_frame(m_outputRate);
+	nframes_t readFrames = 0;
+	
+	// The write vector wraps at most once, so this loops at most twice
+	while (readFrames < cnt) {
+		m_buffer->get_write_vector(&vector);
+		nframes_t toRead = std::min(cnt - readFrames, nframes_t(vector.len[0]));
+		
+		for (uint chan=0; chan<m_channelCount; ++chan) {
+			m_rbWritePointers[chan] = m_buffer->channel_buffer(chan) + vector.offset[0];
+		}
+		
+		if (toRead == 0) {
+			break;
+		}
+		
+		nframes_t read = m_audioReader->read_direct_from(m_rbWritePointers.data(), start + readFrames, toRead);
+		
+		m_buffer->increment_write_ptr(read);
+		
+		readFrames += read;
+		
+		if (read < toRead) {
+			break;
+		}
+	}
+	
+	if (readFrames == cnt) {
+		m_rbFileReadPos.add_frames(readFrames, m_outputRate);
+	} else {
+		// See rb_file_read()
+		m_rbFileReadPos = m_length;
+	}
+	
+	return readFrames;
+}
+
+
 void ReadSource::rb_seek_to_file_position(TimeRef& position)
 {
 	Q_ASSERT(m_clip);
@@ -478,9 +568,7 @@ void ReadSource::rb_seek_to_file_position(TimeRef& position)
 // 	printf("rb_seek_to_file_position:: seeking to relative pos: %d\n", fileposition);
 	
 	// The content of our buffers is no longer valid, so we empty them
-	for (int i=0; i<m_buffers.size(); ++i) {
-		m_buffers.at(i)->reset();
-	}
+	m_buffer->reset();
 	
 	m_rbFileReadPos = fileposition;
 	m_rbRelativeFileReadPos = fileposition;
@@ -504,7 +592,7 @@ void ReadSource::process_ringbuffer(DecodeBuffer* buffer, bool seeking)
 	}
 	
 	// Calculate the number of samples we can write into the buffer
-	int writeSpace = m_buffers.at(0)->write_space();
+	int writeSpace = m_buffer->write_space();
 
 	// The amount of chunks which can be 'read'
 	int chunkCount = (int)(writeSpace / m_chunkSize);
@@ -540,14 +628,25 @@ void ReadSource::process_ringbuffer(DecodeBuffer* buffer, bool seeking)
 		m_audioReader->set_converter_type(m_diskio->get_resample_quality());
 	}
 	
+	trav_time_t startTime = get_microseconds();
+	
+	// Uncompressed sources which don't need resampling are
+	// decoded straight into the ringbuffers.
+	if (m_audioReader->can_read_direct()) {
+		m_decodedFrames += rb_file_read_direct(toRead);
+		m_decodeTime += get_microseconds() - startTime;
+		return;
+	}
+	
 	// Read in the samples from source
 	nframes_t toWrite = rb_file_read(buffer, toRead);
 	
+	m_decodedFrames += toWrite;
+	m_decodeTime += get_microseconds() - startTime;
+	
 	// and write it to the ringbuffer
 	if (toWrite) {
-		for (int i=m_buffers.size()-1; i>=0; --i) {
-			m_buffers.at(i)->write(buffer->destination[i], toWrite);
-		}
+		m_buffer->write(buffer->destination, toWrite);
 	}
 }
 
@@ -563,6 +662,8 @@ void ReadSource::start_resync(TimeRef& position)
 	m_syncPos = position;
 	m_rbReady = 0;
 	m_needSync = 1;
+	
+	m_diskio->wakeup_read_thread();
 }
 
 void ReadSource::finish_resync()
@@ -597,7 +698,7 @@ void ReadSource::sync(DecodeBuffer* buffer)
 	// doesn't fill it consitently, and thus giving audible artifacts.
 	process_ringbuffer(buffer);
 	
-	if (m_buffers.at(0)->write_space() == 0) {
+	if (m_buffer->write_space() == 0) {
 		finish_resync();
 	}
 	
@@ -612,27 +713,73 @@ void ReadSource::prepare_rt_buffers( )
 	
 	Q_ASSERT(m_clip);
 	
-	for (int i=0; i<m_buffers.size();++i) {
-		delete m_buffers.at(i);
-	}
-	
-	m_buffers.clear();
-
 	float size = config().get_property("Hardware", "readbuffersize", 1.0).toDouble();
 
-        m_bufferSize = (int) (size * m_outputRate);
+	create_rt_buffers((nframes_t) (size * m_outputRate));
+
+        // FIXME: does this really make sense to do still ? :
+        TimeRef synclocation = m_clip->get_sheet()->get_transport_location();
+        start_resync(synclocation);
+}
+
+void ReadSource::create_rt_buffers(nframes_t size)
+{
+	if (m_buffer) {
+		delete m_buffer;
+		m_buffer = nullptr;
+	}
+
+        m_bufferSize = size;
 
         // TODO: reading is done in chunkSizes, mayb it's more performant to
         // have chunck sizes that are multiples of 4KB ?
         m_chunkSize = m_bufferSize / DiskIO::bufferdividefactor;
+	// DiskIO processes our buffers in chunks, waking it up for less is useless
+	m_wakeupWatermark = qMax(DiskIO::get_wakeup_watermark(m_bufferSize), m_chunkSize);
+
+	m_buffer = new MultiChannelRingBuffer<audio_sample_t>(m_channelCount, m_bufferSize);
+	m_rbWritePointers.resize(m_channelCount);
+}
 
-	for (int i=0; i<m_channelCount; ++i) {
-		m_buffers.append(new RingBufferNPT<float>(m_bufferSize));
+// Called by DiskIO while seeking, the buffer is refilled from the
+// seek position afterwards. Small changes aren't worth a reallocation.
+void ReadSource::set_rt_buffer_size(nframes_t size)
+{
+	if (!m_buffer || m_ramAudio) {
+		return;
 	}
+	
+	if (size > m_bufferSize * 0.9 && size < m_bufferSize * 1.1) {
+		return;
+	}
+	
+	create_rt_buffers(size);
+	
+	// Make sure the next seek fills the new buffer
+	m_rbFileReadPos = TimeRef(LLONG_MAX);
+}
 
-        // FIXME: does this really make sense to do still ? :
-        TimeRef synclocation = m_clip->get_sheet()->get_transport_location();
-        start_resync(synclocation);
+// Returns the time it took to decode one second of audio, in seconds,
+// or -1 if we didn't decode enough to tell
+float ReadSource::get_decode_cost() const
+{
+	if (m_decodedFrames < m_outputRate) {
+		return -1;
+	}
+	
+	return (float(m_decodeTime) / 1000000) / (float(m_decodedFrames) / m_outputRate);
+}
+
+// Returns the underruns since the last call, and halves the decode statistics
+// so they follow changes in e.g. disk load
+int ReadSource::take_underrun_count()
+{
+	int count = int(m_underrunCount);
+	m_underrunCount = 0;
+	m_decodeTime /= 2;
+	m_decodedFrames /= 2;
+	
+	return count;
 }
 
 BufferStatus* ReadSource::get_buffer_status()
@@ -641,7 +788,7 @@ BufferStatus* ReadSource::get_buffer_status()
 		return m_bufferstatus;
 	}
 	
-	int freespace = m_buffers.at(0)->write_space();
+	int freespace = m_buffer->write_space();
 	
 // 	printf("m_rbFileReadPos, m_length %lld, %lld\n", m_rbFileReadPos.universal_frame(), m_length.universal_frame());
 	TimeRef transport = m_clip->get_sheet()->get_transport_location();
@@ -694,6 +841,24 @@ void ReadSource::set_diskio(DiskIO * diskio)
 		m_audioReader->set_converter_type(m_diskio->get_resample_quality());
 	}
 	
+	// Short sources are played straight from memory
+	const TRamAudio* previous = m_ramAudio;
+	m_ramAudio = nullptr;
+	if (audio_ram_cache().fits(this)) {
+		m_ramAudio = audio_ram_cache().acquire(this);
+	}
+	if (previous) {
+		audio_ram_cache().release(previous);
+	}
+	
+	if (m_ramAudio) {
+		delete m_buffer;
+		m_buffer = nullptr;
+		m_needSync = 0;
+		m_rbReady = 1;
+		return;
+	}
+	
 	prepare_rt_buffers();
 }
 
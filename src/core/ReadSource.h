@@ -25,6 +25,8 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.
 #include "AudioSource.h"
 
 #include <QDomDocument>
+#include <QMutex>
+#include <QVector>
 
 
 class ResampleAudioReader;
@@ -32,6 +34,7 @@ class AudioClip;
 struct BufferStatus;
 class DecodeBuffer;
 class DiskIO;
+struct TRamAudio;
 
 class ReadSource : public AudioSource
 {
@@ -73,13 +76,21 @@ public :
     uint get_file_rate() const;
     uint get_output_rate() const {return m_outputRate;}
 	const TimeRef& get_length() const {return m_length;}
+	QString get_decoder_type() const {return m_decodertype;}
 	
 	void sync(DecodeBuffer* buffer);
 	void process_ringbuffer(DecodeBuffer* buffer, bool seeking=false);
 	void prepare_rt_buffers();
+	void set_rt_buffer_size(nframes_t size);
+	nframes_t get_rt_buffer_size() const {return m_bufferSize;}
+	float get_decode_cost() const;
+	int take_underrun_count();
 	BufferStatus* get_buffer_status();
+	bool is_ram_source() const {return m_ramAudio != nullptr;}
+	QMutex* get_process_mutex() {return &m_processMutex;}
 	
 	void set_output_rate(int rate);
+	void use_decode_cache(const QString& fileName);
 	
 	
 private:
@@ -104,13 +115,24 @@ private:
     uint			m_outputRate{};
 	
     BufferStatus*		m_bufferstatus{};
+	// Decode statistics, used by DiskIO to size our ringbuffer
+	trav_time_t		m_decodeTime{};
+	qint64			m_decodedFrames{};
+	volatile size_t		m_underrunCount{};
+	// The complete audio of short sources, played without ringbuffer
+	const TRamAudio*	m_ramAudio{};
+	// Held by the DiskIO (reader) thread while processing the ringbuffers
+	QMutex			m_processMutex;
+	QVector<audio_sample_t*> m_rbWritePointers;
 	
 	int ref() { return m_refcount++;}
 	
 	void private_init();
 	void start_resync(TimeRef& position);
 	void finish_resync();
+	void create_rt_buffers(nframes_t size);
 	int rb_file_read(DecodeBuffer* buffer, nframes_t cnt);
+	int rb_file_read_direct(nframes_t cnt);
 
 	friend class ResourcesManager;
 	friend class ProjectConverter;
@@ -52,6 +52,8 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.
 #include "Tsar.h"
 #include "SnapList.h"
 #include "TBusTrack.h"
+#include "TProcessGraph.h"
+#include "TAudioBufferArena.h"
 #include "TConfig.h"
 #include "Utils.h"
 #include "ContextItem.h"
@@ -128,8 +130,7 @@ Sheet::~Sheet()
 
 	delete m_diskio;
         delete m_masterOutBusTrack;
-	delete m_renderBus;
-	delete m_clipRenderBus;
+	delete m_processGraph;
 	delete m_hs;
         delete m_audiodeviceClient;
         delete m_snaplist;
@@ -170,15 +171,9 @@ void Sheet::init()
 
     mixdown = gainbuffer = nullptr;
 
-        BusConfig busConfig;
-        busConfig.name = "Sheet Render Bus";
-        busConfig.channelcount = 2;
-        busConfig.type = "output";
-        busConfig.isInternalBus = true;
-        m_renderBus = new AudioBus(busConfig);
-
-        busConfig.name = "Sheet Clip Render Bus";
-        m_clipRenderBus = new AudioBus(busConfig);
+        m_processGraph = new TProcessGraph();
+        // Process, pre-send and clip buffers for 2 channels per AudioTrack
+        m_bufferArena = QSharedPointer<TAudioBufferArena>(new TAudioBufferArena(6));
 
         m_masterOutBusTrack = new MasterOutSubGroup(this, tr("Sheet Master"));
         m_masterOutBusTrack->set_gain(0.5);
@@ -442,8 +437,6 @@ int Sheet::prepare_export(ExportSpecification* spec)
 	
 	m_transportLocation = spec->startLocation;
 	
-        resize_buffer(spec->blocksize);
-	
 	renderDecodeBuffer = new DecodeBuffer;
 
 	return 1;
@@ -453,7 +446,6 @@ int Sheet::finish_audio_export()
 {
         delete renderDecodeBuffer;
     renderDecodeBuffer = nullptr;
-        resize_buffer(audiodevice().get_buffer_size());
         m_rendering = false;
         return 0;
 }
@@ -479,11 +471,7 @@ int Sheet::start_export(ExportSpecification* spec)
 
 
                 if (spec->renderpass == ExportSpecification::WRITE_TO_HARDDISK) {
-                        m_exportSource = new WriteSource(spec);
-
-                        if (m_exportSource->prepare_export() == -1) {
-                                delete m_exportSource;
-                                m_exportSource = nullptr;
+                        if (create_export_sources(spec) < 0) {
                                 return -1;
                         }
 
@@ -501,9 +489,7 @@ int Sheet::start_export(ExportSpecification* spec)
                 spec->peakvalue = peakvalue;
 
                 if (spec->renderpass == ExportSpecification::WRITE_TO_HARDDISK) {
-                        m_exportSource->finish_export();
-                        delete m_exportSource;
-                        m_exportSource = nullptr;
+                        delete_export_sources(true);
                 }
         }
 
@@ -511,6 +497,80 @@ int Sheet::start_export(ExportSpecification* spec)
         return 1;
 }
 
+// Creates the WriteSources for the current cd track, one for each target
+// of spec, or one writing the format of spec itself if it has no targets.
+int Sheet::create_export_sources(ExportSpecification* spec)
+{
+        QList<ExportSpecification*> specs;
+
+        if (spec->targets.isEmpty()) {
+                specs.append(spec);
+        } else {
+                foreach(const ExportTarget& target, spec->targets) {
+                        ExportSpecification* targetSpec = spec->create_target_specification(target);
+                        m_targetSpecs.append(targetSpec);
+                        specs.append(targetSpec);
+                }
+        }
+
+        // resample, dither and encode on other threads while mixing the next block
+        bool pipeline = config().get_property("Export", "pipeline", true).toBool();
+        int depth = qMax(1, config().get_property("Export", "pipelinedepth", 4).toInt());
+
+        foreach(ExportSpecification* sourceSpec, specs) {
+                if (sourceSpec->is_valid() == -1) {
+                        delete_export_sources(false);
+                        return -1;
+                }
+
+                WriteSource* source = new WriteSource(sourceSpec);
+                m_exportSources.append(source);
+
+                if (source->prepare_export() == -1) {
+                        delete_export_sources(false);
+                        return -1;
+                }
+
+                if (pipeline) {
+                        ExportEncoder* encoder = new ExportEncoder(source, spec->channels, spec->blocksize, depth);
+                        m_exportEncoders.append(encoder);
+                        encoder->start();
+                }
+        }
+
+        if (!pipeline && m_exportSources.size() > 1) {
+                m_exportScratch = new audio_sample_t[spec->blocksize * spec->channels];
+        }
+
+        return 1;
+}
+
+// Waits for the encoders, and closes the written files if finish is true
+void Sheet::delete_export_sources(bool finish)
+{
+        foreach(ExportEncoder* encoder, m_exportEncoders) {
+                encoder->finish();
+                delete encoder;
+        }
+        m_exportEncoders.clear();
+
+        foreach(WriteSource* source, m_exportSources) {
+                if (finish) {
+                        source->finish_export();
+                }
+                delete source;
+        }
+        m_exportSources.clear();
+
+        foreach(ExportSpecification* targetSpec, m_targetSpecs) {
+                delete targetSpec;
+        }
+        m_targetSpecs.clear();
+
+        delete [] m_exportScratch;
+        m_exportScratch = nullptr;
+}
+
 int Sheet::render(ExportSpecification* spec)
 {
 	int chn;
@@ -518,11 +578,19 @@ int Sheet::render(ExportSpecification* spec)
         int progress = 0;
 
         nframes_t diff = (spec->cdTrackEnd - spec->pos).to_frame(int(audiodevice().get_sample_rate()));
-	nframes_t nframes = spec->blocksize;
-	nframes_t this_nframes = std::min(diff, nframes);
+	nframes_t nframes = std::min(diff, nframes_t(spec->blocksize));
+
+	// Tracks and buses are processed in audio device sized cycles, their
+	// buffers are no larger. The cycles are collected into spec->dataF.
+	nframes_t cycle = audiodevice().get_buffer_size();
+
+	// the write pass of a normalised export takes the mix from the norm factor pass
+	bool fromSpill = (spec->spill && spec->renderpass == ExportSpecification::WRITE_TO_HARDDISK);
 
-	if (!spec->running || spec->stop || this_nframes == 0) {
-		process_export (nframes);
+	if (!spec->running || spec->stop || nframes == 0) {
+		if (!fromSpill) {
+			process_export (cycle);
+		}
 		/*		PWARN("Finished Rendering for this sheet");
 				PWARN("running is %d", spec->running);
 				PWARN("stop is %d", spec->stop);
@@ -530,49 +598,90 @@ int Sheet::render(ExportSpecification* spec)
                 return 0;
 	}
 
-	/* do the usual stuff */
+	if (fromSpill) {
+		nframes_t count = nframes * spec->channels;
+		nframes_t read = spec->spill->read(spec->dataF, count);
+		memset(spec->dataF + read, 0, sizeof(spec->dataF[0]) * (count - read));
+	} else {
+		AudioBus* masterOutBus = m_masterOutBusTrack->get_process_bus();
 
-	process_export(nframes);
+		for (nframes_t done = 0; done < nframes; done += cycle) {
 
-	/* and now export the results */
+			/* do the usual stuff */
 
-	nframes = this_nframes;
+			process_export(cycle);
 
-    memset (spec->dataF, 0, sizeof (spec->dataF[0]) * nframes * ulong(spec->channels));
+			/* and now collect the results */
 
-	/* foreach output channel ... */
+			nframes_t this_nframes = std::min(cycle, nframes - done);
+			float* dest = spec->dataF + done * spec->channels;
 
-	float* buf;
-	AudioBus* masterOutBus = m_masterOutBusTrack->get_process_bus();
+			/* foreach output channel ... */
 
-	for (chn = 0; chn < spec->channels; ++chn) {
-		buf = masterOutBus->get_buffer(chn, nframes);
+			float* buf;
+			float* bufs[2];
 
-		if (!buf) {
-			// Seem we are exporting at least to Stereo from an AudioBus with only one channel...
-			// Use the first channel..
-			buf = masterOutBus->get_buffer(0, nframes);
-		}
+			for (chn = 0; chn < int(spec->channels); ++chn) {
+				buf = masterOutBus->get_buffer(chn, this_nframes);
+
+				if (!buf) {
+					// Seem we are exporting at least to Stereo from an AudioBus with only one channel...
+					// Use the first channel..
+					buf = masterOutBus->get_buffer(0, this_nframes);
+				}
 
-        for (x = 0; x < int(nframes); ++x) {
-			spec->dataF[chn+(x*spec->channels)] = buf[x];
+				if (spec->channels == 2) {
+					bufs[chn] = buf;
+					continue;
+				}
+
+				for (x = 0; x < int(this_nframes); ++x) {
+					dest[chn+(x*spec->channels)] = buf[x];
+				}
+			}
+
+			if (spec->channels == 2) {
+				Mixer::interleave_stereo(dest, bufs[0], bufs[1], this_nframes);
+			}
 		}
 	}
 
 
-    int bufsize = int(int(spec->blocksize) * spec->channels);
+    nframes_t bufsize = nframes * spec->channels;
 	if (spec->normalize) {
 		if (spec->renderpass == ExportSpecification::CALC_NORM_FACTOR) {
-            spec->peakvalue = Mixer::compute_peak(spec->dataF, nframes_t(bufsize), spec->peakvalue);
+            spec->peakvalue = Mixer::compute_peak(spec->dataF, bufsize, spec->peakvalue);
+			if (spec->spill) {
+				spec->spill->write(spec->dataF, bufsize);
+			}
 		}
 	}
 	
 	if (spec->renderpass == ExportSpecification::WRITE_TO_HARDDISK) {
 		if (spec->normalize) {
-            Mixer::apply_gain_to_buffer(spec->dataF, nframes_t(bufsize), spec->normvalue);
+            Mixer::apply_gain_to_buffer(spec->dataF, bufsize, spec->normvalue);
 		}
-		if (m_exportSource->process (nframes)) {
-                        return -1;
+
+		bool endOfInput = (spec->pos + TimeRef(nframes, audiodevice().get_sample_rate())) >= spec->endLocation;
+
+		// every target gets the same block, with it's own resampling and dithering
+		for (int i = 0; i < m_exportSources.size(); ++i) {
+			if (!m_exportEncoders.isEmpty()) {
+				if (m_exportEncoders.at(i)->write(spec->dataF, nframes, endOfInput) < 0) {
+					return -1;
+				}
+				continue;
+			}
+
+			audio_sample_t* data = spec->dataF;
+			// WriteSource clips in place, keep the block intact for the next target
+			if (m_exportScratch) {
+				memcpy(m_exportScratch, spec->dataF, sizeof(audio_sample_t) * bufsize);
+				data = m_exportScratch;
+			}
+			if (m_exportSources.at(i)->process(data, nframes, endOfInput)) {
+				return -1;
+			}
 		}
 	}
 	
@@ -744,14 +853,8 @@ int Sheet::process( nframes_t nframes )
 	int processResult = 0;
 
 
-	// Process all Tracks.
-        apill_foreach(AudioTrack* track, AudioTrack*, m_rtAudioTracks) {
-		processResult |= track->process(nframes);
-	}
-
-        apill_foreach(TBusTrack* busTrack, TBusTrack*, m_rtBusTracks) {
-                busTrack->process(nframes);
-        }
+	// Process all Tracks, in parallel if possible.
+	processResult = m_processGraph->process(m_rtAudioTracks, m_rtBusTracks, nframes);
 
 	// update the transport location
     m_transportLocation.add_frames(nframes, int(audiodevice().get_sample_rate()));
@@ -804,10 +907,15 @@ void Sheet::resize_buffer(nframes_t size)
 		delete [] gainbuffer;
 	mixdown = new audio_sample_t[size];
 	gainbuffer = new audio_sample_t[size];
+
+        // Removed tracks fetch their buffers again when they are added back
+        m_bufferArena->set_buffer_size(size);
+        foreach(AudioTrack* track, m_audioTracks) {
+                track->update_render_buffers();
+        }
+
         QList<AudioBus*> buses;
         buses.append(m_masterOutBusTrack->get_process_bus());
-        buses.append(m_renderBus);
-        buses.append(m_clipRenderBus);
         foreach(AudioBus* bus, buses) {
                 for(int i=0; i<bus->get_channel_count(); i++) {
                         if (AudioChannel* chan = bus->get_channel(i)) {
@@ -25,6 +25,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.
 #include "TSession.h"
 #include <QDomNode>
 #include <QTimer>
+#include <QSharedPointer>
 #include "defines.h"
 #include "APILinkedList.h"
 
@@ -32,6 +33,7 @@ class Project;
 class AudioTrack;
 class AudioSource;
 class WriteSource;
+class ExportEncoder;
 class AudioTrack;
 class AudioClip;
 class DiskIO;
@@ -44,6 +46,8 @@ class Snappable;
 class DecodeBuffer;
 class TBusTrack;
 class Track;
+class TProcessGraph;
+class TAudioBufferArena;
 
 struct ExportSpecification;
 
@@ -67,9 +71,8 @@ public:
         Project* get_project() const {return m_project;}
 	DiskIO*	get_diskio() const;
 	AudioClipManager* get_audioclip_manager() const;
-	AudioBus* get_render_bus() const {return m_renderBus;}
-	AudioBus* get_clip_render_bus() const {return m_clipRenderBus;}
         AudioTrack* get_audio_track_for_index(int index);
+	QSharedPointer<TAudioBufferArena> get_buffer_arena() const {return m_bufferArena;}
         QString get_audio_sources_dir() const;
         TimeRef get_last_location() const;
 
@@ -116,10 +119,14 @@ private:
         QList<AudioClip*>	m_recordingClips;
 	QTimer			m_skipTimer;
 	Project*		m_project;
-    WriteSource*		m_exportSource{};
+    // One WriteSource (and ExportEncoder when pipelined) per export target
+    QList<WriteSource*>		m_exportSources;
+    QList<ExportEncoder*>	m_exportEncoders;
+    QList<ExportSpecification*>	m_targetSpecs;
+    audio_sample_t*		m_exportScratch{};
         TAudioDeviceClient*	m_audiodeviceClient{};
-        AudioBus*		m_renderBus{};
-    AudioBus*		m_clipRenderBus{};
+    TProcessGraph*		m_processGraph{};
+    QSharedPointer<TAudioBufferArena>	m_bufferArena;
     DiskIO*			m_diskio{};
     AudioClipManager*	m_acmanager{};
 	QList<TimeRef>		m_xposList;
@@ -150,6 +157,8 @@ private:
 	void init();
 
 	int finish_audio_export();
+	int create_export_sources(ExportSpecification* spec);
+	void delete_export_sources(bool finish);
 	void start_seek();
         void initiate_seek_start(TimeRef location);
 	void start_transport_rolling(bool realtime);
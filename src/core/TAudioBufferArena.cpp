@@ -0,0 +1,105 @@
+/*
+Copyright (C) 2026 The Traverso developers
+
+This file is part of Traverso
+
+Traverso is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.
+
+*/
+
+#include "TAudioBufferArena.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Always put me below _all_ includes, this is needed
+// in case we run with memory leak detection enabled!
+#include "Debugger.h"
+
+#define ARENA_ALIGNMENT 64
+
+
+TAudioBufferArena::TAudioBufferArena(int buffersPerSlot)
+	: m_buffersPerSlot(buffersPerSlot)
+	, m_bufferSize(0)
+	, m_stride(0)
+{
+}
+
+TAudioBufferArena::~TAudioBufferArena()
+{
+	foreach(const Block& block, m_blocks) {
+		free(block.allocation);
+	}
+}
+
+void TAudioBufferArena::allocate_block(Block& block)
+{
+	size_t bytes = m_stride * SLOTS_PER_BLOCK * m_buffersPerSlot * sizeof(audio_sample_t);
+	block.allocation = (char*) malloc(bytes + ARENA_ALIGNMENT);
+	block.data = (audio_sample_t*) (((uintptr_t) block.allocation + ARENA_ALIGNMENT - 1) & ~uintptr_t(ARENA_ALIGNMENT - 1));
+	memset(block.data, 0, bytes);
+}
+
+int TAudioBufferArena::allocate_slot()
+{
+	int slot = m_usedSlots.indexOf(false);
+
+	if (slot == -1) {
+		Block block;
+		allocate_block(block);
+		m_blocks.append(block);
+		slot = m_usedSlots.size();
+		m_usedSlots.resize(m_usedSlots.size() + SLOTS_PER_BLOCK);
+	}
+
+	m_usedSlots[slot] = true;
+
+	return slot;
+}
+
+void TAudioBufferArena::release_slot(int slot)
+{
+	Q_ASSERT(slot >= 0 && slot < m_usedSlots.size());
+	m_usedSlots[slot] = false;
+}
+
+audio_sample_t* TAudioBufferArena::get_buffer(int slot, int buffer) const
+{
+	Q_ASSERT(buffer < m_buffersPerSlot);
+	const Block& block = m_blocks.at(slot / SLOTS_PER_BLOCK);
+	return block.data + ((slot % SLOTS_PER_BLOCK) * m_buffersPerSlot + buffer) * m_stride;
+}
+
+void TAudioBufferArena::set_buffer_size(nframes_t size)
+{
+	// Round up, so every buffer starts at a cache line
+	size_t samplesPerLine = ARENA_ALIGNMENT / sizeof(audio_sample_t);
+	size_t stride = ((size + samplesPerLine - 1) / samplesPerLine) * samplesPerLine;
+
+	m_bufferSize = size;
+
+	if (stride == m_stride) {
+		return;
+	}
+
+	m_stride = stride;
+
+	for (int i=0; i<m_blocks.size(); ++i) {
+		free(m_blocks[i].allocation);
+		allocate_block(m_blocks[i]);
+	}
+}
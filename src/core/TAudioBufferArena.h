@@ -0,0 +1,70 @@
+/*
+Copyright (C) 2026 The Traverso developers
+
+This file is part of Traverso
+
+Traverso is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.
+
+*/
+
+#ifndef TAUDIOBUFFERARENA_H
+#define TAUDIOBUFFERARENA_H
+
+#include "defines.h"
+
+#include <QList>
+#include <QVector>
+
+/**
+ * Hands out slots of a fixed amount of cache line aligned audio buffers,
+ * carved out of a few big allocations.
+ *
+ * Slots are allocated and released from the GUI thread. Growing the arena
+ * never moves existing slots, set_buffer_size() does, so it may only be
+ * called while no audio processing takes place. The slot owners have to
+ * fetch their buffers again afterwards.
+ */
+class TAudioBufferArena
+{
+public:
+	TAudioBufferArena(int buffersPerSlot);
+	~TAudioBufferArena();
+
+	int allocate_slot();
+	void release_slot(int slot);
+
+	audio_sample_t* get_buffer(int slot, int buffer) const;
+	nframes_t get_buffer_size() const {return m_bufferSize;}
+
+	void set_buffer_size(nframes_t size);
+
+private:
+	static const int SLOTS_PER_BLOCK = 16;
+
+	struct Block {
+		char*		allocation;
+		audio_sample_t*	data;
+	};
+
+	QList<Block>	m_blocks;
+	QVector<bool>	m_usedSlots;
+	int		m_buffersPerSlot;
+	nframes_t	m_bufferSize;
+	size_t		m_stride;
+
+	void allocate_block(Block& block);
+};
+
+#endif
@@ -0,0 +1,102 @@
+/*
+Copyright (C) 2026 The Traverso developers
+
+This file is part of Traverso
+
+Traverso is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.
+
+*/
+
+#include "TAudioRamCache.h"
+
+#include <QMutexLocker>
+#include <string.h>
+
+#include "AbstractAudioReader.h"
+#include "ReadSource.h"
+#include "TConfig.h"
+
+// Always put me below _all_ includes, this is needed
+// in case we run with memory leak detection enabled!
+#include "Debugger.h"
+
+
+TAudioRamCache& audio_ram_cache()
+{
+	static TAudioRamCache cache;
+	return cache;
+}
+
+
+bool TAudioRamCache::fits(ReadSource* source)
+{
+	double maxLength = config().get_property("Hardware", "ramplaybacklength", 5.0).toDouble();
+
+	return source->get_channel_count() > 0 && source->get_nframes() > 0 &&
+		source->get_nframes() <= nframes_t(maxLength * source->get_output_rate());
+}
+
+// Returns the audio of the source at it's output rate, loading it if no
+// other ReadSource of it did so yet. Returns 0 if reading failed.
+const TRamAudio* TAudioRamCache::acquire(ReadSource* source)
+{
+	QMutexLocker locker(&m_mutex);
+
+	Key key(source->get_id(), source->get_output_rate());
+	Entry* entry = m_entries.value(key);
+
+	if (entry) {
+		entry->refcount++;
+		return &entry->audio;
+	}
+
+	nframes_t nframes = source->get_nframes();
+	DecodeBuffer buffer;
+
+	if (source->file_read(&buffer, nframes_t(0), nframes) != int(nframes)) {
+		return nullptr;
+	}
+
+	entry = new Entry;
+	entry->refcount = 1;
+	entry->audio.nframes = nframes;
+	entry->audio.channels.resize(source->get_channel_count());
+
+	for (int chan = 0; chan < entry->audio.channels.size(); ++chan) {
+		entry->audio.channels[chan].resize(nframes);
+		memcpy(entry->audio.channels[chan].data(), buffer.destination[chan], nframes * sizeof(audio_sample_t));
+	}
+
+	m_entries.insert(key, entry);
+
+	return &entry->audio;
+}
+
+void TAudioRamCache::release(const TRamAudio* audio)
+{
+	QMutexLocker locker(&m_mutex);
+
+	QHash<Key, Entry*>::iterator it = m_entries.begin();
+	while (it != m_entries.end()) {
+		if (&it.value()->audio == audio) {
+			if (--it.value()->refcount == 0) {
+				delete it.value();
+				m_entries.erase(it);
+			}
+			return;
+		}
+		++it;
+	}
+}
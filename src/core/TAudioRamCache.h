@@ -0,0 +1,75 @@
+/*
+Copyright (C) 2026 The Traverso developers
+
+This file is part of Traverso
+
+Traverso is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.
+
+*/
+
+#ifndef TAUDIORAMCACHE_H
+#define TAUDIORAMCACHE_H
+
+#include <QMutex>
+#include <QHash>
+#include <QPair>
+#include <QVector>
+
+#include "defines.h"
+
+class ReadSource;
+
+/// The complete audio of a source at the output rate
+struct TRamAudio {
+	QVector<QVector<audio_sample_t> >	channels;
+	nframes_t				nframes;
+};
+
+/**
+ * Holds the audio of short sources in memory, so they can be played without
+ * ringbuffers and DiskIO processing. The audio is shared by all (deep copied)
+ * ReadSources of the same source, and freed when the last one releases it.
+ *
+ * Sources up to "Hardware"/"ramplaybacklength" seconds are played from
+ * memory, 0 disables it.
+ */
+class TAudioRamCache
+{
+public:
+	bool fits(ReadSource* source);
+	const TRamAudio* acquire(ReadSource* source);
+	void release(const TRamAudio* audio);
+
+private:
+	struct Entry {
+		TRamAudio	audio;
+		int		refcount;
+	};
+
+	typedef QPair<qint64, uint> Key;
+
+	QMutex			m_mutex;
+	QHash<Key, Entry*>	m_entries;
+
+	TAudioRamCache() {}
+	TAudioRamCache(const TAudioRamCache&);
+	// allow this function to create one instance
+	friend TAudioRamCache& audio_ram_cache();
+};
+
+// use this function to access the audio ram cache
+TAudioRamCache& audio_ram_cache();
+
+#endif
@@ -0,0 +1,202 @@
+/*
+Copyright (C) 2026 The Traverso developers
+
+This file is part of Traverso
+
+Traverso is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.
+
+*/
+
+#include "TAudioTileCache.h"
+
+#include <QMutexLocker>
+#include <string.h>
+
+#include "AbstractAudioReader.h"
+#include "Peak.h"
+#include "ReadSource.h"
+#include "TConfig.h"
+
+// Always put me below _all_ includes, this is needed
+// in case we run with memory leak detection enabled!
+#include "Debugger.h"
+
+
+TAudioTileCache& audio_tile_cache()
+{
+	static TAudioTileCache cache;
+	return cache;
+}
+
+
+TAudioTileCache::TAudioTileCache()
+{
+	m_quit = false;
+	m_decodingPeak = nullptr;
+
+	// The cost of a tile is it's size in KB
+	int budget = config().get_property("Hardware", "microviewcachesize", 64).toInt();
+	m_tiles.setMaxCost(qMax(1, budget) * 1024);
+
+	m_decoder = new TAudioTileDecoder(this);
+	m_decoder->start(QThread::LowPriority);
+}
+
+TAudioTileCache::~TAudioTileCache()
+{
+	m_mutex.lock();
+	m_quit = true;
+	m_requestAvailable.wakeAll();
+	m_mutex.unlock();
+
+	if (!m_decoder->wait(1000)) {
+		m_decoder->terminate();
+	}
+	delete m_decoder;
+}
+
+// Copies the samples of a cached tile, the copy is implicitly shared, so this is cheap
+bool TAudioTileCache::get_tile(qint64 sourceId, uint rate, uint channel, qint64 tile, QVector<audio_sample_t>& samples)
+{
+	QMutexLocker locker(&m_mutex);
+
+	TileKey key = {sourceId, tile, rate, channel};
+	QVector<audio_sample_t>* cached = m_tiles.object(key);
+
+	if (!cached) {
+		return false;
+	}
+
+	samples = *cached;
+	return true;
+}
+
+// Queues decoding of all channels of a tile of the Peak's source, most recent requests first
+void TAudioTileCache::request_tile(Peak* peak, qint64 tile)
+{
+	QMutexLocker locker(&m_mutex);
+
+	Request request = {peak, peak->m_source->get_id(), tile, peak->m_source->get_output_rate()};
+
+	for (int i=0; i<m_queue.size(); ++i) {
+		const Request& queued = m_queue.at(i);
+		if (queued.sourceId == request.sourceId && queued.tile == request.tile && queued.rate == request.rate) {
+			m_queue.removeAt(i);
+			break;
+		}
+	}
+
+	m_queue.prepend(request);
+
+	while (m_queue.size() > MAX_QUEUED_REQUESTS) {
+		m_queue.removeLast();
+	}
+
+	m_requestAvailable.wakeOne();
+}
+
+// Called when the Peak is deleted, waits if a tile of it is being decoded right now
+void TAudioTileCache::cancel_requests(Peak* peak)
+{
+	QMutexLocker locker(&m_mutex);
+
+	for (int i=m_queue.size() - 1; i>=0; --i) {
+		if (m_queue.at(i).peak == peak) {
+			m_queue.removeAt(i);
+		}
+	}
+
+	while (m_decodingPeak == peak) {
+		m_requestFinished.wait(&m_mutex);
+	}
+}
+
+// Called from the decoder thread, blocks until there is work or we quit
+bool TAudioTileCache::take_request(Request& request)
+{
+	QMutexLocker locker(&m_mutex);
+
+	while (!m_quit) {
+		while (!m_queue.isEmpty()) {
+			request = m_queue.takeFirst();
+
+			// Another Peak of the same source might have requested it already
+			TileKey key = {request.sourceId, request.tile, request.rate, 0};
+			if (m_tiles.contains(key)) {
+				continue;
+			}
+
+			m_decodingPeak = request.peak;
+			return true;
+		}
+
+		m_requestAvailable.wait(&m_mutex);
+	}
+
+	return false;
+}
+
+void TAudioTileCache::decode(const Request& request, DecodeBuffer* buffer)
+{
+	Peak* peak = request.peak;
+	uint channels;
+	int read;
+
+	{
+		QMutexLocker sourceLocker(&peak->m_sourceMutex);
+		ReadSource* source = peak->m_source;
+		channels = source->get_channel_count();
+		read = source->file_read(buffer, nframes_t(request.tile * TILE_FRAMES), TILE_FRAMES);
+	}
+
+	QMutexLocker locker(&m_mutex);
+
+	m_decodingPeak = nullptr;
+	m_requestFinished.wakeAll();
+
+	if (read <= 0) {
+		return;
+	}
+
+	int cost = qMax(1, int(read * sizeof(audio_sample_t) / 1024));
+
+	for (uint chan = 0; chan < channels; ++chan) {
+		QVector<audio_sample_t>* samples = new QVector<audio_sample_t>(read);
+		memcpy(samples->data(), buffer->destination[chan], read * sizeof(audio_sample_t));
+
+		TileKey key = {request.sourceId, request.tile, request.rate, chan};
+		m_tiles.insert(key, samples, cost);
+	}
+
+	locker.unlock();
+
+	emit tileAvailable(request.sourceId);
+}
+
+
+TAudioTileDecoder::TAudioTileDecoder(TAudioTileCache* cache)
+{
+	m_cache = cache;
+}
+
+void TAudioTileDecoder::run()
+{
+	DecodeBuffer buffer;
+	TAudioTileCache::Request request;
+
+	while (m_cache->take_request(request)) {
+		m_cache->decode(request, &buffer);
+	}
+}
@@ -0,0 +1,125 @@
+/*
+Copyright (C) 2026 The Traverso developers
+
+This file is part of Traverso
+
+Traverso is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.
+
+*/
+
+#ifndef TAUDIOTILECACHE_H
+#define TAUDIOTILECACHE_H
+
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QCache>
+#include <QList>
+#include <QVector>
+
+#include "defines.h"
+
+class Peak;
+class DecodeBuffer;
+class TAudioTileDecoder;
+
+/**
+ * Keeps the decoded audio of recently drawn micro view parts in memory.
+ *
+ * The audio is cached per source and channel in tiles of TILE_FRAMES frames,
+ * and the least recently used tiles are dropped once the memory budget
+ * ("Hardware"/"microviewcachesize", in MB) is exceeded. Missing tiles are
+ * decoded by a background thread, tileAvailable() is emitted for each
+ * decoded tile so the views can repaint.
+ */
+class TAudioTileCache : public QObject
+{
+	Q_OBJECT
+
+public:
+	static const nframes_t TILE_FRAMES = 16384;
+
+	bool get_tile(qint64 sourceId, uint rate, uint channel, qint64 tile, QVector<audio_sample_t>& samples);
+	void request_tile(Peak* peak, qint64 tile);
+	void cancel_requests(Peak* peak);
+
+signals:
+	void tileAvailable(qint64 sourceId);
+
+private:
+	struct TileKey {
+		qint64	sourceId;
+		qint64	tile;
+		uint	rate;
+		uint	channel;
+
+		bool operator==(const TileKey& other) const {
+			return sourceId == other.sourceId && tile == other.tile &&
+				rate == other.rate && channel == other.channel;
+		}
+		friend uint qHash(const TileKey& key) {
+			return qHash(key.sourceId) ^ qHash(key.tile * 31 + key.channel) ^ key.rate;
+		}
+	};
+
+	struct Request {
+		Peak*	peak;
+		qint64	sourceId;
+		qint64	tile;
+		uint	rate;
+	};
+
+	// Scrolling queues a lot of tiles which aren't visible anymore
+	// by the time they would be decoded, so the queue is kept short.
+	static const int MAX_QUEUED_REQUESTS = 64;
+
+	TAudioTileDecoder*			m_decoder;
+	QMutex					m_mutex;
+	QWaitCondition				m_requestAvailable;
+	QWaitCondition				m_requestFinished;
+	QCache<TileKey, QVector<audio_sample_t> >	m_tiles;
+	QList<Request>				m_queue;
+	Peak*					m_decodingPeak;
+	bool					m_quit;
+
+	bool take_request(Request& request);
+	void decode(const Request& request, DecodeBuffer* buffer);
+
+	TAudioTileCache();
+	~TAudioTileCache();
+	TAudioTileCache(const TAudioTileCache&);
+	// allow this function to create one instance
+	friend TAudioTileCache& audio_tile_cache();
+	friend class TAudioTileDecoder;
+};
+
+class TAudioTileDecoder : public QThread
+{
+public:
+	TAudioTileDecoder(TAudioTileCache* cache);
+
+protected:
+	void run();
+
+private:
+	TAudioTileCache* m_cache;
+};
+
+
+// use this function to access the micro view audio cache
+TAudioTileCache& audio_tile_cache();
+
+#endif
@@ -114,18 +114,6 @@ int TBusTrack::process(nframes_t nframes)
 
     m_pluginChain->process_pre_fader(m_processBus, nframes);
 
-    float panFactor;
-
-    if ( (m_processBus->get_channel_count() >= 1) && (m_pan > 0) )  {
-        panFactor = 1 - m_pan;
-        Mixer::apply_gain_to_buffer(m_processBus->get_buffer(0, nframes), nframes, panFactor);
-    }
-
-    if ( (m_processBus->get_channel_count() >= 2) && (m_pan < 0) )  {
-        panFactor = 1 + m_pan;
-        Mixer::apply_gain_to_buffer(m_processBus->get_buffer(1, nframes), nframes, panFactor);
-    }
-
     // gain automation curve only understands audio_sample_t** atm
     // so wrap the process buffers into a audio_sample_t**
     // FIXME make it future proof so it can deal with any amount of channels?
@@ -136,7 +124,7 @@ int TBusTrack::process(nframes_t nframes)
     TimeRef location = m_session->get_transport_location();
     TimeRef endlocation = location + TimeRef(nframes, audiodevice().get_sample_rate());
 
-    m_fader->process_gain(mixdown, location, endlocation, nframes, m_processBus->get_channel_count());
+    m_fader->process_gain(mixdown, location, endlocation, nframes, m_processBus->get_channel_count(), m_pan);
 
     m_pluginChain->process_post_fader(m_processBus, nframes);
 
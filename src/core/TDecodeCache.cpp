@@ -0,0 +1,357 @@
+/*
+Copyright (C) 2026 The Traverso developers
+
+This file is part of Traverso
+
+Traverso is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.
+
+*/
+
+#include "TDecodeCache.h"
+
+#include <QMutexLocker>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QDateTime>
+#include <QtEndian>
+#include <string.h>
+
+#include "ResampleAudioReader.h"
+#include "ReadSource.h"
+#include "Project.h"
+#include "ProjectManager.h"
+#include "TConfig.h"
+
+// Always put me below _all_ includes, this is needed
+// in case we run with memory leak detection enabled!
+#include "Debugger.h"
+
+
+// RIFF, fmt, source info and data chunk headers
+static const int WAV_HEADER_SIZE = 12 + 24 + 24 + 8;
+static const nframes_t WRITE_CHUNK_FRAMES = 65536;
+
+
+TDecodeCache& decode_cache()
+{
+	static TDecodeCache cache;
+	return cache;
+}
+
+
+TDecodeCache::TDecodeCache()
+{
+	m_writer = nullptr;
+	m_quit = false;
+}
+
+TDecodeCache::~TDecodeCache()
+{
+	if (!m_writer) {
+		return;
+	}
+
+	m_mutex.lock();
+	m_quit = true;
+	m_jobAvailable.wakeAll();
+	m_mutex.unlock();
+
+	if (!m_writer->wait(2000)) {
+		m_writer->terminate();
+	}
+	delete m_writer;
+}
+
+// Called when the source is registered for playback. Switches it to the
+// cached copy right away if there is one, or queues making it.
+void TDecodeCache::add_source(ReadSource* source)
+{
+	// The copy has to be at the rate the source is read at
+	uint rate = source->get_output_rate();
+	if (!config().get_property("Conversion", "DynamicResampling", true).toBool()) {
+		rate = source->get_file_rate();
+	}
+	uint channels = source->get_channel_count();
+
+	QString decoder = source->get_decoder_type();
+	bool compressed = (decoder == "flac" || decoder == "vorbis" || decoder == "wavpack" || decoder == "mad");
+	bool resampled = (rate != source->get_file_rate());
+
+	if (!(compressed && config().get_property("Conversion", "DecodeCache", false).toBool()) &&
+	    !(resampled && config().get_property("Conversion", "ResampleCache", false).toBool())) {
+		return;
+	}
+
+	// Wav files can't hold more than 4 GB
+	if (quint64(source->get_nframes()) * channels * sizeof(float) > quint64(0xffffffff - WAV_HEADER_SIZE)) {
+		return;
+	}
+
+	QString cacheFile = cache_file_name(source);
+	if (cacheFile.isEmpty()) {
+		return;
+	}
+
+	// Copies are resampled once, so use the best converter unless told otherwise.
+	// Copies made with another converter are kept apart.
+	int converterType = config().get_property("Conversion", "ResampleCacheConverterType", 0).toInt();
+
+	cacheFile += "-" + QString::number(rate);
+	if (resampled) {
+		cacheFile += "-q" + QString::number(converterType);
+	}
+	cacheFile += ".wav";
+
+	if (is_valid(cacheFile, source->get_filename(), rate, channels)) {
+		source->use_decode_cache(cacheFile);
+		return;
+	}
+
+	QMutexLocker locker(&m_mutex);
+
+	m_sources.insert(source, cacheFile);
+
+	if (m_currentFile == cacheFile) {
+		return;
+	}
+	foreach(const Job& queued, m_queue) {
+		if (queued.cacheFile == cacheFile) {
+			return;
+		}
+	}
+
+	Job job = {source->get_filename(), decoder, cacheFile, rate, channels, converterType};
+	m_queue.append(job);
+
+	if (!m_writer) {
+		m_writer = new TDecodeCacheWriter(this);
+		m_writer->start(QThread::LowPriority);
+	}
+
+	m_jobAvailable.wakeOne();
+}
+
+// Called when the source is unregistered or deleted, copies nobody waits
+// for anymore are not made
+void TDecodeCache::remove_source(ReadSource* source)
+{
+	QMutexLocker locker(&m_mutex);
+
+	m_sources.remove(source);
+}
+
+// Called from the writer thread, blocks until there is work or we quit
+bool TDecodeCache::take_job(Job& job)
+{
+	QMutexLocker locker(&m_mutex);
+
+	m_currentFile = QString();
+
+	while (!m_quit) {
+		while (!m_queue.isEmpty()) {
+			job = m_queue.takeFirst();
+
+			if (m_sources.key(job.cacheFile)) {
+				m_currentFile = job.cacheFile;
+				return true;
+			}
+		}
+
+		m_jobAvailable.wait(&m_mutex);
+	}
+
+	return false;
+}
+
+bool TDecodeCache::is_wanted(const QString& cacheFile)
+{
+	QMutexLocker locker(&m_mutex);
+
+	return !m_quit && m_sources.key(cacheFile);
+}
+
+// Decodes the whole source into a temporary file, which is renamed
+// once complete, so a cache file is never used half written
+void TDecodeCache::write(const Job& job)
+{
+	ResampleAudioReader reader(job.sourceFile, job.decoder);
+
+	if (!reader.is_valid() || reader.get_num_channels() != job.channels) {
+		return;
+	}
+
+	reader.set_output_rate(job.rate);
+	reader.set_converter_type(job.converterType);
+
+	QString partFile = job.cacheFile + ".part";
+	QFile file(partFile);
+
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+		PWARN(QString("Couldn't open decode cache file %1 for writing").arg(partFile).toLatin1().data());
+		return;
+	}
+
+	nframes_t nframes = reader.get_nframes();
+	file.write(wav_header(job.rate, job.channels, job.sourceFile, qint64(nframes) * job.channels * sizeof(float)));
+
+	DecodeBuffer buffer;
+	QByteArray data(int(WRITE_CHUNK_FRAMES * job.channels * sizeof(float)), 0);
+	nframes_t pos = 0;
+
+	while (pos < nframes) {
+		if (!is_wanted(job.cacheFile)) {
+			break;
+		}
+
+		nframes_t read = reader.read_from(&buffer, pos, qMin(WRITE_CHUNK_FRAMES, nframes - pos));
+		if (read == 0) {
+			break;
+		}
+
+		uchar* dest = reinterpret_cast<uchar*>(data.data());
+		for (nframes_t i = 0; i < read; ++i) {
+			for (uint chan = 0; chan < job.channels; ++chan) {
+				quint32 bits;
+				memcpy(&bits, &buffer.destination[chan][i], sizeof(bits));
+				qToLittleEndian(bits, dest);
+				dest += sizeof(bits);
+			}
+		}
+
+		qint64 size = qint64(read) * job.channels * sizeof(float);
+		if (file.write(data.constData(), size) != size) {
+			break;
+		}
+
+		pos += read;
+	}
+
+	file.close();
+
+	if (pos < nframes) {
+		file.remove();
+		return;
+	}
+
+	QFile::remove(job.cacheFile);
+	if (!QFile::rename(partFile, job.cacheFile)) {
+		QFile::remove(partFile);
+		return;
+	}
+
+	job_finished(job.cacheFile);
+}
+
+// Switches all sources waiting for the cache file to it
+void TDecodeCache::job_finished(const QString& cacheFile)
+{
+	QMutexLocker locker(&m_mutex);
+
+	QHash<ReadSource*, QString>::iterator it = m_sources.begin();
+	while (it != m_sources.end()) {
+		if (it.value() == cacheFile) {
+			it.key()->use_decode_cache(cacheFile);
+			it = m_sources.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
+// Returns the cache file name without the rate and extension, or an empty
+// string if there is no project dir to store it in
+QString TDecodeCache::cache_file_name(ReadSource* source)
+{
+	Project* project = pm().get_project();
+	if (!project) {
+		return QString();
+	}
+
+	QString dir = project->get_root_dir() + "/decodecache";
+	if (!QDir().mkpath(dir)) {
+		return QString();
+	}
+
+	// Sources with the same name in different dirs get their own cache file
+	QFileInfo info(source->get_filename());
+	return dir + "/" + info.fileName() + "-" + QString::number(qHash(info.absoluteFilePath()), 16);
+}
+
+bool TDecodeCache::is_valid(const QString& cacheFile, const QString& sourceFile, uint rate, uint channels)
+{
+	QFile file(cacheFile);
+
+	if (!file.open(QIODevice::ReadOnly) || file.size() < WAV_HEADER_SIZE) {
+		return false;
+	}
+
+	QByteArray expected = wav_header(rate, channels, sourceFile, file.size() - WAV_HEADER_SIZE);
+
+	return file.read(expected.size()) == expected;
+}
+
+static void append_le(QByteArray& data, quint64 value, int bytes)
+{
+	for (int i = 0; i < bytes; ++i) {
+		data.append(char((value >> (8 * i)) & 0xff));
+	}
+}
+
+// A 32 bit float wav header, with an extra chunk holding the size and
+// modification time of the source, so changed sources are detected
+QByteArray TDecodeCache::wav_header(uint rate, uint channels, const QString& sourceFile, qint64 dataSize)
+{
+	QFileInfo source(sourceFile);
+	QByteArray header;
+
+	header.append("RIFF");
+	append_le(header, quint64(WAV_HEADER_SIZE - 8 + dataSize), 4);
+	header.append("WAVE");
+
+	header.append("fmt ");
+	append_le(header, 16, 4);
+	append_le(header, 3, 2);	// WAVE_FORMAT_IEEE_FLOAT
+	append_le(header, channels, 2);
+	append_le(header, rate, 4);
+	append_le(header, rate * channels * sizeof(float), 4);
+	append_le(header, channels * sizeof(float), 2);
+	append_le(header, 32, 2);
+
+	header.append("tsrc");
+	append_le(header, 16, 4);
+	append_le(header, quint64(source.size()), 8);
+	append_le(header, quint64(source.lastModified().toMSecsSinceEpoch()), 8);
+
+	header.append("data");
+	append_le(header, quint64(dataSize), 4);
+
+	return header;
+}
+
+
+TDecodeCacheWriter::TDecodeCacheWriter(TDecodeCache* cache)
+{
+	m_cache = cache;
+}
+
+void TDecodeCacheWriter::run()
+{
+	TDecodeCache::Job job;
+
+	while (m_cache->take_job(job)) {
+		m_cache->write(job);
+	}
+}
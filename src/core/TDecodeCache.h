@@ -0,0 +1,113 @@
+/*
+Copyright (C) 2026 The Traverso developers
+
+This file is part of Traverso
+
+Traverso is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.
+
+*/
+
+#ifndef TDECODECACHE_H
+#define TDECODECACHE_H
+
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QHash>
+#include <QList>
+#include <QByteArray>
+
+#include "defines.h"
+
+class ReadSource;
+class TDecodeCacheWriter;
+
+/**
+ * Keeps copies of sources which are used for playback, decoded (flac, ogg
+ * vorbis, wavpack, mp3) and resampled to the output rate, so the DiskIO threads
+ * don't have to decode and resample them in realtime.
+ *
+ * The copies are 32 bit float wav files, stored in the decodecache dir of the
+ * project, and made by a background thread. Resampling is done with the
+ * "Conversion"/"ResampleCacheConverterType" converter, the best one by default.
+ * Once a copy is complete, the ReadSources of it switch to reading the copy.
+ * A copy is reused across sessions as long as the size and modification time
+ * of it's source match.
+ *
+ * Copies of compressed sources are made if "Conversion"/"DecodeCache" is set,
+ * copies of sources at another rate if "Conversion"/"ResampleCache" is set.
+ */
+class TDecodeCache : public QObject
+{
+	Q_OBJECT
+
+public:
+	void add_source(ReadSource* source);
+	void remove_source(ReadSource* source);
+
+private:
+	struct Job {
+		QString		sourceFile;
+		QString		decoder;
+		QString		cacheFile;
+		uint		rate;
+		uint		channels;
+		int		converterType;
+	};
+
+	TDecodeCacheWriter*		m_writer;
+	QMutex				m_mutex;
+	QWaitCondition			m_jobAvailable;
+	QList<Job>			m_queue;
+	// The registered sources and the cache file they wait for
+	QHash<ReadSource*, QString>	m_sources;
+	QString				m_currentFile;
+	bool				m_quit;
+
+	bool take_job(Job& job);
+	bool is_wanted(const QString& cacheFile);
+	void write(const Job& job);
+	void job_finished(const QString& cacheFile);
+
+	static QString cache_file_name(ReadSource* source);
+	static bool is_valid(const QString& cacheFile, const QString& sourceFile, uint rate, uint channels);
+	static QByteArray wav_header(uint rate, uint channels, const QString& sourceFile, qint64 dataSize);
+
+	TDecodeCache();
+	~TDecodeCache();
+	TDecodeCache(const TDecodeCache&);
+	// allow this function to create one instance
+	friend TDecodeCache& decode_cache();
+	friend class TDecodeCacheWriter;
+};
+
+class TDecodeCacheWriter : public QThread
+{
+public:
+	TDecodeCacheWriter(TDecodeCache* cache);
+
+protected:
+	void run();
+
+private:
+	TDecodeCache* m_cache;
+};
+
+
+// use this function to access the decoded audio cache
+TDecodeCache& decode_cache();
+
+#endif
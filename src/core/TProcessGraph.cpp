@@ -0,0 +1,533 @@
+/*
+Copyright (C) 2026 The Traverso developers
+
+This file is part of Traverso
+
+Traverso is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.
+
+*/
+
+#include "TProcessGraph.h"
+
+#include <QThread>
+#include <QSemaphore>
+#include <QAtomicInt>
+#include <QAtomicInteger>
+#include <QList>
+
+#if defined (Q_OS_UNIX) || defined (Q_OS_MAC)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "APILinkedList.h"
+#include "AudioBus.h"
+#include "AudioTrack.h"
+#include "TBusTrack.h"
+#include "TConfig.h"
+
+// Always put me below _all_ includes, this is needed
+// in case we run with memory leak detection enabled!
+#include "Debugger.h"
+
+
+typedef void (*JobFunction)(void* context, int node);
+
+// The nodes to run and how they depend on each other, the edges of a node
+// form a linked list starting at firstEdge[node]
+struct TJobGraph {
+	JobFunction	function;
+	void*		context;
+	int		count;
+	const int*	dependencyCounts;
+	const int*	firstEdge;
+	const int*	nextEdge;
+	const int*	edgeTo;
+};
+
+class TProcessGraphWorkerPool;
+
+// TProcessGraphWorker is a private class, a pre-spawned helper thread
+// which sleeps until the pool has work for it.
+class TProcessGraphWorker : public QThread
+{
+public:
+	TProcessGraphWorker(TProcessGraphWorkerPool* pool)
+		: m_pool(pool)
+	{
+	}
+
+protected:
+	void run();
+
+private:
+	TProcessGraphWorkerPool* m_pool;
+};
+
+
+// The ready head packs the job generation, node count and the index of the next
+// ready node to hand out in one 64 bit value, so a node can be claimed lock free
+// with a single compare and swap, and claims on an already finished generation fail.
+#define JOB_INDEX_MASK		Q_UINT64_C(0xffff)
+#define JOB_COUNT_SHIFT		16
+#define JOB_GENERATION_SHIFT	32
+
+class TProcessGraphWorkerPool
+{
+public:
+	TProcessGraphWorkerPool(int helperCount)
+	{
+		m_quit = 0;
+		m_generation = 0;
+		m_graph = nullptr;
+		m_readyHead.store(0);
+		m_readyTail.store(0);
+		m_jobsDone.store(0);
+		m_schedGeneration.store(0);
+		m_schedPolicy = 0;
+		m_schedPriority = 0;
+		m_audioThreadKnown = false;
+
+		for (int i=0; i<helperCount; ++i) {
+			TProcessGraphWorker* worker = new TProcessGraphWorker(this);
+			m_workers.append(worker);
+			worker->start(QThread::TimeCriticalPriority);
+		}
+	}
+
+	~TProcessGraphWorkerPool()
+	{
+		m_quit = 1;
+		m_wakeup.release(m_workers.size());
+		foreach(TProcessGraphWorker* worker, m_workers) {
+			worker->wait();
+			delete worker;
+		}
+	}
+
+	int helper_count() const {return m_workers.size();}
+
+	// Called from the audio thread only, runs the nodes of graph on the helper
+	// threads and the calling thread, each one as soon as the nodes it depends
+	// on are done, and returns when all are done.
+	void run_graph(const TJobGraph& graph)
+	{
+		check_audio_thread_scheduling();
+
+		m_graph = &graph;
+		m_jobsDone.store(0);
+
+		int ready = 0;
+		for (int node=0; node<graph.count; ++node) {
+			m_pending[node].store(graph.dependencyCounts[node]);
+			m_ready[node].store(0);
+		}
+		for (int node=0; node<graph.count; ++node) {
+			if (graph.dependencyCounts[node] == 0) {
+				m_ready[ready++].store(node + 1);
+			}
+		}
+		m_readyTail.store(ready);
+
+		++m_generation;
+		m_readyHead.storeRelease((m_generation << JOB_GENERATION_SHIFT) | (quint64(graph.count) << JOB_COUNT_SHIFT));
+
+		int helpers = qMin(graph.count - 1, m_workers.size());
+		if (helpers > 0) {
+			m_wakeup.release(helpers);
+		}
+
+		work_on_jobs();
+
+		// Nodes claimed by a helper are being processed right now, wait for them
+		int spin = 0;
+		while (m_jobsDone.loadAcquire() < graph.count) {
+			if (++spin == 1000) {
+				QThread::yieldCurrentThread();
+				spin = 0;
+			}
+		}
+	}
+
+	void work_on_jobs()
+	{
+		int spin = 0;
+
+		while (true) {
+			quint64 head = m_readyHead.loadAcquire();
+			int index = int(head & JOB_INDEX_MASK);
+			int count = int((head >> JOB_COUNT_SHIFT) & JOB_INDEX_MASK);
+
+			if (index >= count) {
+				return;
+			}
+
+			// Nothing is ready yet, the running nodes will make the rest ready
+			if (index >= m_readyTail.loadAcquire()) {
+				if (++spin == 1000) {
+					QThread::yieldCurrentThread();
+					spin = 0;
+				}
+				continue;
+			}
+
+			if (!m_readyHead.testAndSetOrdered(head, head + 1)) {
+				continue;
+			}
+
+			// The slot is claimed before the node is stored in it
+			int node;
+			while ((node = m_ready[index].loadAcquire()) == 0) {}
+			--node;
+
+			const TJobGraph* graph = m_graph;
+			graph->function(graph->context, node);
+
+			for (int edge = graph->firstEdge[node]; edge != -1; edge = graph->nextEdge[edge]) {
+				int successor = graph->edgeTo[edge];
+				if (m_pending[successor].fetchAndSubOrdered(1) == 1) {
+					m_ready[m_readyTail.fetchAndAddOrdered(1)].storeRelease(successor + 1);
+				}
+			}
+
+			m_jobsDone.fetchAndAddRelease(1);
+			spin = 0;
+		}
+	}
+
+	void wait_for_jobs()
+	{
+		m_wakeup.acquire();
+	}
+
+	// Called from the audio thread, the pool is created before there is one,
+	// and it changes when the audio driver is restarted
+	void check_audio_thread_scheduling()
+	{
+#if defined (Q_OS_UNIX) || defined (Q_OS_MAC)
+		pthread_t self = pthread_self();
+		if (m_audioThreadKnown && pthread_equal(self, m_audioThread)) {
+			return;
+		}
+
+		m_audioThread = self;
+		m_audioThreadKnown = true;
+
+		int policy;
+		struct sched_param param;
+		if (pthread_getschedparam (self, &policy, &param) == 0) {
+			m_schedPolicy = policy;
+			m_schedPriority = param.sched_priority;
+			m_schedGeneration.fetchAndAddRelease(1);
+		}
+#endif
+	}
+
+	// Called from the helper threads, gives them the scheduling policy and
+	// priority of the audio thread if it changed since generation
+	void follow_audio_thread_scheduling(int& generation)
+	{
+#if defined (Q_OS_UNIX) || defined (Q_OS_MAC)
+		int current = m_schedGeneration.loadAcquire();
+		if (current == generation) {
+			return;
+		}
+		generation = current;
+
+		struct sched_param param;
+		param.sched_priority = m_schedPriority;
+		if (pthread_setschedparam (pthread_self(), m_schedPolicy, &param) != 0) {
+			printf("TProcessGraphWorker: Unable to run with the priority of the audio thread\n");
+		}
+#else
+		Q_UNUSED(generation);
+#endif
+	}
+
+	bool quit() const {return m_quit;}
+
+private:
+	QList<TProcessGraphWorker*>	m_workers;
+	QSemaphore			m_wakeup;
+	// the nodes which are ready to run, in the order they became ready
+	QAtomicInt			m_ready[TProcessGraph::MAX_NODES];
+	// the amount of dependencies each node still waits for
+	QAtomicInt			m_pending[TProcessGraph::MAX_NODES];
+	QAtomicInteger<quint64>		m_readyHead;
+	QAtomicInt			m_readyTail;
+	QAtomicInt			m_jobsDone;
+	const TJobGraph*		m_graph;
+	quint64				m_generation;
+	volatile int			m_quit;
+	// the scheduling of the audio thread, for the helper threads to follow
+	QAtomicInt			m_schedGeneration;
+	int				m_schedPolicy;
+	int				m_schedPriority;
+	bool				m_audioThreadKnown;
+#if defined (Q_OS_UNIX) || defined (Q_OS_MAC)
+	pthread_t			m_audioThread;
+#endif
+};
+
+
+void TProcessGraphWorker::run()
+{
+	int schedGeneration = 0;
+
+	while (true) {
+		m_pool->wait_for_jobs();
+
+		if (m_pool->quit()) {
+			break;
+		}
+
+		// Run at the same priority as the audio thread, we do it's work after all
+		m_pool->follow_audio_thread_scheduling(schedGeneration);
+
+		m_pool->work_on_jobs();
+	}
+}
+
+
+// All Sheets share one pool, only one of them is processed at a time
+static TProcessGraphWorkerPool* workerPool = nullptr;
+static int workerPoolRefCount = 0;
+
+
+TProcessGraph::TProcessGraph()
+{
+	m_trackCount = 0;
+	m_receiverCount = 0;
+	m_busTrackCount = 0;
+	m_edgeCount = 0;
+	m_sendEdgeCount = 0;
+	m_nframes = 0;
+
+	if (workerPoolRefCount++ == 0) {
+		// A value of 0 (the default) means: use all cores, 1 disables parallel processing
+		int threadCount = config().get_property("Hardware", "audioprocessingthreads", 0).toInt();
+		if (threadCount <= 0) {
+			threadCount = QThread::idealThreadCount();
+		}
+		workerPool = new TProcessGraphWorkerPool(qMax(0, threadCount - 1));
+	}
+}
+
+TProcessGraph::~TProcessGraph()
+{
+	if (--workerPoolRefCount == 0) {
+		delete workerPool;
+		workerPool = nullptr;
+	}
+}
+
+//
+//  Function called in RealTime AudioThread processing path
+//
+int TProcessGraph::process(APILinkedList& audioTracks, APILinkedList& busTracks, nframes_t nframes)
+{
+	int processResult = 0;
+
+	if (!workerPool || workerPool->helper_count() == 0 || audioTracks.size() + busTracks.size() < 2 ||
+	    !build(audioTracks, busTracks)) {
+		apill_foreach(AudioTrack* track, AudioTrack*, audioTracks) {
+			processResult |= track->process(nframes);
+		}
+		apill_foreach(TBusTrack* busTrack, TBusTrack*, busTracks) {
+			busTrack->process(nframes);
+		}
+		return processResult;
+	}
+
+	m_nframes = nframes;
+
+	TJobGraph graph;
+	graph.function = run_node;
+	graph.context = this;
+	graph.count = m_trackCount + m_receiverCount + m_busTrackCount;
+	graph.dependencyCounts = m_dependencyCounts;
+	graph.firstEdge = m_firstEdge;
+	graph.nextEdge = m_nextEdge;
+	graph.edgeTo = m_edgeTo;
+
+	workerPool->run_graph(graph);
+
+	for (int i=0; i<m_trackCount; ++i) {
+		processResult |= m_results[i];
+	}
+
+	return processResult;
+}
+
+// Compiles the routing of the Tracks into the graph, the AudioTrack nodes come
+// first, then the receiving buses and then the bus tracks. Returns false if the
+// graph doesn't fit, the Tracks are processed serially then.
+bool TProcessGraph::build(APILinkedList& audioTracks, APILinkedList& busTracks)
+{
+	AudioBus* buses[MAX_SENDS];
+
+	m_trackCount = 0;
+	m_receiverCount = 0;
+	m_busTrackCount = 0;
+	m_edgeCount = 0;
+
+	apill_foreach(AudioTrack* track, AudioTrack*, audioTracks) {
+		if (m_trackCount == MAX_NODES) {
+			return false;
+		}
+		int node = m_trackCount++;
+		m_tracks[node] = track;
+
+		int count = track->collect_send_buses(buses, 0, MAX_SENDS);
+		if (count < 0) {
+			return false;
+		}
+
+		for (int i=0; i<count; ++i) {
+			int receiver = find_receiver(buses[i]);
+			if (receiver == -1) {
+				if (m_receiverCount == MAX_NODES) {
+					return false;
+				}
+				receiver = m_receiverCount++;
+				m_receivers[receiver] = buses[i];
+			}
+			// Renumbered to the receiver node below
+			if (!add_edge(node, receiver)) {
+				return false;
+			}
+		}
+	}
+
+	for (int edge=0; edge<m_edgeCount; ++edge) {
+		m_edgeTo[edge] += m_trackCount;
+	}
+	m_sendEdgeCount = m_edgeCount;
+
+	int firstBusNode = m_trackCount + m_receiverCount;
+	if (firstBusNode > MAX_NODES) {
+		return false;
+	}
+
+	m_touchedOffsets[0] = 0;
+
+	apill_foreach(TBusTrack* busTrack, TBusTrack*, busTracks) {
+		if (firstBusNode + m_busTrackCount == MAX_NODES) {
+			return false;
+		}
+		int index = m_busTrackCount++;
+		int node = firstBusNode + index;
+		m_busTracks[index] = busTrack;
+
+		AudioBus** touched = m_touchedBuses + m_touchedOffsets[index];
+		int room = MAX_EDGES - m_touchedOffsets[index];
+		if (room < 1) {
+			return false;
+		}
+		touched[0] = busTrack->get_process_bus();
+		int count = busTrack->collect_send_buses(touched, 1, room);
+		if (count < 0) {
+			return false;
+		}
+		m_touchedOffsets[index + 1] = m_touchedOffsets[index] + count;
+
+		// After the AudioTrack sends into any of the buses it touches
+		for (int i=0; i<count; ++i) {
+			int receiver = find_receiver(touched[i]);
+			if (receiver != -1 && !add_edge(m_trackCount + receiver, node)) {
+				return false;
+			}
+		}
+
+		// and after the bus tracks before it touching any of them
+		for (int other=0; other<index; ++other) {
+			if (buses_overlap(index, other) && !add_edge(firstBusNode + other, node)) {
+				return false;
+			}
+		}
+	}
+
+	int nodeCount = firstBusNode + m_busTrackCount;
+	for (int node=0; node<nodeCount; ++node) {
+		m_firstEdge[node] = -1;
+		m_dependencyCounts[node] = 0;
+	}
+	for (int edge=m_edgeCount-1; edge>=0; --edge) {
+		m_nextEdge[edge] = m_firstEdge[m_edgeFrom[edge]];
+		m_firstEdge[m_edgeFrom[edge]] = edge;
+		m_dependencyCounts[m_edgeTo[edge]]++;
+	}
+
+	return true;
+}
+
+bool TProcessGraph::add_edge(int from, int to)
+{
+	if (m_edgeCount == MAX_EDGES) {
+		return false;
+	}
+
+	m_edgeFrom[m_edgeCount] = from;
+	m_edgeTo[m_edgeCount] = to;
+	m_edgeCount++;
+
+	return true;
+}
+
+int TProcessGraph::find_receiver(AudioBus* bus) const
+{
+	for (int i=0; i<m_receiverCount; ++i) {
+		if (m_receivers[i] == bus) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+bool TProcessGraph::buses_overlap(int busTrack, int otherBusTrack) const
+{
+	for (int i=m_touchedOffsets[busTrack]; i<m_touchedOffsets[busTrack + 1]; ++i) {
+		for (int j=m_touchedOffsets[otherBusTrack]; j<m_touchedOffsets[otherBusTrack + 1]; ++j) {
+			if (m_touchedBuses[i] == m_touchedBuses[j]) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+void TProcessGraph::run_node(void* graph, int node)
+{
+	TProcessGraph* self = static_cast<TProcessGraph*>(graph);
+
+	if (node < self->m_trackCount) {
+		self->m_results[node] = self->m_tracks[node]->render(self->m_nframes);
+		return;
+	}
+
+	if (node < self->m_trackCount + self->m_receiverCount) {
+		AudioBus* receiver = self->m_receivers[node - self->m_trackCount];
+
+		// The edges into the receiver are in Track order
+		for (int edge=0; edge<self->m_sendEdgeCount; ++edge) {
+			if (self->m_edgeTo[edge] == node) {
+				self->m_tracks[self->m_edgeFrom[edge]]->mix_sends_into(receiver, self->m_nframes);
+			}
+		}
+		return;
+	}
+
+	self->m_busTracks[node - self->m_trackCount - self->m_receiverCount]->process(self->m_nframes);
+}
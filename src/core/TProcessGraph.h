@@ -0,0 +1,86 @@
+/*
+Copyright (C) 2026 The Traverso developers
+
+This file is part of Traverso
+
+Traverso is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.
+
+*/
+
+#ifndef TPROCESSGRAPH_H
+#define TPROCESSGRAPH_H
+
+#include "defines.h"
+
+class APILinkedList;
+class AudioBus;
+class AudioTrack;
+class TBusTrack;
+
+/**
+ * Processes the Tracks of a Sheet in parallel, using a pool of (realtime)
+ * helper threads next to the audio thread.
+ *
+ * Each cycle the routing is compiled into a dependency graph, with a node
+ * for every AudioTrack rendering into it's own process bus, one for every
+ * bus receiving sends of the AudioTracks, mixing them in, and one for every
+ * TBusTrack. A bus track runs once the nodes before it in the serial order
+ * which touch it's process bus or the buses it sends to are done. So each
+ * bus gets it's contributions in the same order as the serial path, and the
+ * result is bit identical to it. Nodes are run by whichever thread is idle
+ * as soon as they are ready.
+ */
+class TProcessGraph
+{
+public:
+	TProcessGraph();
+	~TProcessGraph();
+
+	int process(APILinkedList& audioTracks, APILinkedList& busTracks, nframes_t nframes);
+
+	static const int MAX_NODES = 2048;
+
+private:
+	static const int MAX_EDGES = 8192;
+	static const int MAX_SENDS = 64;
+
+	AudioTrack*	m_tracks[MAX_NODES];
+	AudioBus*	m_receivers[MAX_NODES];
+	TBusTrack*	m_busTracks[MAX_NODES];
+	// the buses each bus track reads or writes, starting with it's process bus
+	AudioBus*	m_touchedBuses[MAX_EDGES];
+	int		m_touchedOffsets[MAX_NODES + 1];
+	int		m_edgeFrom[MAX_EDGES];
+	int		m_edgeTo[MAX_EDGES];
+	int		m_nextEdge[MAX_EDGES];
+	int		m_firstEdge[MAX_NODES];
+	int		m_dependencyCounts[MAX_NODES];
+	int		m_results[MAX_NODES];
+	int		m_trackCount;
+	int		m_receiverCount;
+	int		m_busTrackCount;
+	int		m_edgeCount;
+	int		m_sendEdgeCount;
+	nframes_t	m_nframes;
+
+	bool build(APILinkedList& audioTracks, APILinkedList& busTracks);
+	bool add_edge(int from, int to);
+	int find_receiver(AudioBus* bus) const;
+	bool buses_overlap(int busTrack, int otherBusTrack) const;
+
+	static void run_node(void* graph, int node);
+};
+
+#endif
@@ -49,6 +49,7 @@ void TSend::init()
         m_type = POSTSEND;
         m_gain = 1.0;
         m_pan = 0.0;
+        m_processedGain[0] = m_processedGain[1] = -1.0f;
 }
 
 QDomNode TSend::get_state( QDomDocument doc)
@@ -59,6 +59,12 @@ public:
         float get_pan() const {return m_pan;}
         float get_gain() const {return m_gain;}
 
+        // The gain factor a channel was mixed with in the previous cycle, so
+        // a gain or pan change can be ramped to instead of jumped to.
+        // Negative when the channel was not mixed yet.
+        float get_processed_gain(int channel) const {return m_processedGain[channel];}
+        void set_processed_gain(int channel, float gain) {m_processedGain[channel] = gain;}
+
 
         bool is_smaller_then(APILinkedListNode* node) {return true;}
 
@@ -69,6 +75,7 @@ private:
         int             m_type{};
         float           m_gain{};
         float           m_pan{};
+        float           m_processedGain[2];
 
         void init();
 };
@@ -483,6 +483,9 @@ void TSession::private_add_track(Track* track)
 {
 	switch (track->get_type()) {
 	case Track::AUDIOTRACK:
+		// The buffer arena may have moved it's buffers while the track was
+		// removed (and kept for undo), so fetch them again
+		qobject_cast<AudioTrack*>(track)->update_render_buffers();
 		m_rtAudioTracks.append(track);
 		break;
 	case Track::BUS:
@@ -438,19 +438,54 @@ void Track::add_input_bus(const QString &name)
 
 void Track::process_post_sends(nframes_t nframes)
 {
-        apill_foreach(TSend* postSend, TSend*, m_postSends) {
-                process_send(postSend, nframes);
-        }
+        process_sends(m_postSends, m_processBus, nullptr, nframes);
 }
 
 void Track::process_pre_sends(nframes_t nframes)
 {
-        apill_foreach(TSend* preSend, TSend*, m_preSends) {
-                process_send(preSend, nframes);
+        process_sends(m_preSends, m_processBus, nullptr, nframes);
+}
+
+// Mixes sender into the buses of sends, or only into receiver if it's not 0
+void Track::process_sends(APILinkedList& sends, AudioBus* sender, AudioBus* receiver, nframes_t nframes)
+{
+        apill_foreach(TSend* send, TSend*, sends) {
+                if (receiver && send->get_bus() != receiver) {
+                        continue;
+                }
+                process_send(send, sender, nframes);
         }
 }
 
-void Track::process_send(TSend *send, nframes_t nframes)
+/**
+ *	Appends the buses this Track sends to, and which are not in \a buses yet.
+ * @return The new amount of buses, or -1 if more then \a maxCount buses were found
+ */
+int Track::collect_send_buses(AudioBus** buses, int count, int maxCount)
+{
+        APILinkedList* lists[2] = {&m_preSends, &m_postSends};
+
+        for (int l=0; l<2; ++l) {
+                apill_foreach(TSend* send, TSend*, (*lists[l])) {
+                        AudioBus* bus = send->get_bus();
+                        int i = 0;
+                        while (i < count && buses[i] != bus) {
+                                ++i;
+                        }
+                        if (i < count) {
+                                continue;
+                        }
+                        if (count == maxCount) {
+                                return -1;
+                        }
+                        buses[count++] = bus;
+                }
+        }
+
+        return count;
+}
+
+void Track::process_send(TSend *send, AudioBus* senderBus, nframes_t nframes)
 {
         AudioChannel* sender;
         AudioChannel* receiver;
@@ -458,8 +493,8 @@ void Track::process_send(TSend *send, nframes_t nframes)
         float panFactor;
 
         AudioBus* receiverBus = send->get_bus();
-        for (int i=0; i<m_processBus->get_channel_count(); i++) {
-                sender = m_processBus->get_channel(i);
+        for (int i=0; i<senderBus->get_channel_count(); i++) {
+                sender = senderBus->get_channel(i);
                 receiver = receiverBus->get_channel(i);
                 if (sender && receiver) {
                         panFactor = 1.0f;
@@ -474,7 +509,15 @@ void Track::process_send(TSend *send, nframes_t nframes)
 
                         gainFactor = panFactor * send->get_gain();
 
-                        if (gainFactor == 1.0f) {
+                        // Ramp to a changed gain over this cycle to avoid zipper noise
+                        float previousGain = (i < 2) ? send->get_processed_gain(i) : gainFactor;
+                        if (i < 2) {
+                                send->set_processed_gain(i, gainFactor);
+                        }
+
+                        if (previousGain >= 0.0f && previousGain != gainFactor) {
+                                Mixer::mix_buffers_with_gain_ramp(receiver->get_buffer(nframes), sender->get_buffer(nframes), nframes, previousGain, gainFactor);
+                        } else if (gainFactor == 1.0f) {
                                 Mixer::mix_buffers_no_gain(receiver->get_buffer(nframes), sender->get_buffer(nframes), nframes);
                         } else {
                                 Mixer::mix_buffers_with_gain(receiver->get_buffer(nframes), sender->get_buffer(nframes), nframes, gainFactor);
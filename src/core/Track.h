@@ -85,6 +85,8 @@ public:
         TSend* get_send(qint64 sendId);
         virtual void add_input_bus(AudioBus* bus);
 
+        int collect_send_buses(AudioBus** buses, int count, int maxCount);
+
 
 protected:
         VUMonitors      m_vumonitors;
@@ -104,10 +106,11 @@ protected:
 
         void process_post_sends(nframes_t nframes);
         void process_pre_sends(nframes_t nframes);
+        void process_sends(APILinkedList& sends, AudioBus* sender, AudioBus* receiver, nframes_t nframes);
         void remove_input_bus(AudioBus* bus);
 
 private:
-        void process_send(TSend* send, nframes_t nframes);
+        void process_send(TSend* send, AudioBus* sender, nframes_t nframes);
 
 public slots:
         TCommand* solo();
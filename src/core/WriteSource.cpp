@@ -23,6 +23,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.
 
 #include "Export.h"
 #include <math.h>
+#include <QVarLengthArray>
 
 #include "AudioBus.h"
 #include <AudioDevice.h>
@@ -31,6 +32,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.
 #include "Peak.h"
 #include "Utils.h"
 #include "DiskIO.h"
+#include "Mixer.h"
 
 // Always put me below _all_ includes, this is needed
 // in case we run with memory leak detection enabled!
@@ -53,8 +55,8 @@ WriteSource::~WriteSource()
 		delete m_peak;
 	}
 	
-	for(int i=0; i<m_buffers.size(); ++i) {
-		delete m_buffers.at(i);
+	if (m_buffer) {
+		delete m_buffer;
 	}
 	
 	if (m_spec->isRecording) {
@@ -63,14 +65,25 @@ WriteSource::~WriteSource()
 	if (m_writer) {
 		delete m_writer;
 	}
+
+	delete [] m_interleaveAllocation;
 }
 
 int WriteSource::process (nframes_t nframes)
+{
+	uint rate = audiodevice().get_sample_rate();
+	bool endOfInput = (m_spec->pos + TimeRef(nframes, rate)) >= m_spec->endLocation;
+
+	return process(m_spec->dataF, nframes, endOfInput);
+}
+
+// Resamples, dithers and writes nframes interleaved frames of data. Clipping
+// is done in place. Called from the ExportEncoder thread when pipelined.
+int WriteSource::process (audio_sample_t* data, nframes_t nframes, bool endOfInput)
 {
     float* float_buffer = nullptr;
     uint chn;
 	uint32_t x;
-	uint32_t i;
 	nframes_t written;
 	nframes_t to_write = 0;
 	int cnt = 0;
@@ -88,8 +101,7 @@ int WriteSource::process (nframes_t nframes)
 			int err;
 
 			m_src_data.output_frames = m_out_samples_max / m_channelCount;
-            uint rate = audiodevice().get_sample_rate();
-			m_src_data.end_of_input = (m_spec->pos + TimeRef(nframes, rate)) >= m_spec->endLocation;
+			m_src_data.end_of_input = endOfInput;
 			m_src_data.data_out = m_dataF2;
 
 			if (m_leftover_frames > 0) {
@@ -102,7 +114,7 @@ int WriteSource::process (nframes_t nframes)
 
 					/* first time, append new data from dataF into the m_leftoverF buffer */
 
-					memcpy (m_leftoverF + (m_leftover_frames * m_channelCount), m_spec->dataF, nframes * m_channelCount * sizeof(float));
+					memcpy (m_leftoverF + (m_leftover_frames * m_channelCount), data, nframes * m_channelCount * sizeof(float));
 					m_src_data.input_frames = nframes + m_leftover_frames;
 				} else {
 
@@ -115,7 +127,7 @@ int WriteSource::process (nframes_t nframes)
 				}
 			} else {
 
-				m_src_data.data_in = m_spec->dataF;
+				m_src_data.data_in = data;
 				m_src_data.input_frames = nframes;
 
 			}
@@ -147,7 +159,7 @@ int WriteSource::process (nframes_t nframes)
 
 			to_write = nframes;
 			m_leftover_frames = 0;
-			float_buffer = m_spec->dataF;
+			float_buffer = data;
 		}
 
 		if (m_output_data) {
@@ -166,28 +178,7 @@ int WriteSource::process (nframes_t nframes)
 			break;
 
 		case 32:
-			for (chn = 0; chn < m_channelCount; ++chn) {
-
-                int *ob = static_cast<int *>(m_output_data);
-                const double int_max = double(INT_MAX);
-                const double int_min = double(INT_MIN);
-
-				for (x = 0; x < to_write; ++x) {
-					i = chn + (x * m_channelCount);
-
-					if (float_buffer[i] > 1.0f) {
-						ob[i] = INT_MAX;
-					} else if (float_buffer[i] < -1.0f) {
-						ob[i] = INT_MIN;
-					} else {
-						if (float_buffer[i] >= 0.0f) {
-							ob[i] = lrintf (int_max * float_buffer[i]);
-						} else {
-							ob[i] = - lrintf (int_min * float_buffer[i]);
-						}
-					}
-				}
-			}
+			Mixer::convert_to_int32(static_cast<int *>(m_output_data), float_buffer, to_write * m_channelCount, 32);
 			/* and export to disk */
 			written = m_writer->write(m_output_data, to_write);
 			break;
@@ -376,13 +367,22 @@ int WriteSource::rb_write(AudioBus* bus, nframes_t nframes)
                 return 0;
         }
 
-	int written = 0;
+	QVarLengthArray<audio_sample_t*, 8> src(m_channelCount);
 	
-        for (int i= int(m_channelCount-1); i>=0; --i) {
-                AudioChannel* chan = bus->get_channel(uint(i));
-                if (chan) {
-                        written = m_buffers.at(i)->write(chan->get_buffer(nframes), nframes);
+        for (uint i=0; i<m_channelCount; ++i) {
+                AudioChannel* chan = bus->get_channel(i);
+                if (!chan) {
+                        return 0;
                 }
+                src[i] = chan->get_buffer(nframes);
+	}
+	
+	// All channels share the write pointer, publish them at once
+	int written = m_buffer->write(src.data(), nframes);
+	
+	// Let the disk thread write out our buffers right away
+	if (m_diskio && m_buffer->read_space() >= m_wakeupWatermark) {
+		m_diskio->wakeup_write_thread();
 	}
 	
 	return written;
@@ -412,57 +412,73 @@ void WriteSource::set_process_peaks( bool process )
 
 int WriteSource::rb_file_write(nframes_t cnt)
 {
-	uint read = 0;
-    uint chan;
-	
-    // FIXME make it support any channel count, not just some high enough number?
-    audio_sample_t* readbuffer[6];
-	
-	for (chan=0; chan<m_channelCount; ++chan) {
-		
-		readbuffer[chan] = new audio_sample_t[cnt * m_channelCount];
+	MultiChannelRingBuffer<audio_sample_t>::rw_vector vec;
+	m_buffer->get_read_vector(&vec);
 
-		read = m_buffers.at(chan)->read(readbuffer[chan], cnt);
-		
-		if (read != cnt) {
-			printf("WriteSource::rb_file_write() : could only process %d frames, %d were requested!\n", read, cnt);
-		}
-		
-		m_peak->process(chan, readbuffer[chan], read);
+	nframes_t available = nframes_t(vec.len[0] + vec.len[1]);
+
+	if (available < cnt) {
+		printf("WriteSource::rb_file_write() : could only process %d frames, %d were requested!\n", available, cnt);
+		cnt = available;
 	}
 
-	if (read > 0) {
-		if (m_channelCount == 1) {
-			m_spec->dataF = readbuffer[0];
-		} else {
-			// Interlace data into dataF buffer!
-			for (uint f=0; f<read; f++) {
-				for (chan = 0; chan < m_channelCount; chan++) {
-					m_spec->dataF[f * m_channelCount + chan] = readbuffer[chan][f];
+	if (cnt == 0) {
+		return 0;
+	}
+
+	// Peak and interleave straight from the ring buffer, which holds the
+	// data in at most 2 parts
+	nframes_t done = 0;
+
+	for (int part = 0; part < 2 && done < cnt; ++part) {
+		nframes_t count = qMin(nframes_t(vec.len[part]), cnt - done);
+		audio_sample_t* dest = m_interleaveBuffer + done * m_channelCount;
+
+		for (uint chan = 0; chan < m_channelCount; ++chan) {
+			audio_sample_t* src = m_buffer->channel_buffer(chan) + vec.offset[part];
+
+			if (m_peak) {
+				m_peak->process(chan, src, count);
+			}
+
+			if (m_channelCount == 1) {
+				memcpy(dest, src, count * sizeof(audio_sample_t));
+			} else if (m_channelCount > 2) {
+				for (nframes_t f = 0; f < count; ++f) {
+					dest[f * m_channelCount + chan] = src[f];
 				}
 			}
 		}
-		
-		process(read);
-	}
-	
-	for (chan=0; chan<m_channelCount; ++chan) {
-		delete [] readbuffer[chan];
-        readbuffer[chan] = nullptr;
+
+		if (m_channelCount == 2) {
+			Mixer::interleave_stereo(dest, m_buffer->channel_buffer(0) + vec.offset[part],
+						 m_buffer->channel_buffer(1) + vec.offset[part], count);
+		}
+
+		done += count;
 	}
-	
-    return int(read);
+
+	m_buffer->increment_read_ptr(cnt);
+
+	m_spec->dataF = m_interleaveBuffer;
+	process(cnt);
+
+	return int(cnt);
 }
 
 void WriteSource::set_recording(bool rec )
 {
 	m_isRecording = rec;
+	
+	// Remaining samples are written on the next disk thread cycle
+	if (!m_isRecording && m_diskio) {
+		m_diskio->wakeup_write_thread();
+	}
 }
 
-void WriteSource::process_ringbuffer(audio_sample_t* buffer)
+void WriteSource::process_ringbuffer()
 {
-	m_spec->dataF = buffer;
-	int readSpace = m_buffers.at(0)->read_space();
+	int readSpace = m_buffer->read_space();
 
 	if (! m_isRecording ) {
 		PMESG("Writing remaining  (%d) samples to ringbuffer", readSpace);
@@ -478,9 +494,14 @@ void WriteSource::prepare_rt_buffers( )
 {
 	m_bufferSize = m_sampleRate * DiskIO::writebuffertime;
 	m_chunkSize = m_bufferSize / DiskIO::bufferdividefactor;
-	for (int i=0; i<m_channelCount; ++i) {
-		m_buffers.append(new RingBufferNPT<audio_sample_t>(m_bufferSize));
-	}
+	// DiskIO processes our buffers in chunks, waking it up for less is useless
+	m_wakeupWatermark = qMax(DiskIO::get_wakeup_watermark(m_bufferSize), m_chunkSize);
+	m_buffer = new MultiChannelRingBuffer<audio_sample_t>(m_channelCount, m_bufferSize);
+
+	// rb_file_write() interleaves at most a full ring buffer at once
+	delete [] m_interleaveAllocation;
+	m_interleaveAllocation = new char[m_bufferSize * m_channelCount * sizeof(audio_sample_t) + MCRB_CACHE_LINE_SIZE];
+	m_interleaveBuffer = (audio_sample_t*) (((uintptr_t) m_interleaveAllocation + MCRB_CACHE_LINE_SIZE - 1) & ~uintptr_t(MCRB_CACHE_LINE_SIZE - 1));
 }
 
 void WriteSource::set_diskio( DiskIO * io )
@@ -44,13 +44,14 @@ public :
 
         int rb_write(AudioBus* bus, nframes_t nframes);
 	int rb_file_write(nframes_t cnt);
-	void process_ringbuffer(audio_sample_t* buffer);
+	void process_ringbuffer();
 	int get_processable_buffer_space() const;
 	int get_chunck_size() const {return m_chunkSize;}
 	int get_buffer_size() const {return m_bufferSize;}
 	Peak* get_peak() {return m_peak;}
 
 	int process(nframes_t nframes);
+	int process(audio_sample_t* data, nframes_t nframes, bool endOfInput);
 	
 	int prepare_export();
 	int finish_export();
@@ -82,6 +83,10 @@ private:
 	float*		m_leftoverF{};
 	float*		m_dataF2{};
 	void*           m_output_data{};
+
+	// Cache line aligned buffer rb_file_write() interleaves into
+	char*		m_interleaveAllocation{};
+	audio_sample_t*	m_interleaveBuffer{};
 	
 	
 	void prepare_rt_buffers();
@@ -93,7 +98,7 @@ signals:
 
 inline int WriteSource::get_processable_buffer_space( ) const
 {
-	return m_buffers.at(0)->read_space();
+	return m_buffer->read_space();
 }
 
 inline bool WriteSource::is_recording( ) const
@@ -52,6 +52,8 @@ AudioChannel::AudioChannel(const QString& name, uint channelNumber, int type, qi
         m_monitoring = true;
         m_bufferSize = 0;
         m_buffer = QVarLengthArray<audio_sample_t>(2048);
+        m_data = m_buffer.data();
+        m_dataSize = nframes_t(m_buffer.size());
         mlocked = false;
         m_latency = 0;
         if (id == 0) {
@@ -92,6 +94,9 @@ void AudioChannel::set_buffer_size( nframes_t size )
 
         m_buffer.resize(int(size));
         m_bufferSize = size;
+        // This also drops an external buffer, it's owner has to set a new one if needed
+        m_data = m_buffer.data();
+        m_dataSize = size;
         silence_buffer(size);
 
 
@@ -104,11 +109,24 @@ void AudioChannel::set_buffer_size( nframes_t size )
 }
 
 
+/**
+ * Let this AudioChannel use \a buffer instead of it's own buffer, e.g. a buffer
+ * from an arena. \a buffer has to stay valid until set_buffer_size() or
+ * set_external_buffer() is called again, or the AudioChannel is deleted.
+ */
+void AudioChannel::set_external_buffer(audio_sample_t* buffer, nframes_t size)
+{
+        m_data = buffer;
+        m_dataSize = size;
+        m_bufferSize = size;
+        silence_buffer(size);
+}
+
 void AudioChannel::process_monitoring(VUMonitor* monitor)
 {
         Q_ASSERT(m_bufferSize > 0);
         float peakValue = 0;
-        peakValue = Mixer::compute_peak( m_buffer.data(), m_bufferSize, peakValue );
+        peakValue = Mixer::compute_peak( m_data, m_bufferSize, peakValue );
 
         if (monitor) {
                 monitor->process(peakValue);
@@ -149,7 +167,7 @@ void AudioChannel::remove_monitor(VUMonitor *monitor)
 
 void AudioChannel::read_from_hardware_port(audio_sample_t *buf, nframes_t nframes)
 {
-        memcpy (m_buffer.data(), buf, sizeof(audio_sample_t) * nframes);
+        memcpy (m_data, buf, sizeof(audio_sample_t) * nframes);
         if (m_monitoring) {
                 process_monitoring();
 //                audiodevice().send_to_master_out(this, m_bufferSize);
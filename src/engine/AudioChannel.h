@@ -73,18 +73,19 @@ public:
     ~AudioChannel();
 
     inline audio_sample_t* get_buffer(nframes_t nframes) {
-        Q_ASSERT(int(nframes) <= m_buffer.size());
-        return m_buffer.data();
+        Q_ASSERT(nframes <= m_dataSize);
+        return m_data;
     }
 
     void set_latency(unsigned int latency);
 
     inline void silence_buffer(nframes_t nframes) {
-        Q_ASSERT(int(nframes) <= m_buffer.size());
-        memset (m_buffer.data(), 0, sizeof (audio_sample_t) * nframes);
+        Q_ASSERT(nframes <= m_dataSize);
+        memset (m_data, 0, sizeof (audio_sample_t) * nframes);
     }
 
     void set_buffer_size(nframes_t size);
+    void set_external_buffer(audio_sample_t* buffer, nframes_t size);
     void set_monitoring(bool monitor);
     void process_monitoring(VUMonitor* monitor=nullptr);
 
@@ -100,6 +101,9 @@ public:
 private:
     APILinkedList           m_monitors;
     QVarLengthArray<audio_sample_t>     m_buffer;
+    // Either m_buffer's data, or a buffer owned by someone else
+    audio_sample_t*         m_data;
+    nframes_t               m_dataSize;
     uint 			m_bufferSize;
     uint 			m_latency;
     uint 			m_number;
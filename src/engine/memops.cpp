@@ -32,12 +32,17 @@
 #include <climits>
 
 #include <memops.h> 
+#include "Mixer.h"
 
 #define SAMPLE_MAX_24BIT  8388608.0f
 #define SAMPLE_MAX_16BIT  32768.0f
 
 #define f_round(f) lrintf(f)
 
+// The plain (not dithered, native byte order) conversions use the Mixer
+// kernels on chunks of this many samples, and store them with dst_skip
+#define CONVERT_CHUNK 256
+
 
 inline unsigned int fast_rand() {
 	static unsigned int seed = 22222;
@@ -81,19 +86,24 @@ void sample_move_d32u24_sSs (char *dst, audio_sample_t *src, unsigned long nsamp
 void sample_move_d32u24_sS (char *dst, audio_sample_t *src, unsigned long nsamples, unsigned long dst_skip, dither_state_t*)
 
 {
-        long long y;
+	int tmp[CONVERT_CHUNK];
 
-	while (nsamples--) {
-		y = (long long)(*src * SAMPLE_MAX_24BIT) << 8;
-		if (y > INT_MAX) {
-			*((int *) dst) = INT_MAX;
-		} else if (y < INT_MIN) {
-			*((int *) dst) = INT_MIN;
+	while (nsamples) {
+		unsigned long count = nsamples < CONVERT_CHUNK ? nsamples : CONVERT_CHUNK;
+
+		if (dst_skip == sizeof(int)) {
+			Mixer::convert_to_int32((int *) dst, src, count, 24);
+			dst += count * dst_skip;
 		} else {
-			*((int *) dst) = (int)y;
+			Mixer::convert_to_int32(tmp, src, count, 24);
+			for (unsigned long i = 0; i < count; ++i) {
+				*((int *) dst) = tmp[i];
+				dst += dst_skip;
+			}
 		}
-		dst += dst_skip;
-		src++;
+
+		src += count;
+		nsamples -= count;
 	}
 }	
 
@@ -381,23 +391,25 @@ void sample_move_dither_shaped_d32u24_sSs (char *dst,  audio_sample_t *src, unsi
 void sample_move_d24_sS (char *dst, audio_sample_t *src, unsigned long nsamples, unsigned long dst_skip, dither_state_t *)
 
 {
-        long long y;
+	int tmp[CONVERT_CHUNK];
 
-	while (nsamples--) {
-		y = (long long)(*src * SAMPLE_MAX_24BIT);
+	while (nsamples) {
+		unsigned long count = nsamples < CONVERT_CHUNK ? nsamples : CONVERT_CHUNK;
 
-		if (y > (INT_MAX >> 8 )) {
-			y = (INT_MAX >> 8);
-		} else if (y < (INT_MIN >> 8 )) {
-			y = (INT_MIN >> 8 );
-		}
+		Mixer::convert_to_int32(tmp, src, count, 24);
+
+		for (unsigned long i = 0; i < count; ++i) {
+			int y = tmp[i] >> 8;
 #if __BYTE_ORDER == __LITTLE_ENDIAN
-		memcpy (dst, &y, 3);
+			memcpy (dst, &y, 3);
 #elif __BYTE_ORDER == __BIG_ENDIAN
-		memcpy (dst, (char *)&y + 5, 3);
+			memcpy (dst, (char *)&y + 1, 3);
 #endif
-		dst += dst_skip;
-		src++;
+			dst += dst_skip;
+		}
+
+		src += count;
+		nsamples -= count;
 	}
 }	
 
@@ -737,21 +749,24 @@ void sample_move_dither_shaped_d24_sSs (char *dst,  audio_sample_t *src, unsigne
 void sample_move_d16_sS (char *dst,  audio_sample_t *src, unsigned long nsamples, unsigned long dst_skip, dither_state_t* )
 	
 {
-	int tmp;
+	short tmp[CONVERT_CHUNK];
 
-	/* ALERT: signed sign-extension portability !!! */
+	while (nsamples) {
+		unsigned long count = nsamples < CONVERT_CHUNK ? nsamples : CONVERT_CHUNK;
 
-	while (nsamples--) {
-		tmp = f_round(*src * SAMPLE_MAX_16BIT);
-		if (tmp > SHRT_MAX) {
-			*((short *)dst) = SHRT_MAX;
-		} else if (tmp < SHRT_MIN) {
-			*((short *)dst) = SHRT_MIN;
+		if (dst_skip == sizeof(short)) {
+			Mixer::convert_to_int16((short *) dst, src, count);
+			dst += count * dst_skip;
 		} else {
-			*((short *) dst) = (short) tmp;
+			Mixer::convert_to_int16(tmp, src, count);
+			for (unsigned long i = 0; i < count; ++i) {
+				*((short *) dst) = tmp[i];
+				dst += dst_skip;
+			}
 		}
-		dst += dst_skip;
-		src++;
+
+		src += count;
+		nsamples -= count;
 	}
 }
 
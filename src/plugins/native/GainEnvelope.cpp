@@ -25,6 +25,8 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.
 #include "Mixer.h"
 #include "AudioBus.h"
 
+#include <QVarLengthArray>
+
 GainEnvelope::GainEnvelope(TSession* session)
         : Plugin(session)
 {
@@ -105,16 +107,38 @@ Curve * GainEnvelope::get_curve()
 }
 
 
-void GainEnvelope::process_gain(audio_sample_t** buffer, const TimeRef& startlocation, const TimeRef& endlocation, nframes_t nframes, uint channels)
+void GainEnvelope::process_gain(audio_sample_t** buffer, const TimeRef& startlocation, const TimeRef& endlocation, nframes_t nframes, uint channels, float pan)
 {
         PluginControlPort* port = m_controlPorts.at(0);
+        float leftPan = pan > 0 ? 1 - pan : 1.0f;
+        float rightPan = pan < 0 ? 1 + pan : 1.0f;
 
         if (port->use_automation()) {
-                port->get_curve()->process(buffer, startlocation, endlocation, nframes, channels, m_gain);
-        } else {
+                if (pan == 0.0f) {
+                        port->get_curve()->process(buffer, startlocation, endlocation, nframes, channels, m_gain);
+                        return;
+                }
+
+                // Let the curve apply the pan in the same pass
+                QVarLengthArray<float, 8> channelGains(channels);
                 for (uint chan=0; chan<channels; ++chan) {
-                        Mixer::apply_gain_to_buffer(buffer[chan], nframes, m_gain);
+                        channelGains[chan] = (chan == 0) ? leftPan : (chan == 1) ? rightPan : 1.0f;
                 }
+                port->get_curve()->process(buffer, startlocation, endlocation, nframes, channels, m_gain, channelGains.constData());
+                return;
         }
-}
 
+        uint chan = 0;
+
+        if (channels >= 2) {
+                Mixer::apply_stereo_gain(buffer[0], buffer[1], nframes, leftPan * m_gain, rightPan * m_gain);
+                chan = 2;
+        } else if (channels == 1) {
+                Mixer::apply_gain_to_buffer(buffer[0], nframes, leftPan * m_gain);
+                chan = 1;
+        }
+
+        for (; chan<channels; ++chan) {
+                Mixer::apply_gain_to_buffer(buffer[chan], nframes, m_gain);
+        }
+}
@@ -39,7 +39,9 @@ public:
 	QDomNode get_state(QDomDocument doc);
 	int set_state(const QDomNode & node );
     void process(AudioBus* bus, nframes_t nframes);
-	void process_gain(audio_sample_t** buffer, const TimeRef& startlocation, const TimeRef& endlocation, nframes_t nframes, uint channels);
+	// pan (-1.0 .. 1.0) attenuates the left or right channel, and is applied
+	// in the same pass as the gain when there is no automation
+	void process_gain(audio_sample_t** buffer, const TimeRef& startlocation, const TimeRef& endlocation, nframes_t nframes, uint channels, float pan = 0.0f);
 	
         void set_session(TSession* session);
 	void set_gain(float gain) {m_gain = gain;}
@@ -44,16 +44,14 @@ SpectralMeter::SpectralMeter()
 
     init();
 
-	// constructs a ringbuffer that can hold 16384 samples
-	m_databufferL = new RingBufferNPT<float>(16384);
-	m_databufferR = new RingBufferNPT<float>(16384);
+	// constructs a stereo ringbuffer that can hold 16384 samples per channel
+	m_databuffer = new MultiChannelRingBuffer<float>(2, 16384);
 }
 
 
 SpectralMeter::~SpectralMeter()
 {
-	delete m_databufferL;
-	delete m_databufferR;
+	delete m_databuffer;
 }
 
 
@@ -150,8 +148,8 @@ void SpectralMeter::process(AudioBus* bus, nframes_t nframes)
 	// The nframes is the amount of samples there are in the buffers
 	// we have to process. No need to get the buffersize, we _have_ to
 	// use the nframes variable !
-	m_databufferL->write(bus->get_buffer(0, nframes), nframes);
-	m_databufferR->write(bus->get_buffer(1, nframes), nframes);
+	audio_sample_t* buffers[2] = {bus->get_buffer(0, nframes), bus->get_buffer(1, nframes)};
+	m_databuffer->write(buffers, nframes);
 }
 
 
@@ -163,7 +161,7 @@ QString SpectralMeter::get_name( )
 // writes the fft output into two qvector<float> (left and right channel).
 int SpectralMeter::get_data(QVector<float> &specl, QVector<float> &specr)
 {
-    size_t readcount = m_databufferL->read_space();
+    size_t readcount = m_databuffer->read_space();
 	
 	// If there is not enough new data for an FFT window in the ringbuffer,
 	// decide if the cycle should be ignored or if the fft spectrum should
@@ -194,21 +192,30 @@ int SpectralMeter::get_data(QVector<float> &specl, QVector<float> &specr)
 	specl.clear();
 	specr.clear();
 
-	// Create an empty SpectralMeterData struct data,
 	float left = 0.0;
 	float right = 0.0;
 
-	// read samples (in chunks of buffer_size) from the ringbuffer until the FFT window is filled
-	m_databufferL->read(&left, 1);
-	m_databufferR->read(&right, 1);
+	// read the samples in place from the ringbuffer until the FFT window is filled,
+	// skipping the first one, and release them with one read pointer update.
+	MultiChannelRingBuffer<float>::rw_vector vec;
+	m_databuffer->get_read_vector(&vec);
+	float* bufferLeft = m_databuffer->channel_buffer(0);
+	float* bufferRight = m_databuffer->channel_buffer(1);
+	size_t available = vec.len[0] + vec.len[1];
 
 	for (int i = 0; i < m_frlen; ++i) {
-		m_databufferL->read(&left, 1);
-		m_databufferR->read(&right, 1);
+		size_t pos = size_t(i) + 1;
+		if (pos < available) {
+			size_t offset = pos < vec.len[0] ? vec.offset[0] + pos : vec.offset[1] + pos - vec.len[0];
+			left = bufferLeft[offset];
+			right = bufferRight[offset];
+		}
         fftsigl[i] = double(left) * win[i];
         fftsigr[i] = double(right) * win[i];
 	}
 
+	m_databuffer->increment_read_ptr(qMin(available, size_t(m_frlen) + 1));
+
 	// do the FFT calculations for the left and right channel
 	fftw_execute(pfegl);
 	fftw_execute(pfegr);
@@ -38,6 +38,8 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.
 #include "ResourcesManager.h"
 #include "ProjectManager.h"
 #include "Peak.h"
+#include "TAudioTileCache.h"
+#include "TWaveformTileCache.h"
 #include "Information.h"
 #include "Themer.h"
 #include "TConfig.h"
@@ -98,6 +100,7 @@ AudioClipView::AudioClipView(SheetView* sv, AudioTrackView* parent, AudioClip* c
     connect(m_clip, SIGNAL(fadeAdded(FadeCurve*)), this, SLOT(add_new_fade_curve_view( FadeCurve*)));
     connect(m_clip, SIGNAL(fadeRemoved(FadeCurve*)), this, SLOT(remove_fade_curve_view( FadeCurve*)));
     connect(m_clip, SIGNAL(positionChanged()), this, SLOT(position_changed()));
+    connect(&audio_tile_cache(), SIGNAL(tileAvailable(qint64)), this, SLOT(audio_tile_available(qint64)));
 
     if (m_clip->recording_state() == AudioClip::RECORDING) {
         start_recording();
@@ -161,15 +164,17 @@ void AudioClipView::paint(QPainter* painter, const QStyleOptionGraphicsItem *opt
         }
     }
 
+    // m_waveBrushState identifies the brush in the waveform tile keys
     if (m_clip->is_muted()) {
         m_waveBrush = m_brushFgMuted;
+        m_waveBrushState = 0;
     } else {
         if (m_sheet->get_mode() == Sheet::EDIT) {
-            if (mousehover) m_waveBrush = m_brushFgHover;
-            else            m_waveBrush = m_brushFg;
+            if (mousehover) {m_waveBrush = m_brushFgHover; m_waveBrushState = 1;}
+            else            {m_waveBrush = m_brushFg; m_waveBrushState = 2;}
         } else {
-            if (mousehover) m_waveBrush = m_brushFgEditHover;
-            else            m_waveBrush = m_brushFgEdit;
+            if (mousehover) {m_waveBrush = m_brushFgEditHover; m_waveBrushState = 3;}
+            else            {m_waveBrush = m_brushFgEdit; m_waveBrushState = 4;}
         }
     }
 
@@ -178,6 +183,8 @@ void AudioClipView::paint(QPainter* painter, const QStyleOptionGraphicsItem *opt
     if (channels > 0) {
         if (m_waitingForPeaks) {
             PMESG("Waiting for peaks!");
+            // We're visible, so move our Peak to the front of the build queue
+            m_clip->get_peak()->prioritize_peak_loading();
             // Hmm, do we paint here something?
             // Progress info, I think so....
             painter->setPen(Qt::black);
@@ -191,7 +198,7 @@ void AudioClipView::paint(QPainter* painter, const QStyleOptionGraphicsItem *opt
 
         } else if (m_clip->recording_state() == AudioClip::NO_RECORDING) {
             //                        PROFILE_START;
-            draw_peaks(painter, option->exposedRect.x(), pixelcount);
+            draw_waveform(painter, option->exposedRect.x(), pixelcount);
             //                        PROFILE_END("draw peaks");
         }
     }
@@ -216,33 +223,93 @@ void AudioClipView::paint(QPainter* painter, const QStyleOptionGraphicsItem *opt
     painter->restore();
 }
 
-void AudioClipView::draw_peaks(QPainter* p, qreal xstart, int pixelcount)
+// Returns the upper and lower peak value of pixel x, the maximum of channels
+// firstchan up to and including lastchan. Beyond the end of the peak data
+// there is nothing to draw.
+static inline void macro_peak_values(const peak_data_t* const* peakdata, const int* availpeaks,
+                                     int firstchan, int lastchan, int x, float& upper, float& lower)
 {
-    PENTER4;
+    upper = lower = 0.0f;
 
-    Peak* peak = m_clip->get_peak();
+    for (int chan = firstchan; chan <= lastchan; ++chan) {
+        if (x * 2 + 1 < availpeaks[chan]) {
+            upper = f_max(upper, float(peakdata[chan][x * 2]));
+            lower = f_max(lower, float(peakdata[chan][x * 2 + 1]));
+        }
+    }
+}
 
-    // clip away the outline which are painted again vertically
-    // in Qt 4.6.x, it doesn't happen in Qt 4.5.x
-    // FIXME: find out why?
-    if (xstart > 0) {
-        xstart -= 1;
-        pixelcount += 1;
+// Composites the waveform from cached tiles, and renders the missing ones.
+void AudioClipView::draw_waveform(QPainter* painter, qreal xstart, qreal pixelcount)
+{
+    TWaveformTileCache& cache = waveform_tile_cache();
+    const int tileWidth = TWaveformTileCache::TILE_WIDTH;
+
+    // Tiles are aligned to the start of the audio source, not the clip
+    double offset = double(m_clip->get_source_start_location() / m_sv->timeref_scalefactor);
+    qint64 firstTile = qint64((xstart + offset) / tileWidth);
+    qint64 lastTile = qint64((xstart + pixelcount + offset) / tileWidth);
+
+    for (qint64 tile = firstTile; tile <= lastTile; ++tile) {
+        qreal tilex = qRound(tile * tileWidth - offset);
+        TWaveformTileKey key = waveform_tile_key(tile, tilex);
+        QPixmap pixmap;
+
+        if (!cache.find(key, pixmap)) {
+            pixmap = QPixmap(tileWidth, m_height);
+            pixmap.fill(Qt::transparent);
+
+            QPainter tilePainter(&pixmap);
+            tilePainter.translate(-tilex, 0);
+            bool complete = draw_peaks(&tilePainter, tilex, tileWidth);
+            tilePainter.end();
+
+            // Placeholders and partly drawn tiles are not kept
+            if (complete) {
+                cache.insert(key, pixmap);
+            } else if (m_waitingForPeaks) {
+                return;
+            }
+        }
+
+        painter->drawPixmap(QPointF(tilex, 0), pixmap);
     }
-    pixelcount += 2;
+}
 
-    if (!peak) {
-        //                PERROR("No Peak object available for clip %s", QS_C(m_clip->get_name()));
-        return;
+TWaveformTileKey AudioClipView::waveform_tile_key(qint64 tile, qreal tilex)
+{
+    TWaveformTileKey key;
+    key.sourceId = m_clip->get_readsource_id();
+    key.tile = tile;
+    key.hzoom = m_sheet->get_hzoom();
+    key.height = m_height;
+
+    // Include the margin draw_peaks() paints around the tile
+    int count = TWaveformTileCache::TILE_WIDTH + 3;
+    float curveDefaultValue;
+    QVarLengthArray<float> curveMixdown(count);
+    key.curveHash = 0;
+    if (calculate_curve_mixdown(tilex - 1, count, curveMixdown.data(), curveDefaultValue)) {
+        key.curveHash = qHash(QByteArray::fromRawData((const char*) curveMixdown.constData(), count * sizeof(float)));
+        // 0 means no curve data
+        key.curveHash |= 1;
     }
+    key.gain = m_clip->get_gain() * curveDefaultValue;
+
+    key.flags = m_clip->get_channel_count() & 0xff;
+    key.flags |= m_mergedView << 8;
+    key.flags |= m_classicView << 9;
+    key.flags |= (m_fillwave ? 1 : 0) << 10;
+    key.flags |= m_paintWithOutline << 11;
+    key.flags |= m_clip->is_selected() << 12;
+    key.flags |= m_clip->is_muted() << 13;
+    key.flags |= m_waveBrushState << 14;
+
+    return key;
+}
 
-    bool microView = m_sheet->get_hzoom() < 64 ? true : false;
-    TimeRef clipstartoffset = m_clip->get_source_start_location();
-    uint channels = m_clip->get_channel_count();
-    int peakdatacount = microView ? pixelcount : pixelcount * 2;
-    // FIXME: make it so it supports any channel count
-    float* pixeldata[6];
-    float curveDefaultValue = 1.0;
+int AudioClipView::calculate_curve_mixdown(qreal xstart, int count, float* curveMixdown, float& curveDefaultValue)
+{
     int mixCurveData = 0;
     int mixAudioClipCurveData = 0;
     int mixTrackAutomationData = 0;
@@ -250,49 +317,49 @@ void AudioClipView::draw_peaks(QPainter* p, qreal xstart, int pixelcount)
     mixAudioClipCurveData |= m_gainCurveView->has_nodes();
     mixTrackAutomationData |= trackAutomationView->has_nodes();
 
-    double offset = double(clipstartoffset / m_sv->timeref_scalefactor);
+    double offset = double(m_clip->get_source_start_location() / m_sv->timeref_scalefactor);
+
+    curveDefaultValue = 1.0;
 
     if (!mixAudioClipCurveData && !mixTrackAutomationData) {
         curveDefaultValue = m_gainCurveView->get_default_value();
         curveDefaultValue *= trackAutomationView->get_default_value();
     }
 
-    QVarLengthArray<float> curveMixdown(peakdatacount);
-
     if (mixAudioClipCurveData) {
-        mixAudioClipCurveData |= m_gainCurveView->get_vector(xstart + offset, peakdatacount, curveMixdown.data());
+        mixAudioClipCurveData |= m_gainCurveView->get_vector(xstart + offset, count, curveMixdown);
         mixCurveData |= mixAudioClipCurveData;
     }
 
     if (mixTrackAutomationData) {
         if (mixAudioClipCurveData) {
-            QVarLengthArray<float> trackmixdown(peakdatacount);
-            int trackCurveMix = trackAutomationView->get_vector(xstart + pos().x(), peakdatacount, trackmixdown.data());
+            QVarLengthArray<float> trackmixdown(count);
+            int trackCurveMix = trackAutomationView->get_vector(xstart + pos().x(), count, trackmixdown.data());
             if (trackCurveMix) {
-                for (int j=0; j<peakdatacount; ++j) {
+                for (int j=0; j<count; ++j) {
                     curveMixdown[j] *= trackmixdown[j];
                 }
                 mixCurveData |= trackCurveMix;
             }
         } else {
-            mixTrackAutomationData |= trackAutomationView->get_vector(xstart + pos().x(), peakdatacount, curveMixdown.data());
+            mixTrackAutomationData |= trackAutomationView->get_vector(xstart + pos().x(), count, curveMixdown);
             mixCurveData |= mixTrackAutomationData;
         }
     }
 
     for (int i = 0; i < m_FadeCurveViews.size(); ++i) {
         FadeCurveView* view = m_FadeCurveViews.at(i);
-        QVarLengthArray<float> fademixdown(peakdatacount);
+        QVarLengthArray<float> fademixdown(count);
         int fademix = 0;
 
         if (mixCurveData) {
-            fademix = view->get_vector(xstart, peakdatacount, fademixdown.data());
+            fademix = view->get_vector(xstart, count, fademixdown.data());
         } else {
-            fademix = view->get_vector(xstart, peakdatacount, curveMixdown.data());
+            fademix = view->get_vector(xstart, count, curveMixdown);
         }
 
         if (mixCurveData && fademix) {
-            for (int j=0; j<peakdatacount; ++j) {
+            for (int j=0; j<count; ++j) {
                 curveMixdown[j] *= fademixdown[j];
             }
         }
@@ -300,16 +367,63 @@ void AudioClipView::draw_peaks(QPainter* p, qreal xstart, int pixelcount)
         mixCurveData |= fademix;
     }
 
+    return mixCurveData;
+}
+
+bool AudioClipView::draw_peaks(QPainter* p, qreal xstart, int pixelcount)
+{
+    PENTER4;
+
+    Peak* peak = m_clip->get_peak();
+
+    // clip away the outline which are painted again vertically
+    // in Qt 4.6.x, it doesn't happen in Qt 4.5.x
+    // FIXME: find out why?
+    if (xstart > 0) {
+        xstart -= 1;
+        pixelcount += 1;
+    }
+    pixelcount += 2;
+
+    if (!peak) {
+        //                PERROR("No Peak object available for clip %s", QS_C(m_clip->get_name()));
+        return false;
+    }
+
+    bool microView = m_sheet->get_hzoom() < 64 ? true : false;
+    TimeRef clipstartoffset = m_clip->get_source_start_location();
+    uint channels = m_clip->get_channel_count();
+    int peakdatacount = microView ? pixelcount : pixelcount * 2;
+    // FIXME: make it so it supports any channel count
+    // MicroView gets calculated sample values, MacroView a view on the peak file
+    float* pixeldata[6];
+    const peak_data_t* peakdata[6];
+    int availpeakdata[6];
+    float curveDefaultValue = 1.0;
+    QVarLengthArray<float> curveMixdown(peakdatacount);
+    int mixCurveData = calculate_curve_mixdown(xstart, peakdatacount, curveMixdown.data(), curveDefaultValue);
+
     // Load peak data, mix curvedata and start painting it
     // if no peakdata is returned for a certain Peak object, schedule it for loading.
     for (int chan=0; chan < channels; ++chan) {
 
-        int availpeaks = peak->calculate_peaks(
-                    chan,
-                    &pixeldata[chan],
-                    TimeRef(xstart * m_sv->timeref_scalefactor) + clipstartoffset,
-                    peakdatacount,
-                    m_sheet->get_hzoom());
+        int availpeaks;
+
+        if (microView) {
+            availpeaks = peak->calculate_micro_peaks(
+                        chan,
+                        &pixeldata[chan],
+                        TimeRef(xstart * m_sv->timeref_scalefactor) + clipstartoffset,
+                        peakdatacount,
+                        m_sheet->get_hzoom());
+        } else {
+            availpeaks = peak->calculate_peaks(
+                        chan,
+                        &peakdata[chan],
+                        TimeRef(xstart * m_sv->timeref_scalefactor) + clipstartoffset,
+                        peakdatacount,
+                        m_sheet->get_hzoom());
+        }
 
 
         if (peakdatacount != availpeaks) {
@@ -321,52 +435,51 @@ void AudioClipView::draw_peaks(QPainter* p, qreal xstart, int pixelcount)
             connect(peak, SIGNAL(finished()), this, SLOT (peak_creation_finished()));
             m_waitingForPeaks = true;
             peak->start_peak_loading();
-            return;
+            return false;
+        }
+
+        if (availpeaks == Peak::PERMANENT_FAILURE) {
+            return false;
+        }
+
+        // Nothing to draw here, beyond the end of the audio for example
+        if (availpeaks == Peak::NO_PEAKDATA_FOUND) {
+            return true;
         }
 
-        if (availpeaks == Peak::PERMANENT_FAILURE || availpeaks == Peak::NO_PEAKDATA_FOUND) {
-            return;
+        if (availpeaks == Peak::DATA_PENDING) {
+            // The audio is being decoded for the micro view, draw a placeholder
+            // line until audio_tile_available() tells us to repaint
+            p->save();
+            p->setPen(QPen(themer()->get_color("AudioClip:wavemicroview"), 1, Qt::DotLine));
+            int lanes = m_mergedView ? 1 : channels;
+            int height = m_height / lanes;
+            for (int lane = 0; lane < lanes; ++lane) {
+                qreal y = height / 2 + lane * height;
+                p->drawLine(QPointF(xstart, y), QPointF(xstart + pixelcount, y));
+            }
+            p->restore();
+            return false;
         }
 
+        availpeakdata[chan] = availpeaks;
+
         if (m_mergedView && channels == 2 && chan == 0) continue;
 
 
         // 		pixelcount = std::min(pixelcount, availpeaks);
 
-        // ClassicView uses both positive and negative values,
-        // rectified view: pick the highest value of both
-        // Merged view: calculate highest value for all channels,
-        // and store it in the first channels pixeldata.
-        if (!microView) {
-            // if Rectified View, calculate max of the minimum and maximum value.
-            if (!m_classicView) {
-                for (int i=0, j=0; i < (pixelcount*2); i+=2, ++j) {
-                    pixeldata[chan][j] = - std::fabs(f_max(pixeldata[chan][i], - pixeldata[chan][i+1]));
-                }
-            }
-
-            if (m_mergedView && channels == 2) {
-                for (int i = 0; i < (pixelcount*2); ++i) {
-                    pixeldata[0][i] = f_max(pixeldata[chan - 1][i], pixeldata[chan][i]);
-                }
+        // MacroView applies the curves while it converts the peak data
+        // into polygon points, MicroView has a value per pixel.
+        if (microView && mixCurveData) {
+            for (int i = 0; i < pixelcount; i++) {
+                pixeldata[chan][i] *= curveMixdown[i];
             }
         }
 
-        if (mixCurveData) {
-            int curvemixdownpos = 0;
-            if (m_classicView) {
-                for (int i = 0; i < (pixelcount*2); ++i) {
-                    pixeldata[chan][i++] *= curveMixdown[curvemixdownpos];
-                    pixeldata[chan][i] *= curveMixdown[curvemixdownpos];
-                    curvemixdownpos++;
-                }
-            } else {
-                for (int i = 0; i < pixelcount; i++) {
-                    pixeldata[chan][i] *= curveMixdown[curvemixdownpos];
-                    curvemixdownpos++;
-                }
-            }
-        }
+        // Merged view: draw the highest value of all channels
+        int firstchan = (m_mergedView && channels == 2) ? 0 : chan;
+        float upper, lower;
 
         p->save();
 
@@ -461,8 +574,6 @@ void AudioClipView::draw_peaks(QPainter* p, qreal xstart, int pixelcount)
                 }
             }
 
-            int bufferpos = 0;
-
             if (m_classicView) {
 
                 if (m_mergedView) {
@@ -477,15 +588,19 @@ void AudioClipView::draw_peaks(QPainter* p, qreal xstart, int pixelcount)
                 m_polygon.reserve(pixelcount*2);
 
                 for (int x = 0; x < pixelcount; x++) {
-                    m_polygon.append( QPointF(x, -scaleFactor * pixeldata[chan][bufferpos]) );
-                    bufferpos+=2;
+                    macro_peak_values(peakdata, availpeakdata, firstchan, chan, x, upper, lower);
+                    if (mixCurveData) {
+                        upper *= curveMixdown[x];
+                    }
+                    m_polygon.append( QPointF(x, -scaleFactor * upper) );
                 }
 
-                bufferpos -= 1;
-
                 for (int x = pixelcount - 1; x >= 0; x--) {
-                    m_polygon.append( QPointF(x, scaleFactor * pixeldata[chan][bufferpos]) );
-                    bufferpos-=2;
+                    macro_peak_values(peakdata, availpeakdata, firstchan, chan, x, upper, lower);
+                    if (mixCurveData) {
+                        lower *= curveMixdown[x];
+                    }
+                    m_polygon.append( QPointF(x, scaleFactor * lower) );
                 }
 
                 //                                PROFILE_START;
@@ -510,8 +625,14 @@ void AudioClipView::draw_peaks(QPainter* p, qreal xstart, int pixelcount)
                 m_polygon.clear();
                 m_polygon.reserve(pixelcount + 2);
 
+                // Rectified view: the highest of the positive and negative part
                 for (int x=0; x<pixelcount; x++) {
-                    m_polygon.append( QPointF(x, scaleFactor * pixeldata[chan][bufferpos++]) );
+                    macro_peak_values(peakdata, availpeakdata, firstchan, chan, x, upper, lower);
+                    float value = f_max(upper, lower);
+                    if (mixCurveData) {
+                        value *= curveMixdown[x];
+                    }
+                    m_polygon.append( QPointF(x, -scaleFactor * value) );
                 }
 
                 m_polygon.append(QPointF(pixelcount, 0));
@@ -524,6 +645,8 @@ void AudioClipView::draw_peaks(QPainter* p, qreal xstart, int pixelcount)
 
         p->restore();
     }
+
+    return true;
 }
 
 void AudioClipView::draw_clipinfo_area(QPainter* p, double xstart)
@@ -677,9 +800,17 @@ void AudioClipView::update_progress_info( int progress )
 void AudioClipView::peak_creation_finished()
 {
     m_waitingForPeaks = false;
+    waveform_tile_cache().remove_source(m_clip->get_readsource_id());
     update();
 }
 
+void AudioClipView::audio_tile_available(qint64 sourceId)
+{
+    if (sourceId == m_clip->get_readsource_id() && m_sheet->get_hzoom() < 64) {
+        update();
+    }
+}
+
 void AudioClipView::add_new_fade_curve_view( FadeCurve * fade )
 {
     PENTER;
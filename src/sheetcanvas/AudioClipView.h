@@ -37,6 +37,7 @@ class SheetView;
 class AudioTrackView;
 class FadeCurveView;
 class Peak;
+struct TWaveformTileKey;
 
 
 class AudioClipView : public ViewItem
@@ -92,6 +93,7 @@ private:
 	QColor m_backgroundColorMouseHoverBottom;
 	QColor minINFLineColor;
 	QBrush m_waveBrush;
+	int m_waveBrushState{};
 	QBrush m_brushBgRecording;
 	QBrush m_brushBgMuted;
 	QBrush m_brushBgMutedHover;
@@ -109,7 +111,10 @@ private:
 
 	void draw_clipinfo_area(QPainter* painter, double xstart);
 	void draw_db_lines(QPainter* painter, qreal xstart, int pixelcount);
-	void draw_peaks(QPainter* painter, qreal xstart, int pixelcount);
+	void draw_waveform(QPainter* painter, qreal xstart, qreal pixelcount);
+	bool draw_peaks(QPainter* painter, qreal xstart, int pixelcount);
+	int calculate_curve_mixdown(qreal xstart, int count, float* curveMixdown, float& curveDefaultValue);
+	TWaveformTileKey waveform_tile_key(qint64 tile, qreal tilex);
 	void create_brushes();
 
 	friend class FadeCurveView;
@@ -133,6 +138,7 @@ public slots:
 private slots:
 	void update_progress_info(int progress);
 	void peak_creation_finished();
+	void audio_tile_available(qint64 sourceId);
 	void start_recording();
 	void finish_recording();
 	void update_recording();
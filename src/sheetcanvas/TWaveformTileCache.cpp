@@ -0,0 +1,80 @@
+/*
+Copyright (C) 2026 The Traverso developers
+
+This file is part of Traverso
+
+Traverso is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.
+
+*/
+
+#include "TWaveformTileCache.h"
+
+#include "Themer.h"
+#include "TConfig.h"
+
+// Always put me below _all_ includes, this is needed
+// in case we run with memory leak detection enabled!
+#include "Debugger.h"
+
+
+TWaveformTileCache& waveform_tile_cache()
+{
+	static TWaveformTileCache cache;
+	return cache;
+}
+
+
+TWaveformTileCache::TWaveformTileCache()
+{
+	// The cost of a tile is it's size in KB
+	int budget = config().get_property("Themer", "waveformcachesize", 32).toInt();
+	m_tiles.setMaxCost(qMax(1, budget) * 1024);
+
+	// Colors and brushes aren't part of the key
+	connect(themer(), SIGNAL(themeLoaded()), this, SLOT(clear()));
+}
+
+bool TWaveformTileCache::find(const TWaveformTileKey& key, QPixmap& pixmap)
+{
+	QPixmap* cached = m_tiles.object(key);
+
+	if (!cached) {
+		return false;
+	}
+
+	pixmap = *cached;
+	return true;
+}
+
+void TWaveformTileCache::insert(const TWaveformTileKey& key, const QPixmap& pixmap)
+{
+	int cost = qMax(1, pixmap.width() * pixmap.height() * pixmap.depth() / (8 * 1024));
+	m_tiles.insert(key, new QPixmap(pixmap), cost);
+}
+
+// The peak data of the source changed, drop all it's tiles
+void TWaveformTileCache::remove_source(qint64 sourceId)
+{
+	foreach(const TWaveformTileKey& key, m_tiles.keys()) {
+		if (key.sourceId == sourceId) {
+			m_tiles.remove(key);
+		}
+	}
+}
+
+void TWaveformTileCache::clear()
+{
+	m_tiles.clear();
+}
@@ -0,0 +1,89 @@
+/*
+Copyright (C) 2026 The Traverso developers
+
+This file is part of Traverso
+
+Traverso is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.
+
+*/
+
+#ifndef TWAVEFORMTILECACHE_H
+#define TWAVEFORMTILECACHE_H
+
+#include <QObject>
+#include <QCache>
+#include <QPixmap>
+
+/**
+ * Identifies a rendered waveform tile. Tiles are aligned to the audio source
+ * rather than to the clip, and everything the rendering depends on is part of
+ * the key, so clips of the same source share tiles, and a tile is only
+ * rendered again when something it shows has changed.
+ */
+struct TWaveformTileKey {
+	qint64	sourceId;
+	qint64	tile;
+	double	hzoom;
+	float	gain;		// clip gain times the constant curve gain
+	uint	curveHash;	// 0 if no curve applies to the tile
+	int	height;
+	uint	flags;		// view mode, channel count, brush and pen state
+
+	bool operator==(const TWaveformTileKey& other) const {
+		return sourceId == other.sourceId && tile == other.tile && hzoom == other.hzoom &&
+			gain == other.gain && curveHash == other.curveHash &&
+			height == other.height && flags == other.flags;
+	}
+};
+
+inline uint qHash(const TWaveformTileKey& key)
+{
+	return qHash(key.sourceId) ^ qHash(key.tile) ^ qHash(key.hzoom) ^
+		qHash(key.gain) ^ key.curveHash ^ qHash(key.height) ^ (key.flags << 16);
+}
+
+
+/**
+ * Keeps rendered waveform tiles of AudioClipViews, least recently used tiles
+ * are dropped once the memory budget ("Themer"/"waveformcachesize", in MB)
+ * is exceeded. Only used from the GUI thread.
+ */
+class TWaveformTileCache : public QObject
+{
+	Q_OBJECT
+
+public:
+	static const int TILE_WIDTH = 256;
+
+	bool find(const TWaveformTileKey& key, QPixmap& pixmap);
+	void insert(const TWaveformTileKey& key, const QPixmap& pixmap);
+	void remove_source(qint64 sourceId);
+
+public slots:
+	void clear();
+
+private:
+	QCache<TWaveformTileKey, QPixmap>	m_tiles;
+
+	TWaveformTileCache();
+	TWaveformTileCache(const TWaveformTileCache&);
+	// allow this function to create one instance
+	friend TWaveformTileCache& waveform_tile_cache();
+};
+
+// use this function to access the waveform tile cache
+TWaveformTileCache& waveform_tile_cache();
+
+#endif
@@ -219,6 +219,85 @@ void Traverso::init_sse( )
 
     }
 
+#endif
+
+    // These have no SSE version, start with the generic ones
+    Mixer::find_peaks			= default_find_peaks;
+    Mixer::mix_buffers_with_gain_ramp	= default_mix_buffers_with_gain_ramp;
+    Mixer::apply_gain_ramp		= default_apply_gain_ramp;
+    Mixer::apply_stereo_gain		= default_apply_stereo_gain;
+    Mixer::interleave_stereo		= default_interleave_stereo;
+    Mixer::deinterleave_stereo		= default_deinterleave_stereo;
+    Mixer::convert_to_int16		= default_convert_to_int16;
+    Mixer::convert_to_int32		= default_convert_to_int32;
+
+#if defined (MIXER_X86_AVX_KERNELS)
+
+    if (fpu.has_avx512f()) {
+
+        printf("Using AVX-512 optimized routines\n");
+
+        // AVX-512 SET
+        Mixer::compute_peak		= x86_avx512_compute_peak;
+        Mixer::apply_gain_to_buffer 	= x86_avx512_apply_gain_to_buffer;
+        Mixer::mix_buffers_with_gain 	= x86_avx512_mix_buffers_with_gain;
+        Mixer::mix_buffers_no_gain 	= x86_avx512_mix_buffers_no_gain;
+        Mixer::find_peaks		= x86_avx512_find_peaks;
+        Mixer::mix_buffers_with_gain_ramp	= x86_avx512_mix_buffers_with_gain_ramp;
+        Mixer::apply_gain_ramp		= x86_avx512_apply_gain_ramp;
+        Mixer::apply_stereo_gain	= x86_avx512_apply_stereo_gain;
+
+        // These have no AVX-512 version
+        if (fpu.has_avx2()) {
+            Mixer::interleave_stereo	= x86_avx2_interleave_stereo;
+            Mixer::deinterleave_stereo	= x86_avx2_deinterleave_stereo;
+            Mixer::convert_to_int16	= x86_avx2_convert_to_int16;
+            Mixer::convert_to_int32	= x86_avx2_convert_to_int32;
+        }
+
+        generic_mix_functions = false;
+
+    } else if (fpu.has_avx2()) {
+
+        printf("Using AVX2 optimized routines\n");
+
+        // AVX2 SET
+        Mixer::compute_peak		= x86_avx2_compute_peak;
+        Mixer::apply_gain_to_buffer 	= x86_avx2_apply_gain_to_buffer;
+        Mixer::mix_buffers_with_gain 	= x86_avx2_mix_buffers_with_gain;
+        Mixer::mix_buffers_no_gain 	= x86_avx2_mix_buffers_no_gain;
+        Mixer::find_peaks		= x86_avx2_find_peaks;
+        Mixer::mix_buffers_with_gain_ramp	= x86_avx2_mix_buffers_with_gain_ramp;
+        Mixer::apply_gain_ramp		= x86_avx2_apply_gain_ramp;
+        Mixer::apply_stereo_gain	= x86_avx2_apply_stereo_gain;
+        Mixer::interleave_stereo	= x86_avx2_interleave_stereo;
+        Mixer::deinterleave_stereo	= x86_avx2_deinterleave_stereo;
+        Mixer::convert_to_int16	= x86_avx2_convert_to_int16;
+        Mixer::convert_to_int32	= x86_avx2_convert_to_int32;
+
+        generic_mix_functions = false;
+    }
+
+#elif defined (MIXER_ARM_NEON_KERNELS)
+
+    printf("Using NEON optimized routines\n");
+
+    // NEON SET, NEON is always present when the compiler targets it
+    Mixer::compute_peak		= arm_neon_compute_peak;
+    Mixer::apply_gain_to_buffer 	= arm_neon_apply_gain_to_buffer;
+    Mixer::mix_buffers_with_gain 	= arm_neon_mix_buffers_with_gain;
+    Mixer::mix_buffers_no_gain 	= arm_neon_mix_buffers_no_gain;
+    Mixer::find_peaks		= arm_neon_find_peaks;
+    Mixer::mix_buffers_with_gain_ramp	= arm_neon_mix_buffers_with_gain_ramp;
+    Mixer::apply_gain_ramp		= arm_neon_apply_gain_ramp;
+    Mixer::apply_stereo_gain	= arm_neon_apply_stereo_gain;
+    Mixer::interleave_stereo	= arm_neon_interleave_stereo;
+    Mixer::deinterleave_stereo	= arm_neon_deinterleave_stereo;
+    Mixer::convert_to_int16	= arm_neon_convert_to_int16;
+    Mixer::convert_to_int32	= arm_neon_convert_to_int32;
+
+    generic_mix_functions = false;
+
 #elif defined (__APPLE__) && defined (BUILD_VECLIB_OPTIMIZATIONS)
     long sysVersion = 0;
 
@@ -230,6 +309,7 @@ void Traverso::init_sse( )
         Mixer::apply_gain_to_buffer   = veclib_apply_gain_to_buffer;
         Mixer::mix_buffers_with_gain  = veclib_mix_buffers_with_gain;
         Mixer::mix_buffers_no_gain    = veclib_mix_buffers_no_gain;
+        Mixer::find_peaks             = veclib_find_peaks;
 
         generic_mix_functions = false;
 
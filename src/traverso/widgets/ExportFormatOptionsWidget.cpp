@@ -80,6 +80,15 @@ ExportFormatOptionsWidget::ExportFormatOptionsWidget( QWidget * parent )
 		audioTypeComboBox->addItem("OGG", "ogg");
 	}
 	
+	// mp3 and ogg copies can be written from the same render as the main format
+	extraMp3CheckBox->setVisible(audioTypeComboBox->findData("mp3") >= 0);
+	extraOggCheckBox->setVisible(audioTypeComboBox->findData("ogg") >= 0);
+	extraFormatsLabel->setVisible(!extraMp3CheckBox->isHidden() || !extraOggCheckBox->isHidden());
+	extraMp3CheckBox->setChecked(config().get_property("ExportFormatOptionsWidget", "extraMp3CheckBox", "false").toBool());
+	extraOggCheckBox->setChecked(config().get_property("ExportFormatOptionsWidget", "extraOggCheckBox", "false").toBool());
+	connect(extraMp3CheckBox, SIGNAL(toggled(bool)), this, SLOT(update_option_groups()));
+	connect(extraOggCheckBox, SIGNAL(toggled(bool)), this, SLOT(update_option_groups()));
+	
 	channelComboBox->setCurrentIndex(channelComboBox->findData(2));
 	
 	int rateIndex = sampleRateComboBox->findData(audiodevice().get_sample_rate());
@@ -191,6 +200,8 @@ ExportFormatOptionsWidget::ExportFormatOptionsWidget( QWidget * parent )
 	option = config().get_property("ExportFormatOptionsWidget", "bitdepthComboBox", "16").toString();
 	index = bitdepthComboBox->findData(option);
 	bitdepthComboBox->setCurrentIndex(index >= 0 ? index : 0);
+	
+	update_option_groups();
 }
 
 
@@ -207,6 +218,8 @@ ExportFormatOptionsWidget::~ ExportFormatOptionsWidget( )
 	config().set_property("ExportDialog", "skipWVXCheckBox", skipWVXCheckBox->isChecked());
 	config().set_property("ExportDialog", "resampleQualityComboBox", resampleQualityComboBox->itemData(resampleQualityComboBox->currentIndex()).toString());
 	config().set_property("ExportDialog", "bitdepthComboBox", bitdepthComboBox->itemData(bitdepthComboBox->currentIndex()).toString());
+	config().set_property("ExportFormatOptionsWidget", "extraMp3CheckBox", extraMp3CheckBox->isChecked());
+	config().set_property("ExportFormatOptionsWidget", "extraOggCheckBox", extraOggCheckBox->isChecked());
 }
 
 
@@ -214,26 +227,11 @@ void ExportFormatOptionsWidget::audio_type_changed(int index)
 {
 	QString newType = audioTypeComboBox->itemData(index).toString();
 	
-	if (newType == "mp3") {
-		oggOptionsGroupBox->hide();
-		wacpackGroupBox->hide();
-		mp3OptionsGroupBox->show();
-	}
-	else if (newType == "ogg") {
-		mp3OptionsGroupBox->hide();
-		wacpackGroupBox->hide();
-		oggOptionsGroupBox->show();
-	}
-	else if (newType == "wavpack") {
-		mp3OptionsGroupBox->hide();
-		oggOptionsGroupBox->hide();
-		wacpackGroupBox->show();
-	}
-	else {
-		mp3OptionsGroupBox->hide();
-		wacpackGroupBox->hide();
-		oggOptionsGroupBox->hide();
-	}
+	// the main format is written anyway
+	extraMp3CheckBox->setEnabled(newType != "mp3");
+	extraOggCheckBox->setEnabled(newType != "ogg");
+	
+	update_option_groups();
 	
 	if (newType == "mp3" || newType == "ogg" || newType == "flac") {
 		bitdepthComboBox->setCurrentIndex(bitdepthComboBox->findData(16));
@@ -245,6 +243,17 @@ void ExportFormatOptionsWidget::audio_type_changed(int index)
 }
 
 
+// Shows the options of the main format, and of the extra formats
+void ExportFormatOptionsWidget::update_option_groups()
+{
+	QString type = audioTypeComboBox->itemData(audioTypeComboBox->currentIndex()).toString();
+	
+	mp3OptionsGroupBox->setVisible(type == "mp3" || (extraMp3CheckBox->isEnabled() && extraMp3CheckBox->isChecked()));
+	oggOptionsGroupBox->setVisible(type == "ogg" || (extraOggCheckBox->isEnabled() && extraOggCheckBox->isChecked()));
+	wacpackGroupBox->setVisible(type == "wavpack");
+}
+
+
 void ExportFormatOptionsWidget::mp3_method_changed(int index)
 {
 	QString method = mp3MethodComboBox->itemData(index).toString();
@@ -287,43 +296,48 @@ void ExportFormatOptionsWidget::ogg_method_changed(int index)
 	}
 }
 
-void ExportFormatOptionsWidget::get_format_options(ExportSpecification * spec)
+void ExportFormatOptionsWidget::get_writer_options(const QString& audioType, QString& writerType, QMap<QString, QString>& extraFormat)
 {
-	QString audioType = audioTypeComboBox->itemData(audioTypeComboBox->currentIndex()).toString();
 	if (audioType == "wav") {
-		spec->writerType = "sndfile";
-		spec->extraFormat["filetype"] = "wav";
+		writerType = "sndfile";
+		extraFormat["filetype"] = "wav";
 	}
 	else if (audioType == "aiff") {
-		spec->writerType = "sndfile";
-		spec->extraFormat["filetype"] = "aiff";
+		writerType = "sndfile";
+		extraFormat["filetype"] = "aiff";
 	}
 	else if (audioType == "flac") {
-		spec->writerType = "flac";
+		writerType = "flac";
 	}
 	else if (audioType == "wavpack") {
-		spec->writerType = "wavpack";
-		spec->extraFormat["quality"] = wavpackCompressionComboBox->itemData(wavpackCompressionComboBox->currentIndex()).toString();
-		spec->extraFormat["skip_wvx"] = skipWVXCheckBox->isChecked() ? "true" : "false";
+		writerType = "wavpack";
+		extraFormat["quality"] = wavpackCompressionComboBox->itemData(wavpackCompressionComboBox->currentIndex()).toString();
+		extraFormat["skip_wvx"] = skipWVXCheckBox->isChecked() ? "true" : "false";
 	}
 	else if (audioType == "mp3") {
-		spec->writerType = "lame";
-		spec->extraFormat["method"] = mp3MethodComboBox->itemData(mp3MethodComboBox->currentIndex()).toString();
-		spec->extraFormat["minBitrate"] = mp3MinBitrateComboBox->itemData(mp3MinBitrateComboBox->currentIndex()).toString();
-		spec->extraFormat["maxBitrate"] = mp3MaxBitrateComboBox->itemData(mp3MaxBitrateComboBox->currentIndex()).toString();
-		spec->extraFormat["quality"] = QString::number(mp3QualitySlider->value());
+		writerType = "lame";
+		extraFormat["method"] = mp3MethodComboBox->itemData(mp3MethodComboBox->currentIndex()).toString();
+		extraFormat["minBitrate"] = mp3MinBitrateComboBox->itemData(mp3MinBitrateComboBox->currentIndex()).toString();
+		extraFormat["maxBitrate"] = mp3MaxBitrateComboBox->itemData(mp3MaxBitrateComboBox->currentIndex()).toString();
+		extraFormat["quality"] = QString::number(mp3QualitySlider->value());
 	}
 	else if (audioType == "ogg") {
-		spec->writerType = "vorbis";
-		spec->extraFormat["mode"] = oggMethodComboBox->itemData(oggMethodComboBox->currentIndex()).toString();
-		if (spec->extraFormat["mode"] == "manual") {
-			spec->extraFormat["bitrateNominal"] = oggBitrateComboBox->itemData(oggBitrateComboBox->currentIndex()).toString();
-			spec->extraFormat["bitrateUpper"] = oggBitrateComboBox->itemData(oggBitrateComboBox->currentIndex()).toString();
+		writerType = "vorbis";
+		extraFormat["mode"] = oggMethodComboBox->itemData(oggMethodComboBox->currentIndex()).toString();
+		if (extraFormat["mode"] == "manual") {
+			extraFormat["bitrateNominal"] = oggBitrateComboBox->itemData(oggBitrateComboBox->currentIndex()).toString();
+			extraFormat["bitrateUpper"] = oggBitrateComboBox->itemData(oggBitrateComboBox->currentIndex()).toString();
 		}
 		else {
-			spec->extraFormat["vbrQuality"] = QString::number(oggQualitySlider->value());
+			extraFormat["vbrQuality"] = QString::number(oggQualitySlider->value());
 		}
 	}
+}
+
+void ExportFormatOptionsWidget::get_format_options(ExportSpecification * spec)
+{
+	QString audioType = audioTypeComboBox->itemData(audioTypeComboBox->currentIndex()).toString();
+	get_writer_options(audioType, spec->writerType, spec->extraFormat);
 	
 	spec->data_width = bitdepthComboBox->itemData(bitdepthComboBox->currentIndex()).toInt();
     spec->channels = channelComboBox->itemData(channelComboBox->currentIndex()).toUInt();
@@ -335,6 +349,37 @@ void ExportFormatOptionsWidget::get_format_options(ExportSpecification * spec)
 	
 	//TODO Make a ComboBox for this one too!
 	spec->dither_type = GDitherTri;
-
-
+	
+	// With extra formats, the main format and the extra ones all become
+	// targets of the same render
+	spec->targets.clear();
+	
+	QStringList extraTypes;
+	if (!extraMp3CheckBox->isHidden() && extraMp3CheckBox->isEnabled() && extraMp3CheckBox->isChecked()) {
+		extraTypes.append("mp3");
+	}
+	if (!extraOggCheckBox->isHidden() && extraOggCheckBox->isEnabled() && extraOggCheckBox->isChecked()) {
+		extraTypes.append("ogg");
+	}
+	
+	if (extraTypes.isEmpty()) {
+		return;
+	}
+	
+	ExportTarget mainTarget;
+	mainTarget.writerType = spec->writerType;
+	mainTarget.data_width = spec->data_width;
+	mainTarget.sample_rate = spec->sample_rate;
+	mainTarget.dither_type = spec->dither_type;
+	mainTarget.extraFormat = spec->extraFormat;
+	spec->targets.append(mainTarget);
+	
+	foreach(const QString& type, extraTypes) {
+		ExportTarget target;
+		get_writer_options(type, target.writerType, target.extraFormat);
+		target.data_width = 16;
+		target.sample_rate = spec->sample_rate;
+		target.dither_type = spec->dither_type;
+		spec->targets.append(target);
+	}
 }
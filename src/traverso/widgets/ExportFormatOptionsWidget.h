@@ -25,6 +25,7 @@
 #include "ui_ExportFormatOptionsWidget.h"
 
 #include <QWidget>
+#include <QMap>
 
 struct ExportSpecification;
 
@@ -38,11 +39,14 @@ public:
 	
 	void get_format_options(ExportSpecification* spec);
 
+private:
+	void get_writer_options(const QString& audioType, QString& writerType, QMap<QString, QString>& extraFormat);
 
 private slots:
 	void audio_type_changed(int index);
 	void mp3_method_changed(int index);
 	void ogg_method_changed(int index);
+	void update_option_groups();
 };
 
 #endif